@@ -4,35 +4,51 @@
 #define DEFAULTPOOLCOUNT 10
 
 AutoreleasePool::AutoreleasePool()
-    : poolName_("") {
-    managerObjectArray_.reserve(DEFAULTPOOLOBJECTCOUNT);
-    PoolManager::getInstance().push(this);
+    : AutoreleasePool(&PoolManager::getInstance(), "") {
 }
 
 AutoreleasePool::AutoreleasePool(std::string poolName)
-    : poolName_(poolName) {
+    : AutoreleasePool(&PoolManager::getInstance(), poolName) {
+}
+
+AutoreleasePool::AutoreleasePool(PoolManager *manager, std::string poolName)
+    : poolName_(poolName)
+    , manager_(manager) {
     managerObjectArray_.reserve(DEFAULTPOOLOBJECTCOUNT);
-    PoolManager::getInstance().push(this);
+    manager_->push(this);
 }
 
 AutoreleasePool::~AutoreleasePool() {
     clear();
-    PoolManager::getInstance().pop();
+    manager_->pop();
 }
 
 void AutoreleasePool::addObject(HObject *object) {
     managerObjectArray_.push_back(object);
+    object->adjustAutoreleaseCount(1);
 }
 
 void AutoreleasePool::clear() {
     std::vector<HObject *> releasings;
     releasings.swap(managerObjectArray_);
     for (const auto &object : releasings) {
+        object->adjustAutoreleaseCount(-1);
         object->release();
     }
+
+    // Releasing can autorelease more objects, keep them for the next clear
+    // and hand the capacity back so the pool does not reallocate every frame.
+    if (managerObjectArray_.empty()) {
+        releasings.clear();
+        managerObjectArray_.swap(releasings);
+    }
 }
 
 bool AutoreleasePool::contains(HObject *object) const {
+    if (!object->isAutoreleased()) {
+        return false;
+    }
+
     for (const auto &_object : managerObjectArray_) {
         if (_object == object) {
             return true;
@@ -42,15 +58,14 @@ bool AutoreleasePool::contains(HObject *object) const {
     return false;
 }
 
-PoolManager PoolManager::instance;
-
 PoolManager &PoolManager::getInstance() {
+    static thread_local PoolManager instance;
     return instance;
 }
 
 PoolManager::PoolManager() {
     releasePoolStack_.reserve(DEFAULTPOOLCOUNT);
-    new AutoreleasePool("default autorelease pool");
+    new AutoreleasePool(this, "default autorelease pool");
 }
 
 PoolManager::~PoolManager() {
@@ -65,11 +80,7 @@ AutoreleasePool* PoolManager::getCurrentPool() const {
 }
 
 bool PoolManager::isObjectInPools(HObject* obj) const {
-    for (const auto& pool : releasePoolStack_) {
-        if (pool->contains(obj))
-            return true;
-    }
-    return false;
+    return obj->isAutoreleased();
 }
 
 void PoolManager::push(AutoreleasePool *pool) {
@@ -6,6 +6,10 @@
 
 #include "BASE/HObject.h"
 
+class PoolManager;
+
+// Pools belong to the thread that creates them and must be destroyed on it,
+// in reverse order of creation.
 class AutoreleasePool final
 {
 public:
@@ -16,13 +20,25 @@ public:
     void addObject(HObject *object);
     void clear();
 
+    // For debug checks, objects in no pool are rejected without scanning, the others cost a
+    // scan of the pool.
     bool contains(HObject *object) const;
 
+    inline uint64 size() const { return managerObjectArray_.size(); }
+
 private:
+    AutoreleasePool(PoolManager *manager, std::string poolName);
+
     std::vector<HObject *> managerObjectArray_;
     std::string poolName_;
+    PoolManager *manager_;
+
+    friend class PoolManager;
 };
 
+// One per thread, each with its own default pool. The default pool of a worker
+// thread is drained when the thread exits, so long running workers should scope
+// their own AutoreleasePool around each task.
 class PoolManager final
 {
 public:
@@ -30,6 +46,7 @@ public:
 
     AutoreleasePool *getCurrentPool() const;
 
+    // True if the object is queued in any thread's pool.
     bool isObjectInPools(HObject *object) const;
 
 private:
@@ -43,7 +60,6 @@ private:
 
 private:
     std::vector<AutoreleasePool*> releasePoolStack_;
-    static PoolManager instance;
 };
 
 #endif // HAUTORELEASEPOOL_H
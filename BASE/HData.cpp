@@ -2,23 +2,53 @@
 
 #include <string.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    void FreeDeallocator(HBYTE *bytes, uint64, void *) {
+        free(bytes);
+    }
+
+    void UnmapDeallocator(HBYTE *bytes, uint64 size, void *) {
+#ifdef _WIN32
+        UNUSED(size);
+        UnmapViewOfFile(bytes);
+#else
+        munmap(bytes, size);
+#endif
+    }
+}
+
 const HData HData::Null;
 
 HData::HData()
-    : bytes_(nullptr)
+    : storage_(nullptr)
+    , bytes_(nullptr)
     , size_(0) {
 }
 
 HData::HData(HData&& other)
-    : bytes_(nullptr)
+    : storage_(nullptr)
+    , bytes_(nullptr)
     , size_(0) {
     move(other);
 }
 
 HData::HData(const HData& other)
-    : bytes_(nullptr)
-    , size_(0) {
-    copy(other.bytes_, other.size_);
+    : storage_(other.storage_)
+    , bytes_(other.bytes_)
+    , size_(other.size_) {
+    if (storage_) {
+        storage_->references.fetch_add(1, std::memory_order_relaxed);
+    }
 }
 
 HData::~HData() {
@@ -26,19 +56,79 @@ HData::~HData() {
 }
 
 HData& HData::operator= (const HData& other) {
-    copy(other.bytes_, other.size_);
+    if (this != &other) {
+        HData copied(other);
+        clear();
+        move(copied);
+    }
     return *this;
 }
 
 HData& HData::operator= (HData&& other) {
-    move(other);
+    if (this != &other) {
+        clear();
+        move(other);
+    }
     return *this;
 }
 
+HData HData::wrap(const HBYTE* bytes, const uint64 size, Deallocator deallocator, void *context) {
+    HData ret;
+    if (bytes && size > 0) {
+        ret.storage_ = createStorage(const_cast<HBYTE*>(bytes), size, deallocator, context, false);
+        ret.bytes_ = ret.storage_->bytes;
+        ret.size_ = size;
+    }
+    else if (bytes && deallocator) {
+        deallocator(const_cast<HBYTE*>(bytes), size, context);
+    }
+    return ret;
+}
+
+HData HData::mapFile(const std::string& path) {
+    HData ret;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return ret;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (view) {
+                ret = wrap((const HBYTE*)view, (uint64)fileSize.QuadPart, UnmapDeallocator);
+            }
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return ret;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode) && fileStat.st_size > 0) {
+        void *view = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED) {
+            ret = wrap((const HBYTE*)view, (uint64)fileStat.st_size, UnmapDeallocator);
+        }
+    }
+    close(fd);
+#endif
+    return ret;
+}
+
 void HData::move(HData& other) {
+    storage_ = other.storage_;
     bytes_ = other.bytes_;
     size_ = other.size_;
 
+    other.storage_ = nullptr;
     other.bytes_ = nullptr;
     other.size_ = 0;
 }
@@ -47,7 +137,7 @@ bool HData::isNull() const {
     return (bytes_ == nullptr || size_ == 0);
 }
 
-HBYTE* HData::getBytes() const {
+const HBYTE* HData::getBytes() const {
     return bytes_;
 }
 
@@ -55,24 +145,80 @@ uint64 HData::getSize() const {
     return size_;
 }
 
+HBYTE* HData::getMutableBytes() {
+    if (storage_ && (!storage_->writable || isShared())) {
+        *this = mutableCopy();
+    }
+    return bytes_;
+}
+
+HData HData::slice(uint64 offset, uint64 length) const {
+    if (offset > size_) {
+        offset = size_;
+    }
+    if (length > size_ - offset) {
+        length = size_ - offset;
+    }
+
+    HData ret;
+    if (length > 0) {
+        ret = *this;
+        ret.bytes_ += offset;
+        ret.size_ = length;
+    }
+    return ret;
+}
+
+HData HData::mutableCopy() const {
+    HData ret;
+    ret.copy(bytes_, size_);
+    return ret;
+}
+
+bool HData::isShared() const {
+    return storage_ && storage_->references.load(std::memory_order_acquire) > 1;
+}
+
 void HData::copy(const HBYTE* bytes, const uint64 size) {
     clear();
 
     if (size > 0) {
-        size_ = size;
-        bytes_ = (HBYTE*)malloc(sizeof(HBYTE) * size_);
-        memcpy(bytes_, bytes, size_);
+        HBYTE *buffer = (HBYTE*)malloc(sizeof(HBYTE) * size);
+        memcpy(buffer, bytes, size);
+        fastSet(buffer, size);
     }
 }
 
 void HData::fastSet(HBYTE* bytes, const uint64 size) {
-    bytes_ = bytes;
-    size_ = size;
+    clear();
+
+    if (bytes) {
+        storage_ = createStorage(bytes, size, FreeDeallocator, nullptr, true);
+        bytes_ = bytes;
+        size_ = size;
+    }
 }
 
 void HData::clear() {
-    free(bytes_);
+    if (storage_ && storage_->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        if (storage_->deallocator) {
+            storage_->deallocator(storage_->bytes, storage_->size, storage_->context);
+        }
+        delete storage_;
+    }
+
+    storage_ = nullptr;
     bytes_ = nullptr;
     size_ = 0;
 }
 
+HData::Storage *HData::createStorage(HBYTE* bytes, uint64 size, Deallocator deallocator, void *context, bool writable) {
+    Storage *storage = new Storage();
+    storage->references.store(1, std::memory_order_relaxed);
+    storage->bytes = bytes;
+    storage->size = size;
+    storage->deallocator = deallocator;
+    storage->context = context;
+    storage->writable = writable;
+    return storage;
+}
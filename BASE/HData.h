@@ -1,11 +1,21 @@
 #ifndef HDATA_H
 #define HDATA_H
 
+#include <atomic>
+#include <string>
+
 #include "BASE/Honey.h"
 
+// Immutable byte buffer with shared storage. Copies and slices only take a reference,
+// the bytes are freed when the last HData using them goes away. Writing goes through
+// getMutableBytes() or mutableCopy(), which copy first when the bytes are shared or
+// not owned. References are counted atomically, an HData may be handed to another thread.
 class HData
 {
 public:
+    // Called once the last reference to wrapped memory is dropped.
+    typedef void (*Deallocator)(HBYTE *bytes, uint64 size, void *context);
+
     static const HData Null;
 
     HData();
@@ -16,18 +26,46 @@ public:
     HData& operator= (const HData& other);
     HData& operator= (HData&& other);
 
-    HBYTE* getBytes() const;
+    // Memory owned by someone else. Without a deallocator the caller keeps it alive
+    // for as long as any HData refers to it.
+    static HData wrap(const HBYTE* bytes, const uint64 size, Deallocator deallocator = nullptr, void *context = nullptr);
+    // Read only mapping of a whole file, Null if the file can't be mapped.
+    static HData mapFile(const std::string& path);
+
+    const HBYTE* getBytes() const;
     uint64 getSize() const;
 
+    // Unshares the bytes first if needed, invalidates pointers from earlier getBytes() calls.
+    HBYTE* getMutableBytes();
+
+    // Shares the storage, offset and length are clamped to this view.
+    HData slice(uint64 offset, uint64 length) const;
+    HData mutableCopy() const;
+    bool isShared() const;
+
     void copy(const HBYTE* bytes, const uint64 size);
+    // Takes ownership of a malloc'ed buffer.
     void fastSet(HBYTE* bytes, const uint64 size);
     void clear();
     bool isNull() const;
 
 private:
+    struct Storage
+    {
+        std::atomic<uint32> references;
+        HBYTE* bytes;
+        uint64 size;
+        Deallocator deallocator;
+        void *context;
+        bool writable;
+    };
+
+    static Storage *createStorage(HBYTE* bytes, uint64 size, Deallocator deallocator, void *context, bool writable);
+
     void move(HData& other);
 
 private:
+    Storage* storage_;
     HBYTE* bytes_;
     uint64 size_;
 };
@@ -3,22 +3,48 @@
 #include "AutoreleasePool.h"
 
 HObject::HObject()
-    : referenceCount_(1) {
+    : referenceCount_(1)
+    , autoreleaseCount_(0)
+    , atomicReferenceCount_(HOBJECT_ATOMIC_REFCOUNT_DEFAULT) {
 
 }
 
+HObject::HObject(const HObject &other)
+    : referenceCount_(1)
+    , autoreleaseCount_(0)
+    , atomicReferenceCount_(other.atomicReferenceCount_) {
+
+}
+
+HObject &HObject::operator=(const HObject &) {
+    return *this;
+}
+
 HObject::~HObject() {
 
 }
 
 void HObject::retain() {
-    ++referenceCount_;
+    if (atomicReferenceCount_) {
+        referenceCount_.fetch_add(1, std::memory_order_relaxed);
+    }
+    else {
+        referenceCount_.store(referenceCount_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
 }
 
 void HObject::release() {
-    --referenceCount_;
+    uint32 count;
+    if (atomicReferenceCount_) {
+        // acq_rel so every write made through other references happens before the delete.
+        count = referenceCount_.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    }
+    else {
+        count = referenceCount_.load(std::memory_order_relaxed) - 1;
+        referenceCount_.store(count, std::memory_order_relaxed);
+    }
 
-    if (referenceCount_ == 0) {
+    if (count == 0) {
         delete this;
     }
 }
@@ -28,8 +54,21 @@ HObject *HObject::autorelease() {
     return this;
 }
 
+void HObject::adjustAutoreleaseCount(int32 delta) {
+    // A saturated count is no longer exact, it stays put and keeps isAutoreleased() true.
+    uint16 count = autoreleaseCount_.load(std::memory_order_relaxed);
+    if (atomicReferenceCount_) {
+        while (count != AUTORELEASE_COUNT_SATURATED &&
+               !autoreleaseCount_.compare_exchange_weak(count, (uint16)(count + delta), std::memory_order_relaxed)) {
+        }
+    }
+    else if (count != AUTORELEASE_COUNT_SATURATED) {
+        autoreleaseCount_.store((uint16)(count + delta), std::memory_order_relaxed);
+    }
+}
+
 uint32 HObject::getReferenceCount() const {
-    return referenceCount_;
+    return referenceCount_.load(std::memory_order_relaxed);
 }
 
 HObjectArray::HObjectArray(int64 capacity) {
@@ -56,7 +95,7 @@ void HObjectArray::doubleCapacity() {
 
 void HObjectArray::ensureExtraCapacity(int64 extra)
 {
-    while (maximum_ < maximum_ + extra) {
+    while (maximum_ < number_ + extra) {
         doubleCapacity();
     }
 }
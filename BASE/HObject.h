@@ -4,6 +4,9 @@
 #include <vector>
 #include <unordered_map>
 #include <algorithm>
+#include <atomic>
+#include <type_traits>
+#include <utility>
 #include "BASE/Honey.h"
 
 #ifndef SAFE_RELEASE
@@ -16,6 +19,14 @@
     #define SAFE_RETAIN(p)     do { if(p) { (p)->retain(); } } while(0)
 #endif
 
+// Define to make every HObject use an atomic reference count.
+// Otherwise types that are shared across threads opt in with setAtomicReferenceCount(true).
+#ifdef HOBJECT_ATOMIC_REFCOUNT
+    #define HOBJECT_ATOMIC_REFCOUNT_DEFAULT true
+#else
+    #define HOBJECT_ATOMIC_REFCOUNT_DEFAULT false
+#endif
+
 class HObject
 {
 public:
@@ -26,18 +37,150 @@ public:
     HObject *autorelease();
 
     uint32 getReferenceCount() const;
+    inline bool isAtomicReferenceCount() const { return atomicReferenceCount_; }
+    // True while a release is queued in any thread's autorelease pool.
+    inline bool isAutoreleased() const { return autoreleaseCount_.load(std::memory_order_relaxed) != 0; }
 
 protected:
     HObject();
+    // A copy is a new object, it starts with its own reference and keeps the counting mode.
+    HObject(const HObject &other);
+    HObject &operator=(const HObject &other);
+
+    // Only from the constructor, before the object is visible to other threads.
+    inline void setAtomicReferenceCount(bool atomic) { atomicReferenceCount_ = atomic; }
 
 private:
-    uint32 referenceCount_;
+    // Always a std::atomic so both modes share one layout, the non atomic mode
+    // uses relaxed load/store pairs that compile to a plain increment.
+    std::atomic<uint32> referenceCount_;
+    // Releases queued in autorelease pools, packed next to the flag to keep HObject at 16 bytes.
+    // Saturates at AUTORELEASE_COUNT_SATURATED pending releases.
+    std::atomic<uint16> autoreleaseCount_;
+    bool atomicReferenceCount_;
+
+    static const uint16 AUTORELEASE_COUNT_SATURATED = 0xFFFF;
+
+    void adjustAutoreleaseCount(int32 delta);
+
+    friend class AutoreleasePool;
 };
 
 typedef void (HObject::*SelectorV)();
 typedef void (HObject::*SelectorO)(HObject*);
 typedef void (HObject::*SelectorF)(float);
 
+// Owning handle that holds one reference on an HObject. Copies retain, moves hand the
+// reference over without touching the count, destruction releases it.
+// Converts to T* so it passes straight to the raw pointer APIs.
+template<class T>
+class HRef
+{
+public:
+    HRef()
+        : object_(nullptr) {
+    }
+
+    HRef(std::nullptr_t)
+        : object_(nullptr) {
+    }
+
+    // Takes a new reference, the caller keeps its own.
+    explicit HRef(T *object)
+        : object_(object) {
+        SAFE_RETAIN(object_);
+    }
+
+    HRef(const HRef<T> &other)
+        : object_(other.object_) {
+        SAFE_RETAIN(object_);
+    }
+
+    HRef(HRef<T> &&other) noexcept
+        : object_(other.object_) {
+        other.object_ = nullptr;
+    }
+
+    template<class U, class = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+    HRef(const HRef<U> &other)
+        : object_(other.get()) {
+        SAFE_RETAIN(object_);
+    }
+
+    template<class U, class = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+    HRef(HRef<U> &&other) noexcept
+        : object_(other.detach()) {
+    }
+
+    ~HRef() {
+        SAFE_RELEASE(object_);
+    }
+
+    // Wraps a reference the caller already owns (a fresh new, or a retain done earlier)
+    // without retaining again.
+    static HRef<T> adopt(T *object) {
+        HRef<T> ref;
+        ref.object_ = object;
+        return ref;
+    }
+
+    HRef<T> &operator=(const HRef<T> &other) {
+        reset(other.object_);
+        return *this;
+    }
+
+    HRef<T> &operator=(HRef<T> &&other) noexcept {
+        if (this != &other) {
+            T *old = object_;
+            object_ = other.object_;
+            other.object_ = nullptr;
+            SAFE_RELEASE(old);
+        }
+        return *this;
+    }
+
+    HRef<T> &operator=(std::nullptr_t) {
+        reset();
+        return *this;
+    }
+
+    // Retains the new object before releasing the old one so assigning an object
+    // that is only kept alive by this handle is safe.
+    void reset(T *object = nullptr) {
+        if (object_ != object) {
+            SAFE_RETAIN(object);
+            T *old = object_;
+            object_ = object;
+            SAFE_RELEASE(old);
+        }
+    }
+
+    // Gives up the reference without releasing it, the caller now owns it.
+    T *detach() {
+        T *object = object_;
+        object_ = nullptr;
+        return object;
+    }
+
+    void swap(HRef<T> &other) {
+        std::swap(object_, other.object_);
+    }
+
+    inline T *get() const { return object_; }
+    inline T *operator->() const { return object_; }
+    inline T &operator*() const { return *object_; }
+    inline operator T*() const { return object_; }
+
+private:
+    T *object_;
+};
+
+// Builds an object owned by the returned handle, skipping the autorelease pool.
+template<class T, class... Args>
+HRef<T> MakeRef(Args&&... args) {
+    return HRef<T>::adopt(new T(std::forward<Args>(args)...));
+}
+
 class HObjectArray
 {
 public:
@@ -90,6 +233,9 @@ public:
     typedef typename std::vector<T>::reverse_iterator reverse_iterator;
     typedef typename std::vector<T>::const_reverse_iterator const_reverse_iterator;
 
+    typedef HRef<typename std::remove_pointer<T>::type> ref_type;
+    typedef int64 std::remove_pointer<T>::type::*index_slot;
+
     iterator begin() { return data_.begin(); }
     const_iterator begin() const { return data_.begin(); }
     iterator end() { return data_.end(); }
@@ -108,11 +254,13 @@ public:
     const_reverse_iterator crend() const { return data_.crend(); }
 
     HObjectVector<T>()
-        : data_() {        
+        : data_()
+        , indexSlot_(nullptr) {
     }
 
     explicit HObjectVector<T>(int64 capacity)
-        : data_() {
+        : data_()
+        , indexSlot_(nullptr) {
         reserve(capacity);
     }
 
@@ -120,13 +268,16 @@ public:
         clear();
     }
 
-    HObjectVector<T>(const HObjectVector<T>& other) {
+    // Copies are never indexed, their elements already keep their place in the original.
+    HObjectVector<T>(const HObjectVector<T>& other)
+        : indexSlot_(nullptr) {
         data_ = other.data_;
         addRefForAllObjects();
     }
 
-    HObjectVector<T>(HObjectVector<T>&& other) {
-        data_ = std::move(other.data_);
+    HObjectVector<T>(HObjectVector<T>&& other) noexcept
+        : data_(std::move(other.data_))
+        , indexSlot_(other.indexSlot_) {
     }
 
     HObjectVector<T>& operator=(const HObjectVector<T>& other) {
@@ -134,18 +285,33 @@ public:
             clear();
             data_ = other.data_;
             addRefForAllObjects();
+            reindex();
         }
         return *this;
     }
 
-    HObjectVector<T>& operator=(HObjectVector<T>&& other) {
+    HObjectVector<T>& operator=(HObjectVector<T>&& other) noexcept {
         if (this != &other) {
             clear();
             data_ = std::move(other.data_);
+            reindex();
         }
         return *this;
     }
 
+    // Indexed mode: each element keeps its position in the given member, which makes
+    // getIndex, find, contains and fastErase O(1). An element may be in one indexed vector
+    // per member at a time. Positions are hints checked before use, after reordering
+    // through the iterators (std::sort) call reindex(), until then lookups search linearly.
+    void setIndexSlot(index_slot slot) {
+        indexSlot_ = slot;
+        reindex();
+    }
+
+    void reindex() {
+        reindexFrom(0);
+    }
+
     void reserve(int64 n) {
         data_.reserve(n);
     }
@@ -167,6 +333,12 @@ public:
     }
 
     int64 getIndex(T object) const {
+        if (indexSlot_ && object) {
+            int64 hint = object->*indexSlot_;
+            if (hint >= 0 && hint < (int64)data_.size() && data_[hint] == object)
+                return hint;
+        }
+
         auto iter = std::find(data_.begin(), data_.end(), object);
         if (iter != data_.end())
             return iter - data_.begin();
@@ -175,11 +347,13 @@ public:
     }
 
     const_iterator find(T object) const {
-        return std::find(data_.begin(), data_.end(), object);
+        int64 index = getIndex(object);
+        return index != -1 ? data_.begin() + index : data_.end();
     }
 
     iterator find(T object) {
-        return std::find(data_.begin(), data_.end(), object);
+        int64 index = getIndex(object);
+        return index != -1 ? data_.begin() + index : data_.end();
     }
 
     T at(int64 index) const {
@@ -204,7 +378,7 @@ public:
     }
 
     bool contains(T object) const {
-        return( std::find(data_.begin(), data_.end(), object) != data_.end() );
+        return getIndex(object) != -1;
     }
 
     bool equals(const HObjectVector<T> &other) {
@@ -223,70 +397,143 @@ public:
 
 
     void pushBack(T object) {
+        setIndexHint(object, data_.size());
         data_.push_back( object );
         object->retain();
     }
 
     void pushBack(const HObjectVector<T>& other) {
         for(const auto &obj : other) {
+            setIndexHint(obj, data_.size());
             data_.push_back(obj);
             obj->retain();
         }
     }
 
+    // Moves the handle's reference into the vector, no retain/release pair.
+    void pushBack(ref_type &&object) {
+        setIndexHint(object.get(), data_.size());
+        data_.push_back(object.get());
+        object.detach();
+    }
+
+    // Takes over every reference held by other and leaves it empty.
+    void pushBack(HObjectVector<T>&& other) {
+        uint64 first = data_.size();
+        if (data_.empty()) {
+            data_ = std::move(other.data_);
+        }
+        else {
+            data_.insert(data_.end(), other.data_.begin(), other.data_.end());
+        }
+        other.data_.clear();
+        reindexFrom(first);
+    }
+
     void insert(int64 index, T object) {
         data_.insert((std::begin(data_) + index), object);
         object->retain();
+        reindexFrom(index);
+    }
+
+    void insert(int64 index, ref_type &&object) {
+        data_.insert((std::begin(data_) + index), object.get());
+        object.detach();
+        reindexFrom(index);
+    }
+
+    // Removes the element and hands its reference to the caller instead of releasing it.
+    ref_type take(int64 index) {
+        T object = data_[index];
+        data_.erase(std::begin(data_) + index);
+        setIndexHint(object, -1);
+        reindexFrom(index);
+        return ref_type::adopt(object);
     }
 
     void popBack() {
         auto last = data_.back();
         data_.pop_back();
+        setIndexHint(last, -1);
         last->release();
     }
 
     void eraseObject(T object, bool removeAll = false) {
         if (removeAll) {
+            bool erased = false;
             for (auto iter = data_.begin(); iter != data_.end();) {
                 if ((*iter) == object) {
                     iter = data_.erase(iter);
+                    if (!erased) {
+                        setIndexHint(object, -1);
+                        erased = true;
+                    }
                     object->release();
                 }
                 else {
                     ++iter;
                 }
             }
+            if (erased) {
+                reindex();
+            }
         }
         else {
-            auto iter = std::find(data_.begin(), data_.end(), object);
-            if (iter != data_.end()) {
-                data_.erase(iter);
-                object->release();
+            int64 index = getIndex(object);
+            if (index != -1) {
+                erase(index);
             }
         }
     }
 
     iterator erase(iterator position) {
-        (*position)->release();
-        return data_.erase(position);
+        return erase(position - data_.begin());
     }
 
     iterator erase(iterator first, iterator last) {
+        int64 index = first - data_.begin();
         for (auto iter = first; iter != last; ++iter) {
+            setIndexHint(*iter, -1);
             (*iter)->release();
         }
 
-        return data_.erase(first, last);
+        data_.erase(first, last);
+        reindexFrom(index);
+        return data_.begin() + index;
     }
 
     iterator erase(int64 index) {
         auto it = std::next( begin(), index );
-        (*it)->release();
-        return data_.erase(it);
+        T object = *it;
+        it = data_.erase(it);
+        setIndexHint(object, -1);
+        object->release();
+        reindexFrom(index);
+        return data_.begin() + index;
+    }
+
+    // Moves the last element into the gap instead of shifting the tail, O(1) but the
+    // order changes. Meant for containers that get sorted anyway, like Node children.
+    void fastErase(int64 index) {
+        T object = data_[index];
+        T last = data_.back();
+        data_[index] = last;
+        setIndexHint(last, index);
+        data_.pop_back();
+        setIndexHint(object, -1);
+        object->release();
+    }
+
+    void fastEraseObject(T object) {
+        int64 index = getIndex(object);
+        if (index != -1) {
+            fastErase(index);
+        }
     }
 
     void clear() {
         for( auto it = std::begin(data_); it != std::end(data_); ++it ) {
+            setIndexHint(*it, -1);
             (*it)->release();
         }
         data_.clear();
@@ -296,21 +543,26 @@ public:
         int64 idx1 = getIndex(object1);
         int64 idx2 = getIndex(object2);
 
-        std::swap( data_[idx1], data_[idx2] );
+        swap(idx1, idx2);
     }
 
     void swap(int64 index1, int64 index2) {
         std::swap( data_[index1], data_[index2] );
+        setIndexHint(data_[index1], index1);
+        setIndexHint(data_[index2], index2);
     }
 
     void replace(int64 index, T object) {
+        setIndexHint(data_[index], -1);
         data_[index]->release();
         data_[index] = object;
+        setIndexHint(object, index);
         object->retain();
     }
 
     void reverse() {
         std::reverse( std::begin(data_), std::end(data_) );
+        reindex();
     }
 
     void shrinkToFit() {
@@ -324,7 +576,22 @@ protected:
         }
     }
 
+    inline void setIndexHint(T object, int64 index) {
+        if (indexSlot_) {
+            object->*indexSlot_ = index;
+        }
+    }
+
+    void reindexFrom(uint64 first) {
+        if (indexSlot_) {
+            for (uint64 i = first; i < data_.size(); ++i) {
+                data_[i]->*indexSlot_ = (int64)i;
+            }
+        }
+    }
+
     std::vector<T> data_;
+    index_slot indexSlot_;
 };
 
 template <class K, class V>
@@ -1,5 +1,7 @@
 #include "HValue.h"
 
+#include <new>
+#include <stdlib.h>
 #include <string.h>
 #include <sstream>
 #include <iomanip>
@@ -9,92 +11,127 @@
 const HValue HValue::Null;
 
 HValue::HValue()
-    : type_(Type::NONE) {
+    : type_(Type::NONE)
+    , flags_(0)
+    , shortLength_(0) {
     memset(&_field, 0, sizeof(_field));
 }
 
 HValue::HValue(unsigned char v)
-    : type_(Type::BYTE) {
+    : type_(Type::BYTE)
+    , flags_(0)
+    , shortLength_(0) {
     _field.byteVal = v;
 }
 
 HValue::HValue(int v)
-    : type_(Type::INTEGER) {
+    : type_(Type::INTEGER)
+    , flags_(0)
+    , shortLength_(0) {
     _field.intVal = v;
 }
 
 HValue::HValue(float v)
-    : type_(Type::FLOAT) {
+    : type_(Type::FLOAT)
+    , flags_(0)
+    , shortLength_(0) {
     _field.floatVal = v;
 }
 
 HValue::HValue(double v)
-    : type_(Type::DOUBLE) {
+    : type_(Type::DOUBLE)
+    , flags_(0)
+    , shortLength_(0) {
     _field.doubleVal = v;
 }
 
 HValue::HValue(bool v)
-    : type_(Type::BOOLEAN) {
+    : type_(Type::BOOLEAN)
+    , flags_(0)
+    , shortLength_(0) {
     _field.boolVal = v;
 }
 
 HValue::HValue(const char* v)
-    : type_(Type::STRING) {
-    _field.strVal = new std::string();
-    if (v) {
-        *_field.strVal = v;
-    }
+    : type_(Type::STRING)
+    , flags_(SHORT_STRING)
+    , shortLength_(0) {
+    setString(v, v ? strlen(v) : 0);
+}
+
+HValue::HValue(const char* v, uint64 length)
+    : type_(Type::STRING)
+    , flags_(SHORT_STRING)
+    , shortLength_(0) {
+    setString(v, length);
 }
 
 HValue::HValue(const std::string& v)
-    : type_(Type::STRING) {
-    _field.strVal = new std::string();
-    *_field.strVal = v;
+    : type_(Type::STRING)
+    , flags_(SHORT_STRING)
+    , shortLength_(0) {
+    setString(v.data(), v.size());
 }
 
 HValue::HValue(const ValueVector& v)
-    : type_(Type::VECTOR) {
+    : type_(Type::VECTOR)
+    , flags_(0)
+    , shortLength_(0) {
     _field.vectorVal = new (std::nothrow) ValueVector();
     *_field.vectorVal = v;
 }
 
 HValue::HValue(ValueVector&& v)
-    : type_(Type::VECTOR) {
+    : type_(Type::VECTOR)
+    , flags_(0)
+    , shortLength_(0) {
     _field.vectorVal = new (std::nothrow) ValueVector();
     *_field.vectorVal = std::move(v);
 }
 
 HValue::HValue(const ValueMap& v)
-    : type_(Type::MAP) {
+    : type_(Type::MAP)
+    , flags_(0)
+    , shortLength_(0) {
     _field.mapVal = new (std::nothrow) ValueMap();
     *_field.mapVal = v;
 }
 
 HValue::HValue(ValueMap&& v)
-    : type_(Type::MAP) {
+    : type_(Type::MAP)
+    , flags_(0)
+    , shortLength_(0) {
     _field.mapVal = new (std::nothrow) ValueMap();
     *_field.mapVal = std::move(v);
 }
 
 HValue::HValue(const ValueMapIntKey& v)
-    : type_(Type::INT_KEY_MAP) {
+    : type_(Type::INT_KEY_MAP)
+    , flags_(0)
+    , shortLength_(0) {
     _field.intKeyMapVal = new (std::nothrow) ValueMapIntKey();
     *_field.intKeyMapVal = v;
 }
 
 HValue::HValue(ValueMapIntKey&& v)
-    : type_(Type::INT_KEY_MAP) {
+    : type_(Type::INT_KEY_MAP)
+    , flags_(0)
+    , shortLength_(0) {
     _field.intKeyMapVal = new (std::nothrow) ValueMapIntKey();
     *_field.intKeyMapVal = std::move(v);
 }
 
 HValue::HValue(const HValue& other)
-    : type_(Type::NONE) {
+    : type_(Type::NONE)
+    , flags_(0)
+    , shortLength_(0) {
     *this = other;
 }
 
-HValue::HValue(HValue&& other)
-    : type_(Type::NONE) {
+HValue::HValue(HValue&& other) noexcept
+    : type_(Type::NONE)
+    , flags_(0)
+    , shortLength_(0) {
     *this = std::move(other);
 }
 
@@ -123,27 +160,15 @@ HValue& HValue::operator= (const HValue& other) {
                 _field.boolVal = other._field.boolVal;
                 break;
             case Type::STRING:
-                if (_field.strVal == nullptr) {
-                    _field.strVal = new std::string();
-                }
-                *_field.strVal = *other._field.strVal;
+                setString(other.getStringChars(), other.getStringLength());
                 break;
             case Type::VECTOR:
-                if (_field.vectorVal == nullptr) {
-                    _field.vectorVal = new (std::nothrow) ValueVector();
-                }
                 *_field.vectorVal = *other._field.vectorVal;
                 break;
             case Type::MAP:
-                if (_field.mapVal == nullptr) {
-                    _field.mapVal = new (std::nothrow) ValueMap();
-                }
                 *_field.mapVal = *other._field.mapVal;
                 break;
             case Type::INT_KEY_MAP:
-                if (_field.intKeyMapVal == nullptr) {
-                    _field.intKeyMapVal = new (std::nothrow) ValueMapIntKey();
-                }
                 *_field.intKeyMapVal = *other._field.intKeyMapVal;
                 break;
             default:
@@ -153,45 +178,21 @@ HValue& HValue::operator= (const HValue& other) {
     return *this;
 }
 
-HValue& HValue::operator= (HValue&& other) {
+HValue& HValue::operator= (HValue&& other) noexcept {
     if (this != &other)
     {
         clear();
-        switch (other.type_) {
-            case Type::BYTE:
-                _field.byteVal = other._field.byteVal;
-                break;
-            case Type::INTEGER:
-                _field.intVal = other._field.intVal;
-                break;
-            case Type::FLOAT:
-                _field.floatVal = other._field.floatVal;
-                break;
-            case Type::DOUBLE:
-                _field.doubleVal = other._field.doubleVal;
-                break;
-            case Type::BOOLEAN:
-                _field.boolVal = other._field.boolVal;
-                break;
-            case Type::STRING:
-                _field.strVal = other._field.strVal;
-                break;
-            case Type::VECTOR:
-                _field.vectorVal = other._field.vectorVal;
-                break;
-            case Type::MAP:
-                _field.mapVal = other._field.mapVal;
-                break;
-            case Type::INT_KEY_MAP:
-                _field.intKeyMapVal = other._field.intKeyMapVal;
-                break;
-            default:
-                break;
-        }
+
+        // Heap storage changes hands as it is.
+        memcpy(&_field, &other._field, sizeof(_field));
         type_ = other.type_;
+        flags_ = other.flags_;
+        shortLength_ = other.shortLength_;
 
         memset(&other._field, 0, sizeof(other._field));
         other.type_ = Type::NONE;
+        other.flags_ = 0;
+        other.shortLength_ = 0;
     }
 
     return *this;
@@ -229,13 +230,13 @@ HValue& HValue::operator= (bool v) {
 
 HValue& HValue::operator= (const char* v) {
     reset(Type::STRING);
-    *_field.strVal = v ? v : "";
+    setString(v, v ? strlen(v) : 0);
     return *this;
 }
 
 HValue& HValue::operator= (const std::string& v) {
     reset(Type::STRING);
-    *_field.strVal = v;
+    setString(v.data(), v.size());
     return *this;
 }
 
@@ -295,7 +296,8 @@ bool HValue::operator== (const HValue& v) const {
     case Type::BYTE:    return v._field.byteVal   == this->_field.byteVal;
     case Type::INTEGER: return v._field.intVal    == this->_field.intVal;
     case Type::BOOLEAN: return v._field.boolVal   == this->_field.boolVal;
-    case Type::STRING:  return *v._field.strVal   == *this->_field.strVal;
+    case Type::STRING:  return v.getStringLength() == this->getStringLength() &&
+                               memcmp(v.getStringChars(), this->getStringChars(), this->getStringLength()) == 0;
     case Type::FLOAT:   return fabs(v._field.floatVal  - this->_field.floatVal)  <= MATH::MATH_FLOAT_EPSILON();
     case Type::DOUBLE:  return fabs(v._field.doubleVal - this->_field.doubleVal) <= MATH::MATH_FLOAT_EPSILON();
     case Type::VECTOR: {
@@ -351,7 +353,7 @@ unsigned char HValue::asByte() const
     }
 
     if (type_ == Type::STRING) {
-        return static_cast<unsigned char>(atoi(_field.strVal->c_str()));
+        return static_cast<unsigned char>(atoi(getStringChars()));
     }
 
     if (type_ == Type::FLOAT) {
@@ -379,7 +381,7 @@ int HValue::asInt() const {
     }
 
     if (type_ == Type::STRING) {
-        return atoi(_field.strVal->c_str());
+        return atoi(getStringChars());
     }
 
     if (type_ == Type::FLOAT) {
@@ -408,7 +410,7 @@ float HValue::asFloat() const
     }
 
     if (type_ == Type::STRING) {
-        return atof(_field.strVal->c_str());
+        return atof(getStringChars());
     }
 
     if (type_ == Type::INTEGER) {
@@ -436,7 +438,7 @@ double HValue::asDouble() const {
     }
 
     if (type_ == Type::STRING) {
-        return static_cast<double>(atof(_field.strVal->c_str()));
+        return static_cast<double>(atof(getStringChars()));
     }
 
     if (type_ == Type::INTEGER) {
@@ -464,7 +466,7 @@ bool HValue::asBool() const {
     }
 
     if (type_ == Type::STRING) {
-        return (*_field.strVal == "0" || *_field.strVal == "false") ? false : true;
+        return (strcmp(getStringChars(), "0") == 0 || strcmp(getStringChars(), "false") == 0) ? false : true;
     }
 
     if (type_ == Type::INTEGER) {
@@ -485,7 +487,7 @@ bool HValue::asBool() const {
 std::string HValue::asString() const
 {
     if (type_ == Type::STRING) {
-        return *_field.strVal;
+        return std::string(getStringChars(), getStringLength());
     }
 
     std::stringstream ret;
@@ -521,18 +523,48 @@ const ValueVector& HValue::asValueVector() const {
 }
 
 ValueMap& HValue::asValueMap() {
+    if (type_ == Type::NONE) {
+        *this = ValueMap();
+    }
+
+    if (type_ != Type::MAP) {
+        throw _HException_Normal("HValue::asValueMap value is not a map");
+    }
     return *_field.mapVal;
 }
 
 const ValueMap& HValue::asValueMap() const {
+    static const ValueMap empty;
+    if (type_ == Type::NONE) {
+        return empty;
+    }
+
+    if (type_ != Type::MAP) {
+        throw _HException_Normal("HValue::asValueMap value is not a map");
+    }
     return *_field.mapVal;
 }
 
 ValueMapIntKey& HValue::asIntKeyMap() {
+    if (type_ == Type::NONE) {
+        *this = ValueMapIntKey();
+    }
+
+    if (type_ != Type::INT_KEY_MAP) {
+        throw _HException_Normal("HValue::asIntKeyMap value is not an int key map");
+    }
     return *_field.intKeyMapVal;
 }
 
 const ValueMapIntKey& HValue::asIntKeyMap() const {
+    static const ValueMapIntKey empty;
+    if (type_ == Type::NONE) {
+        return empty;
+    }
+
+    if (type_ != Type::INT_KEY_MAP) {
+        throw _HException_Normal("HValue::asIntKeyMap value is not an int key map");
+    }
     return *_field.intKeyMapVal;
 }
 
@@ -540,38 +572,28 @@ void HValue::clear()
 {
     // Free memory the old HValue allocated
     switch (type_) {
-        case Type::BYTE:
-            _field.byteVal = 0;
-            break;
-        case Type::INTEGER:
-            _field.intVal = 0;
-            break;
-        case Type::FLOAT:
-            _field.floatVal = 0.0f;
-            break;
-        case Type::DOUBLE:
-            _field.doubleVal = 0.0;
-            break;
-        case Type::BOOLEAN:
-            _field.boolVal = false;
-            break;
         case Type::STRING:
-            SAFE_DELETE(_field.strVal);
+            if (!(flags_ & SHORT_STRING)) {
+                free(_field.longStrVal.chars);
+            }
             break;
         case Type::VECTOR:
-            SAFE_DELETE(_field.vectorVal);
+            delete _field.vectorVal;
             break;
         case Type::MAP:
-            SAFE_DELETE(_field.mapVal);
+            delete _field.mapVal;
             break;
         case Type::INT_KEY_MAP:
-            SAFE_DELETE(_field.intKeyMapVal);
+            delete _field.intKeyMapVal;
             break;
         default:
             break;
     }
 
+    memset(&_field, 0, sizeof(_field));
     type_ = Type::NONE;
+    flags_ = 0;
+    shortLength_ = 0;
 }
 
 void HValue::reset(Type type) {
@@ -583,7 +605,7 @@ void HValue::reset(Type type) {
     // Allocate memory for the new HValue
     switch (type) {
         case Type::STRING:
-            _field.strVal = new std::string();
+            flags_ = SHORT_STRING;
             break;
         case Type::VECTOR:
             _field.vectorVal = new (std::nothrow) ValueVector();
@@ -601,3 +623,32 @@ void HValue::reset(Type type) {
     type_ = type;
 }
 
+void HValue::setString(const char *chars, uint64 length) {
+    // chars may point into the string being replaced, release it last.
+    char *oldChars = (flags_ & SHORT_STRING) ? nullptr : _field.longStrVal.chars;
+
+    if (length <= SHORT_STRING_CAPACITY) {
+        char shortChars[SHORT_STRING_CAPACITY + 1] = {};
+        if (length > 0) {
+            memcpy(shortChars, chars, length);
+        }
+        memcpy(_field.shortStrVal, shortChars, sizeof(shortChars));
+        shortLength_ = (uint8)length;
+        flags_ = SHORT_STRING;
+    }
+    else {
+        char *longChars = (char *)malloc(length + 1);
+        if (!longChars) {
+            throw std::bad_alloc();
+        }
+        memcpy(longChars, chars, length);
+        longChars[length] = '\0';
+
+        _field.longStrVal.chars = longChars;
+        _field.longStrVal.length = length;
+        shortLength_ = 0;
+        flags_ = 0;
+    }
+
+    free(oldChars);
+}
@@ -3,6 +3,7 @@
 
 #include "BASE/Honey.h"
 
+#include <string>
 #include <vector>
 #include <unordered_map>
 
@@ -25,6 +26,7 @@ public:
     explicit HValue(double v);
     explicit HValue(bool v);
     explicit HValue(const char* v);
+    HValue(const char* v, uint64 length);
     explicit HValue(const std::string& v);
     explicit HValue(const ValueVector& v);
     explicit HValue(ValueVector&& v);
@@ -33,11 +35,11 @@ public:
     explicit HValue(const ValueMapIntKey& v);
     explicit HValue(ValueMapIntKey&& v);
     HValue(const HValue& other);
-    HValue(HValue&& other);
+    HValue(HValue&& other) noexcept;
     ~HValue();
 
     HValue& operator= (const HValue& other);
-    HValue& operator= (HValue&& other);
+    HValue& operator= (HValue&& other) noexcept;
     HValue& operator= (unsigned char v);
     HValue& operator= (int v);
     HValue& operator= (float v);
@@ -67,6 +69,7 @@ public:
     ValueVector& asValueVector();
     const ValueVector& asValueVector() const;
 
+    // Null values read as empty maps, other types throw.
     ValueMap& asValueMap();
     const ValueMap& asValueMap() const;
 
@@ -75,7 +78,7 @@ public:
 
     inline bool isNull() const { return type_ == Type::NONE; }
 
-    enum class Type
+    enum class Type : uint8
     {
         /// no value is wrapped, an empty Value
         NONE = 0,
@@ -101,10 +104,22 @@ public:
 
     inline Type getType() const { return type_; }
 
+    // Strings up to this length are stored inside the HValue.
+    static const uint64 SHORT_STRING_CAPACITY = 15;
+
 private:
     void clear();
     void reset(Type type);
 
+    void setString(const char *chars, uint64 length);
+    inline const char *getStringChars() const { return (flags_ & SHORT_STRING) ? _field.shortStrVal : _field.longStrVal.chars; }
+    inline uint64 getStringLength() const { return (flags_ & SHORT_STRING) ? shortLength_ : _field.longStrVal.length; }
+
+    enum StorageFlags : uint8
+    {
+        SHORT_STRING = 1
+    };
+
     union
     {
         unsigned char byteVal;
@@ -113,13 +128,21 @@ private:
         double doubleVal;
         bool boolVal;
 
-        std::string* strVal;
+        struct
+        {
+            char *chars;
+            uint64 length;
+        } longStrVal;
+        char shortStrVal[SHORT_STRING_CAPACITY + 1];
+
         ValueVector* vectorVal;
         ValueMap* mapVal;
         ValueMapIntKey* intKeyMapVal;
     }_field;
 
     Type type_;
+    uint8 flags_;
+    uint8 shortLength_;
 };
 
 #endif // HVALUE_H
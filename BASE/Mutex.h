@@ -20,6 +20,12 @@
 #include <sys/time.h>
 #endif
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string.h>
+#include <type_traits>
+
 #include "BASE/Honey.h"
 
 class recursive_mutex
@@ -91,5 +97,395 @@ private:
     recursive_mutex &mtx_;
 };
 
+// Tells the core we are busy waiting, eases the pipeline and the sibling hyperthread.
+inline void cpu_relax() {
+#if defined(_WIN32) && (defined(_M_IX86) || defined(_M_X64))
+    _mm_pause();
+#elif defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || (defined(__ARM_ARCH) && __ARM_ARCH >= 7)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Counters of the locks below, they only grow. contended counts acquisitions that found
+// the lock taken, waits counts threads put to sleep, or seqlock reads that had to retry.
+struct lock_stats
+{
+    uint64 acquisitions;
+    uint64 contended;
+    uint64 waits;
+};
+
+// Define HONEY_DISABLE_LOCK_COUNTERS to compile the counting out.
+class lock_counters
+{
+public:
+    lock_counters()
+        : acquisitions_(0)
+        , contended_(0)
+        , waits_(0) {
+    }
+
+    inline void acquired() { add(acquisitions_); }
+    inline void contended() { add(contended_); }
+    inline void waited() { add(waits_); }
+
+    lock_stats snapshot() const {
+        lock_stats stats;
+        stats.acquisitions = acquisitions_.load(std::memory_order_relaxed);
+        stats.contended = contended_.load(std::memory_order_relaxed);
+        stats.waits = waits_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    static inline void add(std::atomic<uint64> &counter) {
+#ifndef HONEY_DISABLE_LOCK_COUNTERS
+        counter.fetch_add(1, std::memory_order_relaxed);
+#else
+        UNUSED(counter);
+#endif
+    }
+
+    std::atomic<uint64> acquisitions_;
+    std::atomic<uint64> contended_;
+    std::atomic<uint64> waits_;
+};
+
+// Many readers or one writer, not recursive. Writers are preferred where the platform
+// allows it, so a steady stream of readers can't starve them.
+class shared_mutex
+{
+#ifdef _WIN32
+    typedef SRWLOCK mutexType;
+#else
+    typedef pthread_rwlock_t mutexType;
+#endif
+public:
+    shared_mutex() {
+#ifdef _WIN32
+        InitializeSRWLock(&mut_);
+#else
+        pthread_rwlockattr_t attr;
+        pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+        pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+        pthread_rwlock_init(&mut_, &attr);
+        pthread_rwlockattr_destroy(&attr);
+#endif
+    }
+    ~shared_mutex() {
+#ifndef _WIN32
+        pthread_rwlock_destroy(&mut_);
+#endif
+    }
+
+    bool try_lock() {
+#ifdef _WIN32
+        bool locked = TryAcquireSRWLockExclusive(&mut_) != FALSE;
+#else
+        bool locked = pthread_rwlock_trywrlock(&mut_) == 0;
+#endif
+        if (locked) {
+            counters_.acquired();
+        }
+        return locked;
+    }
+
+    void lock() {
+        if (try_lock()) {
+            return;
+        }
+        counters_.contended();
+        counters_.waited();
+#ifdef _WIN32
+        AcquireSRWLockExclusive(&mut_);
+#else
+        pthread_rwlock_wrlock(&mut_);
+#endif
+        counters_.acquired();
+    }
+
+    void unlock() {
+#ifdef _WIN32
+        ReleaseSRWLockExclusive(&mut_);
+#else
+        pthread_rwlock_unlock(&mut_);
+#endif
+    }
+
+    bool try_lock_shared() {
+#ifdef _WIN32
+        bool locked = TryAcquireSRWLockShared(&mut_) != FALSE;
+#else
+        bool locked = pthread_rwlock_tryrdlock(&mut_) == 0;
+#endif
+        if (locked) {
+            counters_.acquired();
+        }
+        return locked;
+    }
+
+    void lock_shared() {
+        if (try_lock_shared()) {
+            return;
+        }
+        counters_.contended();
+        counters_.waited();
+#ifdef _WIN32
+        AcquireSRWLockShared(&mut_);
+#else
+        pthread_rwlock_rdlock(&mut_);
+#endif
+        counters_.acquired();
+    }
+
+    void unlock_shared() {
+#ifdef _WIN32
+        ReleaseSRWLockShared(&mut_);
+#else
+        pthread_rwlock_unlock(&mut_);
+#endif
+    }
+
+    lock_stats stats() const {
+        return counters_.snapshot();
+    }
+
+    mutexType &native_handle() {
+        return mut_;
+    }
+
+private:
+    mutexType mut_;
+    lock_counters counters_;
+
+    shared_mutex(const shared_mutex &other);
+    shared_mutex &operator=(const shared_mutex &other);
+};
+
+template<class Mutex>
+class shared_lock_guard {
+public:
+    shared_lock_guard(Mutex &mtx) : mtx_(mtx) {mtx_.lock_shared();}
+    ~shared_lock_guard() {mtx_.unlock_shared();}
+
+private:
+    Mutex &mtx_;
+
+    shared_lock_guard(const shared_lock_guard &other);
+    shared_lock_guard &operator=(const shared_lock_guard &other);
+};
+
+// Exclusive lock for short critical sections. A contended lock() spins with exponential
+// backoff first, most holders let go within that time, and only then parks the thread
+// on a condition variable. unlock() touches the condition variable only when someone
+// parked. Not recursive, works with std::lock_guard and std::unique_lock.
+class adaptive_mutex
+{
+public:
+    // Pauses of the last spin round, the rounds double from 1, about 2us on desktop cores.
+    static const uint32 MAX_BACKOFF = 64;
+
+    adaptive_mutex()
+        : state_(UNLOCKED) {
+    }
+
+    bool try_lock() {
+        uint32 expected = UNLOCKED;
+        if (state_.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire, std::memory_order_relaxed)) {
+            counters_.acquired();
+            return true;
+        }
+        return false;
+    }
+
+    void lock() {
+        if (!try_lock()) {
+            lockContended();
+        }
+    }
+
+    void unlock() {
+        if (state_.exchange(UNLOCKED, std::memory_order_release) == LOCKED_PARKED) {
+            std::lock_guard<std::mutex> park(parkMutex_);
+            parked_.notify_one();
+        }
+    }
+
+    lock_stats stats() const {
+        return counters_.snapshot();
+    }
+
+private:
+    enum : uint32
+    {
+        UNLOCKED = 0,
+        LOCKED,
+        // Locked, and threads may be parked.
+        LOCKED_PARKED
+    };
+
+    void lockContended() {
+        counters_.contended();
+
+        for (uint32 backoff = 1; backoff <= MAX_BACKOFF; backoff <<= 1) {
+            for (uint32 i = 0; i < backoff; ++i) {
+                cpu_relax();
+            }
+
+            uint32 expected = UNLOCKED;
+            if (state_.load(std::memory_order_relaxed) == UNLOCKED &&
+                state_.compare_exchange_weak(expected, LOCKED, std::memory_order_acquire, std::memory_order_relaxed)) {
+                counters_.acquired();
+                return;
+            }
+        }
+
+        // Taking the lock as LOCKED_PARKED is conservative, it may cost one spare notify.
+        std::unique_lock<std::mutex> park(parkMutex_);
+        while (state_.exchange(LOCKED_PARKED, std::memory_order_acquire) != UNLOCKED) {
+            counters_.waited();
+            parked_.wait(park);
+        }
+        counters_.acquired();
+    }
+
+    std::atomic<uint32> state_;
+    lock_counters counters_;
+    std::mutex parkMutex_;
+    std::condition_variable parked_;
+
+    adaptive_mutex(const adaptive_mutex &other);
+    adaptive_mutex &operator=(const adaptive_mutex &other);
+};
+
+// Sequence lock for small read-mostly data. Readers never write shared memory, they copy
+// the data and retry if a writer got in between:
+//
+//     uint32 sequence;
+//     do {
+//         sequence = lock.read_begin();
+//         ... read ...
+//     } while (lock.read_retry(sequence));
+//
+// Writers exclude each other by spinning and must not take long. The data has to be
+// read with relaxed atomics to be race free, seqlock_value does that for plain structs.
+class seqlock
+{
+public:
+    seqlock()
+        : sequence_(0) {
+    }
+
+    uint32 read_begin() const {
+        uint32 sequence = sequence_.load(std::memory_order_acquire);
+        while (sequence & 1) {
+            cpu_relax();
+            sequence = sequence_.load(std::memory_order_acquire);
+        }
+        return sequence;
+    }
+
+    bool read_retry(uint32 sequence) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) == sequence) {
+            return false;
+        }
+        counters_.waited();
+        return true;
+    }
+
+    void write_lock() {
+        uint32 sequence = sequence_.load(std::memory_order_relaxed);
+        bool contended = false;
+        while ((sequence & 1) ||
+               !sequence_.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            contended = true;
+            cpu_relax();
+            sequence = sequence_.load(std::memory_order_relaxed);
+        }
+        // Readers seeing any of the new data also see the odd sequence.
+        std::atomic_thread_fence(std::memory_order_release);
+
+        if (contended) {
+            counters_.contended();
+        }
+        counters_.acquired();
+    }
+
+    void write_unlock() {
+        sequence_.fetch_add(1, std::memory_order_release);
+    }
+
+    lock_stats stats() const {
+        return counters_.snapshot();
+    }
+
+private:
+    std::atomic<uint32> sequence_;
+    mutable lock_counters counters_;
+
+    seqlock(const seqlock &other);
+    seqlock &operator=(const seqlock &other);
+};
+
+// A trivially copyable value behind a seqlock, load() never blocks a writer.
+template<class T>
+class seqlock_value
+{
+    static_assert(std::is_trivially_copyable<T>::value, "seqlock_value needs a trivially copyable type");
+
+public:
+    seqlock_value() {
+        for (auto &word : words_) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    explicit seqlock_value(const T &value)
+        : seqlock_value() {
+        store(value);
+    }
+
+    T load() const {
+        uint64 words[WORD_COUNT];
+        uint32 sequence;
+        do {
+            sequence = lock_.read_begin();
+            for (uint64 i = 0; i < WORD_COUNT; ++i) {
+                words[i] = words_[i].load(std::memory_order_relaxed);
+            }
+        } while (lock_.read_retry(sequence));
+
+        T value;
+        memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+    void store(const T &value) {
+        uint64 words[WORD_COUNT] = {};
+        memcpy(words, &value, sizeof(T));
+
+        lock_.write_lock();
+        for (uint64 i = 0; i < WORD_COUNT; ++i) {
+            words_[i].store(words[i], std::memory_order_relaxed);
+        }
+        lock_.write_unlock();
+    }
+
+    lock_stats stats() const {
+        return lock_.stats();
+    }
+
+private:
+    static const uint64 WORD_COUNT = (sizeof(T) + sizeof(uint64) - 1) / sizeof(uint64);
+
+    seqlock lock_;
+    std::atomic<uint64> words_[WORD_COUNT];
+};
+
 #endif // MUTEX_H
 
@@ -0,0 +1,325 @@
+#include <atomic>
+#include <mutex>
+#include <stdlib.h>
+#include "SlabAllocator.h"
+
+namespace
+{
+    // 16 byte steps up to 256, then four steps per power of two up to 2048.
+    const uint32 SIZE_CLASS_COUNT = 28;
+    const uint64 SLAB_SIZE = 64 * 1024;
+
+    inline uint32 SizeClassIndex(uint64 size) {
+        if (size <= 256) {
+            return size == 0 ? 0 : (uint32)((size - 1) >> 4);
+        }
+
+        uint32 band = 8;
+        while (((size - 1) >> (band + 1)) != 0) {
+            ++band;
+        }
+        return 16 + (band - 8) * 4 + (uint32)((size - 1 - ((uint64)1 << band)) >> (band - 2));
+    }
+
+    inline uint64 SizeClassBlockSize(uint32 index) {
+        if (index < 16) {
+            return (index + 1) * 16;
+        }
+
+        uint32 band = 8 + (index - 16) / 4;
+        return ((uint64)1 << band) + ((index - 16) % 4 + 1) * ((uint64)1 << (band - 2));
+    }
+
+    // Blocks moved between a thread cache and the depot at once, about 8KB worth.
+    inline uint32 SizeClassBatch(uint32 index) {
+        uint64 count = 8192 / SizeClassBlockSize(index);
+        return (uint32)(count < 4 ? 4 : (count > 64 ? 64 : count));
+    }
+
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    struct Depot
+    {
+        std::mutex mutex;
+        FreeBlock *freeList = nullptr;
+        uint64 freeCount = 0;
+        uint64 slabs = 0;
+        uint64 transfers = 0;
+    };
+
+    struct ClassCache
+    {
+        FreeBlock *freeList = nullptr;
+        uint32 freeCount = 0;
+        // Written only by the owning thread, atomic so getStats can read them.
+        std::atomic<uint64> allocations;
+        std::atomic<uint64> deallocations;
+
+        ClassCache()
+            : allocations(0)
+            , deallocations(0) {
+        }
+    };
+
+    struct ThreadCache;
+
+    struct SlabState
+    {
+        Depot depots[SIZE_CLASS_COUNT];
+
+        std::mutex registryMutex;
+        std::vector<ThreadCache *> threadCaches;
+        uint64 retiredAllocations[SIZE_CLASS_COUNT] = {};
+        uint64 retiredDeallocations[SIZE_CLASS_COUNT] = {};
+
+        std::atomic<uint64> largeAllocations;
+        std::atomic<uint64> largeDeallocations;
+
+        SlabState()
+            : largeAllocations(0)
+            , largeDeallocations(0) {
+        }
+    };
+
+    // Never destroyed, objects are still deleted during static destruction.
+    SlabState &GetState() {
+        static SlabState *state = new SlabState();
+        return *state;
+    }
+
+    inline void Increment(std::atomic<uint64> &counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Caller holds depot.mutex.
+    void GrowDepot(Depot &depot, uint32 index) {
+        uint64 blockSize = SizeClassBlockSize(index);
+        uint8 *slab = (uint8 *)malloc(SLAB_SIZE);
+        if (!slab) {
+            throw std::bad_alloc();
+        }
+
+        uint64 count = SLAB_SIZE / blockSize;
+        for (uint64 i = count; i > 0; --i) {
+            FreeBlock *block = (FreeBlock *)(slab + (i - 1) * blockSize);
+            block->next = depot.freeList;
+            depot.freeList = block;
+        }
+        depot.freeCount += count;
+        ++depot.slabs;
+    }
+
+    __THREAD ThreadCache *threadCache_ = nullptr;
+    __THREAD bool threadCacheDestroyed_ = false;
+
+    struct ThreadCache
+    {
+        ClassCache classes[SIZE_CLASS_COUNT];
+
+        ThreadCache() {
+            SlabState &state = GetState();
+            std::lock_guard<std::mutex> lock(state.registryMutex);
+            state.threadCaches.push_back(this);
+            threadCache_ = this;
+        }
+
+        ~ThreadCache() {
+            threadCache_ = nullptr;
+            threadCacheDestroyed_ = true;
+
+            SlabState &state = GetState();
+            for (uint32 index = 0; index < SIZE_CLASS_COUNT; ++index) {
+                ClassCache &cache = classes[index];
+                if (cache.freeList) {
+                    FreeBlock *last = cache.freeList;
+                    while (last->next) {
+                        last = last->next;
+                    }
+
+                    Depot &depot = state.depots[index];
+                    std::lock_guard<std::mutex> lock(depot.mutex);
+                    last->next = depot.freeList;
+                    depot.freeList = cache.freeList;
+                    depot.freeCount += cache.freeCount;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(state.registryMutex);
+            for (uint32 index = 0; index < SIZE_CLASS_COUNT; ++index) {
+                state.retiredAllocations[index] += classes[index].allocations.load(std::memory_order_relaxed);
+                state.retiredDeallocations[index] += classes[index].deallocations.load(std::memory_order_relaxed);
+            }
+            for (auto iter = state.threadCaches.begin(); iter != state.threadCaches.end(); ++iter) {
+                if (*iter == this) {
+                    state.threadCaches.erase(iter);
+                    break;
+                }
+            }
+        }
+    };
+
+    // Null once the thread's cache has been destroyed, callers then go to the depot directly.
+    inline ThreadCache *GetThreadCache() {
+        ThreadCache *cache = threadCache_;
+        if (cache || threadCacheDestroyed_) {
+            return cache;
+        }
+
+        static thread_local ThreadCache threadCache;
+        return &threadCache;
+    }
+
+    void Refill(ClassCache &cache, uint32 index) {
+        Depot &depot = GetState().depots[index];
+        uint32 batch = SizeClassBatch(index);
+
+        std::lock_guard<std::mutex> lock(depot.mutex);
+        if (depot.freeCount < batch) {
+            GrowDepot(depot, index);
+        }
+
+        FreeBlock *first = depot.freeList;
+        FreeBlock *last = first;
+        for (uint32 i = 1; i < batch; ++i) {
+            last = last->next;
+        }
+        depot.freeList = last->next;
+        depot.freeCount -= batch;
+        ++depot.transfers;
+
+        last->next = cache.freeList;
+        cache.freeList = first;
+        cache.freeCount += batch;
+    }
+
+    void Drain(ClassCache &cache, uint32 index) {
+        uint32 batch = SizeClassBatch(index);
+
+        FreeBlock *first = cache.freeList;
+        FreeBlock *last = first;
+        for (uint32 i = 1; i < batch; ++i) {
+            last = last->next;
+        }
+        cache.freeList = last->next;
+        cache.freeCount -= batch;
+
+        Depot &depot = GetState().depots[index];
+        std::lock_guard<std::mutex> lock(depot.mutex);
+        last->next = depot.freeList;
+        depot.freeList = first;
+        depot.freeCount += batch;
+        ++depot.transfers;
+    }
+}
+
+void *SlabAllocator::allocate(uint64 size) {
+    if (size > MAX_BLOCK_SIZE) {
+        GetState().largeAllocations.fetch_add(1, std::memory_order_relaxed);
+        return ::operator new(size);
+    }
+
+    uint32 index = SizeClassIndex(size);
+    ThreadCache *threadCache = GetThreadCache();
+    if (!threadCache) {
+        Depot &depot = GetState().depots[index];
+        std::lock_guard<std::mutex> lock(depot.mutex);
+        if (!depot.freeList) {
+            GrowDepot(depot, index);
+        }
+        FreeBlock *block = depot.freeList;
+        depot.freeList = block->next;
+        --depot.freeCount;
+        return block;
+    }
+
+    ClassCache &cache = threadCache->classes[index];
+    if (!cache.freeList) {
+        Refill(cache, index);
+    }
+
+    FreeBlock *block = cache.freeList;
+    cache.freeList = block->next;
+    --cache.freeCount;
+    Increment(cache.allocations);
+    return block;
+}
+
+void *SlabAllocator::allocate(uint64 size, const std::nothrow_t &) noexcept {
+    try {
+        return allocate(size);
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+void SlabAllocator::deallocate(void *pointer, uint64 size) noexcept {
+    if (!pointer) {
+        return;
+    }
+
+    if (size > MAX_BLOCK_SIZE) {
+        GetState().largeDeallocations.fetch_add(1, std::memory_order_relaxed);
+        ::operator delete(pointer);
+        return;
+    }
+
+    uint32 index = SizeClassIndex(size);
+    FreeBlock *block = (FreeBlock *)pointer;
+    ThreadCache *threadCache = GetThreadCache();
+    if (!threadCache) {
+        Depot &depot = GetState().depots[index];
+        std::lock_guard<std::mutex> lock(depot.mutex);
+        block->next = depot.freeList;
+        depot.freeList = block;
+        ++depot.freeCount;
+        return;
+    }
+
+    ClassCache &cache = threadCache->classes[index];
+    block->next = cache.freeList;
+    cache.freeList = block;
+    ++cache.freeCount;
+    Increment(cache.deallocations);
+
+    if (cache.freeCount > 2 * SizeClassBatch(index)) {
+        Drain(cache, index);
+    }
+}
+
+void SlabAllocator::getStats(Stats &stats) {
+    SlabState &state = GetState();
+
+    stats.sizeClasses.resize(SIZE_CLASS_COUNT);
+    stats.reservedBytes = 0;
+    for (uint32 index = 0; index < SIZE_CLASS_COUNT; ++index) {
+        SizeClassStats &classStats = stats.sizeClasses[index];
+        classStats.blockSize = SizeClassBlockSize(index);
+
+        Depot &depot = state.depots[index];
+        std::lock_guard<std::mutex> lock(depot.mutex);
+        classStats.depotTransfers = depot.transfers;
+        classStats.slabs = depot.slabs;
+        classStats.reservedBytes = depot.slabs * SLAB_SIZE;
+        stats.reservedBytes += classStats.reservedBytes;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state.registryMutex);
+        for (uint32 index = 0; index < SIZE_CLASS_COUNT; ++index) {
+            SizeClassStats &classStats = stats.sizeClasses[index];
+            classStats.allocations = state.retiredAllocations[index];
+            classStats.deallocations = state.retiredDeallocations[index];
+            for (const auto &threadCache : state.threadCaches) {
+                classStats.allocations += threadCache->classes[index].allocations.load(std::memory_order_relaxed);
+                classStats.deallocations += threadCache->classes[index].deallocations.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    stats.largeAllocations = state.largeAllocations.load(std::memory_order_relaxed);
+    stats.largeDeallocations = state.largeDeallocations.load(std::memory_order_relaxed);
+}
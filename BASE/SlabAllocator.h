@@ -0,0 +1,62 @@
+#ifndef SLABALLOCATOR_H
+#define SLABALLOCATOR_H
+
+#include <new>
+#include <vector>
+
+#include "BASE/Honey.h"
+
+// Size class allocator for small, frequently created objects. Blocks come from 64KB
+// slabs, each thread keeps a free list per size class and trades blocks with the
+// shared depot in batches, so most allocations never take a lock or call malloc.
+// Requests above MAX_BLOCK_SIZE go to the global operator new. Slabs are kept for
+// reuse for the life of the process.
+class SlabAllocator final
+{
+public:
+    static const uint64 MAX_BLOCK_SIZE = 2048;
+
+    struct SizeClassStats
+    {
+        uint64 blockSize;
+        uint64 allocations;
+        uint64 deallocations;
+        uint64 depotTransfers;   // batches moved between thread caches and the depot
+        uint64 slabs;
+        uint64 reservedBytes;
+    };
+
+    struct Stats
+    {
+        std::vector<SizeClassStats> sizeClasses;
+        uint64 largeAllocations;
+        uint64 largeDeallocations;
+        uint64 reservedBytes;
+    };
+
+    static void *allocate(uint64 size);
+    static void *allocate(uint64 size, const std::nothrow_t &) noexcept;
+    // size must be the size passed to allocate.
+    static void deallocate(void *pointer, uint64 size) noexcept;
+
+    // Counters of threads still running are read while they allocate, the totals are approximate.
+    static void getStats(Stats &stats);
+};
+
+// Placed at the top of a class body, routes new/delete of the class and everything derived
+// from it through SlabAllocator. Polymorphic classes need a virtual destructor so delete
+// sees the size of the dynamic type. Leaves the following members public.
+// There is no sized placement delete to pair with the nothrow form, a constructor
+// that throws after new (std::nothrow) leaks its block.
+#ifdef HONEY_DISABLE_SLAB_ALLOCATOR
+#define USE_SLAB_ALLOCATOR() \
+public:
+#else
+#define USE_SLAB_ALLOCATOR() \
+public: \
+    static void *operator new(size_t size) { return SlabAllocator::allocate(size); } \
+    static void *operator new(size_t size, const std::nothrow_t &tag) noexcept { return SlabAllocator::allocate(size, tag); } \
+    static void operator delete(void *pointer, size_t size) noexcept { SlabAllocator::deallocate(pointer, size); }
+#endif
+
+#endif // SLABALLOCATOR_H
@@ -0,0 +1,152 @@
+#include "WorkStealingPool.h"
+
+namespace
+{
+    // Which deque of which pool the current thread owns, workers only.
+    thread_local WorkStealingPool *CurrentPool = nullptr;
+    thread_local uint32 CurrentDeque = 0;
+}
+
+WorkStealingPool::WorkStealingPool(uint32 threadCount)
+    : queued_(0)
+    , tasks_(0)
+    , steals_(0)
+    , stopping_(false) {
+    for (uint32 i = 0; i <= threadCount; ++i) {
+        deques_.push_back(new TaskDeque());
+    }
+    for (uint32 i = 0; i < threadCount; ++i) {
+        workers_.push_back(std::thread(&WorkStealingPool::workerLoop, this, i));
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stopping_ = true;
+    }
+    sleeping_.notify_all();
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+    for (auto deque : deques_) {
+        delete deque;
+    }
+}
+
+WorkStealingPool &WorkStealingPool::getInstance() {
+    static WorkStealingPool instance(std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 0);
+    return instance;
+}
+
+void WorkStealingPool::submit(TaskGroup &group, TaskFunction function, void *data) {
+    group.pending_.fetch_add(1, std::memory_order_relaxed);
+
+    Task task = { function, data, &group };
+    TaskDeque *deque = CurrentPool == this ? deques_[CurrentDeque] : deques_.back();
+    {
+        std::lock_guard<adaptive_mutex> lock(deque->mutex);
+        deque->tasks.push_back(task);
+    }
+    queued_.fetch_add(1, std::memory_order_release);
+
+    if (!workers_.empty()) {
+        // Taking the mutex orders this with a worker deciding to sleep, the wake up can't be lost.
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        sleeping_.notify_one();
+    }
+}
+
+void WorkStealingPool::wait(TaskGroup &group) {
+    uint32 index = CurrentPool == this ? CurrentDeque : (uint32) deques_.size() - 1;
+    Task task;
+    while (!group.isDone()) {
+        if (takeTask(index, task)) {
+            runTask(task);
+        }
+        else {
+            // The group's last tasks are running elsewhere.
+            std::this_thread::yield();
+        }
+    }
+
+    if (group.failed_.load(std::memory_order_relaxed)) {
+        std::exception_ptr error = group.error_;
+        group.error_ = nullptr;
+        group.failed_.store(false, std::memory_order_relaxed);
+        std::rethrow_exception(error);
+    }
+}
+
+WorkStealingPool::Stats WorkStealingPool::getStats() const {
+    Stats stats;
+    stats.tasks = tasks_.load(std::memory_order_relaxed);
+    stats.steals = steals_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void WorkStealingPool::workerLoop(uint32 index) {
+    CurrentPool = this;
+    CurrentDeque = index;
+
+    Task task;
+    while (true) {
+        if (takeTask(index, task)) {
+            runTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        if (stopping_) {
+            return;
+        }
+        if (queued_.load(std::memory_order_acquire) == 0) {
+            sleeping_.wait(lock);
+        }
+    }
+}
+
+bool WorkStealingPool::takeTask(uint32 index, Task &task) {
+    if (queued_.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+
+    {
+        TaskDeque *own = deques_[index];
+        std::lock_guard<adaptive_mutex> lock(own->mutex);
+        if (!own->tasks.empty()) {
+            task = own->tasks.back();
+            own->tasks.pop_back();
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    uint32 count = (uint32) deques_.size();
+    for (uint32 i = 1; i < count; ++i) {
+        TaskDeque *victim = deques_[(index + i) % count];
+        std::lock_guard<adaptive_mutex> lock(victim->mutex);
+        if (!victim->tasks.empty()) {
+            task = victim->tasks.front();
+            victim->tasks.pop_front();
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::runTask(const Task &task) {
+    try {
+        task.function(task.data);
+    }
+    catch (...) {
+        // Published to wait() by the release below.
+        if (!task.group->failed_.exchange(true, std::memory_order_relaxed)) {
+            task.group->error_ = std::current_exception();
+        }
+    }
+    tasks_.fetch_add(1, std::memory_order_relaxed);
+    task.group->pending_.fetch_sub(1, std::memory_order_release);
+}
@@ -0,0 +1,96 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BASE/Mutex.h"
+
+// Runs short tasks on a fixed set of worker threads. Every worker owns a deque, runs its own
+// tasks newest first and steals the oldest task of another deque when it runs dry. Tasks
+// submitted from other threads go to a shared deque the workers steal from. wait() runs
+// queued tasks on the calling thread until the group it waits for is done, so a pool
+// without workers still runs everything, serially, on the waiting thread.
+class WorkStealingPool final
+{
+public:
+    typedef void (*TaskFunction)(void *data);
+
+    // Counts the unfinished tasks submitted with it and keeps the first exception one of them
+    // threw. Must outlive them.
+    class TaskGroup
+    {
+    public:
+        TaskGroup() : pending_(0), failed_(false) {}
+
+        inline bool isDone() const { return pending_.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class WorkStealingPool;
+        std::atomic<uint64> pending_;
+        std::atomic<bool> failed_;
+        std::exception_ptr error_;
+    };
+
+    struct Stats
+    {
+        uint64 tasks;
+        // Tasks taken from a deque other than the taker's own.
+        uint64 steals;
+    };
+
+    explicit WorkStealingPool(uint32 threadCount);
+    ~WorkStealingPool();
+
+    // One worker less than the hardware threads, the thread calling wait() makes up for it.
+    static WorkStealingPool &getInstance();
+
+    inline uint32 getThreadCount() const { return (uint32) workers_.size(); }
+
+    // Thread safe, data must stay valid until the task has run.
+    void submit(TaskGroup &group, TaskFunction function, void *data);
+    // Returns once every task of group has run. Everything written by them is visible then.
+    // Rethrows the first exception a task of group threw, the group can be reused after.
+    void wait(TaskGroup &group);
+
+    Stats getStats() const;
+
+private:
+    struct Task
+    {
+        TaskFunction function;
+        void *data;
+        TaskGroup *group;
+    };
+
+    struct TaskDeque
+    {
+        adaptive_mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(uint32 index);
+    // Own deque from the back first, then the others from the front.
+    bool takeTask(uint32 index, Task &task);
+    void runTask(const Task &task);
+
+    // One per worker, the last one takes submissions from other threads.
+    std::vector<TaskDeque *> deques_;
+    std::vector<std::thread> workers_;
+    std::atomic<uint64> queued_;
+    std::atomic<uint64> tasks_;
+    std::atomic<uint64> steals_;
+    std::mutex sleepMutex_;
+    std::condition_variable sleeping_;
+    bool stopping_;
+
+    WorkStealingPool(const WorkStealingPool &other);
+    WorkStealingPool &operator=(const WorkStealingPool &other);
+};
+
+#endif // WORKSTEALINGPOOL_H
@@ -298,6 +298,11 @@ namespace GRAPH
         }
     }
 
+    ActionEntry *ActionManager::findHashElement(const Node *target) const {
+        auto iter = targets_.find(const_cast<Node*>(target));
+        return iter != targets_.end() ? iter->second : nullptr;
+    }
+
     void ActionManager::removeActionAtIndex(int64 index, ActionEntry *element) {
         Action *action = (Action*)(*element->actions)[index];
         if (action == element->currentAction && (! element->currentActionSalvaged)) {
@@ -323,12 +328,7 @@ namespace GRAPH
     }
 
     void ActionManager::pauseTarget(Node *target) {
-        ActionEntry *element = nullptr;
-        for (auto iter : targets_) {
-            if (iter.first == target) {
-                element = iter.second;
-            }
-        }
+        ActionEntry *element = findHashElement(target);
 
         if (element) {
             element->paused = true;
@@ -336,12 +336,7 @@ namespace GRAPH
     }
 
     void ActionManager::resumeTarget(Node *target) {
-        ActionEntry *element = nullptr;
-        for (auto iter : targets_) {
-            if (iter.first == target) {
-                element = iter.second;
-            }
-        }
+        ActionEntry *element = findHashElement(target);
 
         if (element) {
             element->paused = false;
@@ -368,12 +363,7 @@ namespace GRAPH
     }
 
     void ActionManager::addAction(Action *action, Node *target, bool paused) {
-        ActionEntry *element = nullptr;
-        for (auto iter : targets_) {
-            if (iter.first == target) {
-                element = iter.second;
-            }
-        }
+        ActionEntry *element = findHashElement(target);
 
         if (! element) {
             element = new ActionEntry;
@@ -390,8 +380,11 @@ namespace GRAPH
     }
 
     void ActionManager::removeAllActions() {
-        for (auto iter : targets_) {
-            removeAllActionsFromTarget(iter.first);
+        // Removing the actions of a target erases its entry, step past it first.
+        for (auto iter = targets_.begin(); iter != targets_.end();) {
+            Node *target = iter->first;
+            ++iter;
+            removeAllActionsFromTarget(target);
         }
     }
 
@@ -400,12 +393,7 @@ namespace GRAPH
             return;
         }
 
-        ActionEntry *element = nullptr;
-        for (auto iter : targets_) {
-            if (iter.first == target) {
-                element = iter.second;
-            }
-        }
+        ActionEntry *element = findHashElement(target);
 
         if (element) {
             if (element->actions->containsObject(element->currentAction) && (! element->currentActionSalvaged)) {
@@ -428,13 +416,7 @@ namespace GRAPH
             return;
         }
 
-        ActionEntry *element = nullptr;
-        HObject *target = action->getOriginalTarget();
-        for (auto iter : targets_) {
-            if (iter.first == target) {
-                element = iter.second;
-            }
-        }
+        ActionEntry *element = findHashElement(action->getOriginalTarget());
 
         if (element) {
             auto i = element->actions->getIndexOfObject(action);
@@ -445,12 +427,7 @@ namespace GRAPH
     }
 
     void ActionManager::removeActionByTag(int tag, Node *target) {
-        ActionEntry *element = nullptr;
-        for (auto iter : targets_) {
-            if (iter.first == target) {
-                element = iter.second;
-            }
-        }
+        ActionEntry *element = findHashElement(target);
 
         if (element) {
             auto limit = element->actions->number();
@@ -467,12 +444,7 @@ namespace GRAPH
 
     void ActionManager::removeAllActionsByTag(int tag, Node *target)
     {
-        ActionEntry *element = nullptr;
-        for (auto iter : targets_) {
-            if (iter.first == target) {
-                element = iter.second;
-            }
-        }
+        ActionEntry *element = findHashElement(target);
 
         if (element) {
             auto limit = element->actions->number();
@@ -492,12 +464,7 @@ namespace GRAPH
 
     Action* ActionManager::getActionByTag(int tag, const Node *target) const
     {
-        ActionEntry *element = nullptr;
-        for (auto iter : targets_) {
-            if (iter.first == target) {
-                element = iter.second;
-            }
-        }
+        ActionEntry *element = findHashElement(target);
 
         if (element) {
             if (element->actions != nullptr) {
@@ -517,12 +484,7 @@ namespace GRAPH
 
     uint64 ActionManager::getNumberOfRunningActionsInTarget(const Node *target) const
     {
-        ActionEntry *element = nullptr;
-        for (auto iter : targets_) {
-            if (iter.first == target) {
-                element = iter.second;
-            }
-        }
+        ActionEntry *element = findHashElement(target);
 
         if (element) {
             return element->actions ? element->actions->number() : 0;
@@ -532,9 +494,11 @@ namespace GRAPH
     }
 
     void ActionManager::update(float dt) {
-        for (auto iter : targets_) {
-            currentTarget_ = iter.second;
+        // The current entry may be deleted at the end of its turn, step past it first.
+        for (auto iter = targets_.begin(); iter != targets_.end();) {
+            currentTarget_ = iter->second;
             currentTargetSalvaged_ = false;
+            ++iter;
 
             if (! currentTarget_->paused) {
                 for (currentTarget_->actionIndex = 0; currentTarget_->actionIndex < currentTarget_->actions->number();
@@ -3,6 +3,7 @@
 
 #include <unordered_map>
 #include "BASE/HObject.h"
+#include "BASE/SlabAllocator.h"
 #include "MATH/Rectangle.h"
 
 namespace GRAPH
@@ -11,6 +12,8 @@ namespace GRAPH
 
     class Action : public HObject
     {
+        USE_SLAB_ALLOCATOR()
+
     public:
         static const int INVALID_TAG = -1;
 
@@ -194,6 +197,7 @@ namespace GRAPH
         void removeActionAtIndex(int64 index, ActionEntry *element);
         void deleteHashElement(ActionEntry *element);
         void actionAllocWithHashElement(ActionEntry *element);
+        ActionEntry *findHashElement(const Node *target) const;
 
     protected:
         std::unordered_map<Node *, ActionEntry *> targets_;
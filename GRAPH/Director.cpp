@@ -1,4 +1,5 @@
 ﻿#include <string>
+#include "BASE/AutoreleasePool.h"
 #include "GRAPH/Director.h"
 #include "GRAPH/Camera.h"
 #include "GRAPH/Action.h"
@@ -10,6 +11,7 @@
 #include "GRAPH/UNITY3D/Renderer.h"
 #include "GRAPH/UNITY3D/Unity3DGLState.h"
 #include "UTILS/TIME/TimeUtils.h"
+#include "UTILS/TIME/Profiler.h"
 
 namespace GRAPH
 {
@@ -24,7 +26,7 @@ namespace GRAPH
 
     bool Director::init(void) {
         paused_ = false;
-        lastTime_ = 0.0f;
+        lastTime_ = -1.0;
 
         initMatrixStack();
 
@@ -34,6 +36,7 @@ namespace GRAPH
         eventDispatcher_ = new (std::nothrow) EventDispatcher;
         renderer_ = new (std::nothrow) Renderer;
         projection_ = Projection::_3D;
+        statsNode_ = nullptr;
 
         return true;
     }
@@ -44,6 +47,7 @@ namespace GRAPH
         SAFE_RELEASE(eventDispatcher_);
         SAFE_RELEASE(renderer_);
         SAFE_RELEASE(camera_);
+        SAFE_RELEASE(statsNode_);
     }
 
     void Director::setRenderView(RenderView *view) {
@@ -312,16 +316,26 @@ namespace GRAPH
 
     void Director::mainLoop() {
         drawScene();
+
+        // Temporaries autoreleased during the frame go away before the next one.
+        PoolManager::getInstance().getCurrentPool()->clear();
     }
 
     void Director::drawScene() {
+        PROFILE_ZONE("Director::drawScene");
+
+        uint64 frameTime = 0;
         if (!paused_) {
-            auto curTime = UTILS::TIME::FetchCurrentTime();
-            scheduler_->update(curTime - lastTime_);
+            double curTime = UTILS::TIME::FetchCurrentTime();
+            // The first frame has nothing to measure against.
+            float dt = lastTime_ < 0.0 ? 0.0f : (float)(curTime - lastTime_);
+            scheduler_->update(dt);
             lastTime_ = curTime;
+            frameTime = (uint64) (dt * 1000000.0f);
         }
 
         renderer_->clear();
+        double renderStart = UTILS::TIME::FetchCurrentTime();
 
         if (nextScene_) {
             setNextScene();
@@ -333,11 +347,31 @@ namespace GRAPH
             runningScene_->render(renderer_);
         }
 
+        renderStats_ = renderer_->getRenderStats();
+        renderStats_.frameTime = frameTime;
+        renderStats_.renderTime = (uint64) ((UTILS::TIME::FetchCurrentTime() - renderStart) * 1000000.0);
+        renderStatsHistory_.add(renderStats_);
+
+        if (statsNode_) {
+            statsNode_->visit(renderer_, getMatrix(MATRIX_STACK_TYPE::MATRIX_STACK_MODELVIEW), 0);
+        }
+
         renderer_->render();
 
         popMatrix(MATRIX_STACK_TYPE::MATRIX_STACK_MODELVIEW);
     }
 
+    void Director::setDisplayStats(bool displayStats) {
+        if (displayStats && !statsNode_) {
+            statsNode_ = RenderStatsNode::create();
+            statsNode_->retain();
+            statsNode_->setPosition(MATH::Vector2f(10.0f, 10.0f));
+        }
+        else if (!displayStats) {
+            SAFE_RELEASE_NULL(statsNode_);
+        }
+    }
+
     void Director::setNextScene() {
         if (runningScene_) {
             runningScene_->onExitTransitionDidStart();
@@ -5,6 +5,7 @@
 #include "BASE/HObject.h"
 #include "MATH/Matrix.h"
 #include "MATH/Size.h"
+#include "GRAPH/RenderStats.h"
 
 namespace GRAPH
 {
@@ -91,6 +92,13 @@ namespace GRAPH
         void mainLoop();
         void drawScene();
 
+        // Of the last drawn frame, the stats overlay not included.
+        inline const RenderStats &getRenderStats() const { return renderStats_; }
+        inline const RenderStatsHistory &getRenderStatsHistory() const { return renderStatsHistory_; }
+        // Draws a RenderStatsNode over the scene, in the lower left corner.
+        void setDisplayStats(bool displayStats);
+        inline RenderStatsNode *getStatsNode() const { return statsNode_; }
+
     protected:
         void setNextScene();
 
@@ -100,7 +108,7 @@ namespace GRAPH
 
     private:
         bool paused_;
-        float lastTime_;
+        double lastTime_;
 
         Camera *camera_;
 
@@ -119,6 +127,10 @@ namespace GRAPH
         EventDispatcher *eventDispatcher_;
         RenderView *renderView_;
         Renderer *renderer_;
+
+        RenderStats renderStats_;
+        RenderStatsHistory renderStatsHistory_;
+        RenderStatsNode *statsNode_;
     };
 }
 
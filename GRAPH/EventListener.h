@@ -6,6 +6,7 @@
 #include <memory>
 #include <vector>
 #include "BASE/HObject.h"
+#include "BASE/SlabAllocator.h"
 #include "GRAPH/Event.h"
 #include "MATH/Vector.h"
 
@@ -15,6 +16,8 @@ namespace GRAPH
 
     class EventListener : public HObject
     {
+        USE_SLAB_ALLOCATOR()
+
     public:
         enum class Type
         {
@@ -10,9 +10,37 @@
 #include "GRAPH/Component.h"
 #include "GRAPH/Camera.h"
 #include "GRAPH/UNITY3D/ShaderState.h"
+#include "GRAPH/UNITY3D/Renderer.h"
+#include "UTILS/TIME/Profiler.h"
+#include "BASE/WorkStealingPool.h"
 
 namespace GRAPH
 {
+    // Fewer children are visited on the calling thread.
+    static const uint64 PARALLEL_VISIT_MIN_CHILDREN = 128;
+    static const uint64 PARALLEL_VISIT_CHUNK = 64;
+
+    // Consecutive children visited by one task, or one unsafe child left to the calling thread
+    // when list is null.
+    struct ParallelVisitChunk
+    {
+        Renderer *renderer;
+        const HObjectVector<Node*> *children;
+        uint64 begin;
+        uint64 end;
+        const MATH::Matrix4 *transform;
+        uint32_t flags;
+        RenderCommandList *list;
+    };
+
+    static void VisitChunk(void *data) {
+        auto chunk = static_cast<ParallelVisitChunk*>(data);
+        Renderer::CaptureScope capture(chunk->list);
+        for (uint64 i = chunk->begin; i < chunk->end; ++i) {
+            chunk->children->at(i)->visit(chunk->renderer, *chunk->transform, chunk->flags);
+        }
+    }
+
     bool Node::nodeComparisonLess(Node* n1, Node* n2) {
         return( n1->getLocalZOrder() < n2->getLocalZOrder() ||
                ( n1->getLocalZOrder() == n2->getLocalZOrder() && n1->getOrderOfArrival() < n2->getOrderOfArrival() )
@@ -108,6 +136,7 @@ namespace GRAPH
         , localZOrder_(0)
         , globalZOrder_(0)
         , parent_(nullptr)
+        , indexInParent_(-1)
         , tag_(Node::INVALID_TAG)
         , name_("")
         , hashOfName_(0)
@@ -120,6 +149,8 @@ namespace GRAPH
         , ignoreAnchorPointForPosition_(false)
         , reorderChildDirty_(false)
         , isTransitionFinished_(false)
+        , subtreeParallelSafe_(true)
+        , subtreeParallelSafeDirty_(true)
         , displayedOpacity_(255)
         , realOpacity_(255)
         , displayedColor_(Color3B::WHITE)
@@ -127,6 +158,7 @@ namespace GRAPH
         , cascadeColorEnabled_(false)
         , cascadeOpacityEnabled_(false)
         , cameraMask_(1) {
+        children_.setIndexSlot(&Node::indexInParent_);
         director_ = &Director::getInstance();
         actionManager_ = director_->getActionManager();
         actionManager_->retain();
@@ -456,6 +488,7 @@ namespace GRAPH
     void Node::setVisible(bool visible) {
         if(visible != visible_) {
             visible_ = visible;
+            markParallelVisitSafetyDirty();
             if(visible_)
                 transformUpdated_ = transformDirty_ = inverseDirty_ = true;
         }
@@ -784,6 +817,7 @@ namespace GRAPH
         }
 
         children_.clear();
+        markParallelVisitSafetyDirty();
     }
 
     void Node::detachChild(Node *child, uint64 childIndex, bool doCleanup) {
@@ -798,7 +832,10 @@ namespace GRAPH
 
         child->setParent(nullptr);
 
-        children_.erase(childIndex);
+        // The tail is not shifted, sortAllChildren() restores the order.
+        children_.fastErase(childIndex);
+        reorderChildDirty_ = true;
+        markParallelVisitSafetyDirty();
     }
 
     void Node::insertChild(Node* child, int z) {
@@ -806,6 +843,7 @@ namespace GRAPH
         reorderChildDirty_ = true;
         children_.pushBack(child);
         child->localZOrder_ = z;
+        markParallelVisitSafetyDirty();
     }
 
     void Node::reorderChild(Node *child, int zOrder) {
@@ -817,6 +855,7 @@ namespace GRAPH
     void Node::sortAllChildren() {
         if (reorderChildDirty_) {
             std::sort(std::begin(children_), std::end(children_), nodeComparisonLess);
+            children_.reindex();
             reorderChildDirty_ = false;
         }
     }
@@ -830,6 +869,7 @@ namespace GRAPH
     }
 
     void Node::visit() {
+        PROFILE_ZONE("Node::visit");
         auto renderer = director_->getRenderer();
         auto& parentTransform = director_->getMatrix(MATRIX_STACK_TYPE::MATRIX_STACK_MODELVIEW);
         visit(renderer, parentTransform, true);
@@ -880,12 +920,23 @@ namespace GRAPH
 
         uint32_t flags = processParentFlags(parentTransform, parentFlags);
 
-        director_->pushMatrix(MATRIX_STACK_TYPE::MATRIX_STACK_MODELVIEW);
-        director_->loadMatrix(MATRIX_STACK_TYPE::MATRIX_STACK_MODELVIEW, modelViewTransform_);
+        // Only safe nodes are visited while capturing, they don't need the stack.
+        bool capturing = Renderer::IsCapturing();
+        if (!capturing) {
+            director_->pushMatrix(MATRIX_STACK_TYPE::MATRIX_STACK_MODELVIEW);
+            director_->loadMatrix(MATRIX_STACK_TYPE::MATRIX_STACK_MODELVIEW, modelViewTransform_);
+        }
 
         uint64 index = 0;
 
-        if(!children_.empty()) {
+        if (!capturing && renderer->getParallelVisitPool() && children_.size() >= PARALLEL_VISIT_MIN_CHILDREN) {
+            sortAllChildren();
+            while (index < children_.size() && children_.at(index)->localZOrder_ < 0) {
+                ++index;
+            }
+            visitChildrenInParallel(renderer, index, flags);
+        }
+        else if(!children_.empty()) {
             sortAllChildren();
             for( ; index < children_.size(); index++ ) {
                 auto node = children_.at(index);
@@ -905,7 +956,80 @@ namespace GRAPH
             this->draw(renderer, modelViewTransform_, flags);
         }
 
-        director_->popMatrix(MATRIX_STACK_TYPE::MATRIX_STACK_MODELVIEW);
+        if (!capturing) {
+            director_->popMatrix(MATRIX_STACK_TYPE::MATRIX_STACK_MODELVIEW);
+        }
+    }
+
+    void Node::markParallelVisitSafetyDirty() {
+        for (Node *node = this; node; node = node->parent_) {
+            node->subtreeParallelSafeDirty_ = true;
+        }
+    }
+
+    bool Node::isSubtreeParallelVisitSafe() const {
+        if (!subtreeParallelSafeDirty_) {
+            return subtreeParallelSafe_;
+        }
+
+        bool safe = true;
+        if (visible_) {
+            safe = isParallelVisitSafe();
+            for (auto it = children_.cbegin(); safe && it != children_.cend(); ++it) {
+                safe = (*it)->isSubtreeParallelVisitSafe();
+            }
+        }
+        subtreeParallelSafe_ = safe;
+        subtreeParallelSafeDirty_ = false;
+        return safe;
+    }
+
+    void Node::visitChildrenInParallel(Renderer* renderer, uint64 drawIndex, uint32_t flags) {
+        // Every task is submitted before the first wait, the calling thread helps with them and
+        // then adds the captured commands in child order. Unsafe children and this node are
+        // visited in between, so the queues end up as a sequential visit would leave them.
+        std::vector<ParallelVisitChunk> chunks;
+        uint64 count = children_.size();
+        uint64 index = 0;
+        while (index < count) {
+            ParallelVisitChunk chunk = { renderer, &children_, index, index + 1, &modelViewTransform_, flags, nullptr };
+            if (children_.at(index)->isSubtreeParallelVisitSafe()) {
+                uint64 limit = index < drawIndex ? drawIndex : count;
+                limit = std::min(limit, index + PARALLEL_VISIT_CHUNK);
+                while (chunk.end < limit && children_.at(chunk.end)->isSubtreeParallelVisitSafe()) {
+                    ++chunk.end;
+                }
+                chunk.list = renderer->createCommandList();
+            }
+            chunks.push_back(chunk);
+            index = chunk.end;
+        }
+
+        WorkStealingPool *pool = renderer->getParallelVisitPool();
+        WorkStealingPool::TaskGroup group;
+        for (auto &chunk : chunks) {
+            if (chunk.list) {
+                pool->submit(group, VisitChunk, &chunk);
+            }
+        }
+        pool->wait(group);
+
+        bool drawn = false;
+        for (const auto &chunk : chunks) {
+            if (!drawn && chunk.begin >= drawIndex) {
+                this->draw(renderer, modelViewTransform_, flags);
+                drawn = true;
+            }
+            if (chunk.list) {
+                renderer->addCommands(*chunk.list);
+            }
+            else {
+                children_.at(chunk.begin)->visit(renderer, modelViewTransform_, flags);
+            }
+        }
+        if (!drawn) {
+            this->draw(renderer, modelViewTransform_, flags);
+        }
     }
 
     MATH::Matrix4 Node::transform(const MATH::Matrix4& parentTransform) {
@@ -1456,6 +1580,7 @@ namespace GRAPH
     }
 
     ProtectedNode::ProtectedNode() : reorderProtectedChildDirty_(false) {
+        protectedChildren_.setIndexSlot(&ProtectedNode::indexInParent_);
     }
 
     ProtectedNode::~ProtectedNode() {
@@ -1540,7 +1665,8 @@ namespace GRAPH
 
             child->setParent(nullptr);
 
-            protectedChildren_.erase(index);
+            protectedChildren_.fastErase(index);
+            reorderProtectedChildDirty_ = true;
         }
     }
 
@@ -1582,6 +1708,7 @@ namespace GRAPH
     void ProtectedNode::sortAllProtectedChildren() {
         if( reorderProtectedChildDirty_ ) {
             std::sort( std::begin(protectedChildren_), std::end(protectedChildren_), nodeComparisonLess );
+            protectedChildren_.reindex();
             reorderProtectedChildDirty_ = false;
         }
     }
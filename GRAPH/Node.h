@@ -3,6 +3,7 @@
 
 #include <functional>
 #include "BASE/HObject.h"
+#include "BASE/SlabAllocator.h"
 #include "GRAPH/Color.h"
 #include "MATH/Vector.h"
 #include "MATH/Quaternion.h"
@@ -36,6 +37,8 @@ namespace GRAPH
 
     class Node : public HObject
     {
+        USE_SLAB_ALLOCATOR()
+
     public:
         static const int INVALID_TAG = -1;
 
@@ -127,6 +130,7 @@ namespace GRAPH
         template <typename T>
         inline T getChildByName(const std::string& name) const { return static_cast<T>(getChildByName(name)); }
         virtual void enumerateChildren(const std::string &name, std::function<bool(Node* node)> callback) const;
+        // Removals swap the last child into the gap, call sortAllChildren() before relying on positions.
         virtual HObjectVector<Node*>& getChildren() { return children_; }
         virtual const HObjectVector<Node*>& getChildren() const { return children_; }
         virtual uint64 getChildrenCount() const;
@@ -178,6 +182,11 @@ namespace GRAPH
 
         virtual void visit(Renderer *renderer, const MATH::Matrix4& parentTransform, uint32_t parentFlags);
         virtual void visit() final;
+        // True when visit() is Node::visit and draw() only touches this node, so the subtree can be
+        // visited on another thread. Such a visit has no director matrix stack. Overrides whose
+        // answer changes call markParallelVisitSafetyDirty().
+        virtual bool isParallelVisitSafe() const { return true; }
+        void markParallelVisitSafetyDirty();
 
         virtual Scene* getScene() const;
 
@@ -293,6 +302,9 @@ namespace GRAPH
 
         MATH::Matrix4 transform(const MATH::Matrix4 &parentTransform);
         uint32_t processParentFlags(const MATH::Matrix4& parentTransform, uint32_t parentFlags);
+        bool isSubtreeParallelVisitSafe() const;
+        // Children before drawIndex are drawn before this node, the rest after it.
+        void visitChildrenInParallel(Renderer *renderer, uint64 drawIndex, uint32_t flags);
 
         virtual void updateCascadeOpacity();
         virtual void disableCascadeOpacity();
@@ -353,6 +365,8 @@ namespace GRAPH
 
         HObjectVector<Node*> children_;
         Node *parent_;
+        // Position in the parent's children, maintained by the indexed children_ vectors.
+        int64 indexInParent_;
         Director* director_;
         int tag_;
 
@@ -380,6 +394,9 @@ namespace GRAPH
 
         bool reorderChildDirty_;
         bool isTransitionFinished_;
+        // isSubtreeParallelVisitSafe() result, recomputed after a child or visibility change.
+        mutable bool subtreeParallelSafe_;
+        mutable bool subtreeParallelSafeDirty_;
 
         ComponentContainer *componentContainer_;
 
@@ -427,6 +444,7 @@ namespace GRAPH
         virtual void sortAllProtectedChildren();
 
         virtual void visit(Renderer *renderer, const MATH::Matrix4 &parentTransform, uint32_t parentFlags) override;
+        virtual bool isParallelVisitSafe() const override { return false; }
 
         virtual void cleanup() override;
 
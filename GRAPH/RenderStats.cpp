@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <cmath>
+#include "GRAPH/RenderStats.h"
+#include "GRAPH/Director.h"
+
+namespace GRAPH
+{
+    RenderStatsHistory::RenderStatsHistory(uint64 capacity)
+        : frames_(std::max<uint64>(capacity, 1))
+        , first_(0)
+        , count_(0) {
+    }
+
+    void RenderStatsHistory::add(const RenderStats &stats) {
+        if (count_ < frames_.size()) {
+            frames_[(first_ + count_) % frames_.size()] = stats;
+            count_++;
+        }
+        else {
+            frames_[first_] = stats;
+            first_ = (first_ + 1) % frames_.size();
+        }
+    }
+
+    void RenderStatsHistory::clear() {
+        first_ = 0;
+        count_ = 0;
+    }
+
+    const RenderStats &RenderStatsHistory::at(uint64 index) const {
+        if (index >= count_) {
+            throw _HException_Normal("RenderStatsHistory: frame out of range");
+        }
+        return frames_[(first_ + index) % frames_.size()];
+    }
+
+    double RenderStatsHistory::average(RenderStatsField field) const {
+        if (count_ == 0) {
+            return 0.0;
+        }
+
+        double sum = 0.0;
+        for (uint64 i = 0; i < count_; ++i) {
+            sum += at(i).*field;
+        }
+        return sum / count_;
+    }
+
+    uint64 RenderStatsHistory::percentile(RenderStatsField field, float fraction) const {
+        if (count_ == 0) {
+            return 0;
+        }
+
+        sorted_.clear();
+        for (uint64 i = 0; i < count_; ++i) {
+            sorted_.push_back(at(i).*field);
+        }
+        fraction = std::min(std::max(fraction, 0.0f), 1.0f);
+        uint64 rank = (uint64) std::ceil(fraction * count_);
+        uint64 index = rank > 0 ? rank - 1 : 0;
+        std::nth_element(sorted_.begin(), sorted_.begin() + index, sorted_.end());
+        return sorted_[index];
+    }
+
+    RenderStatsNode::RenderStatsNode()
+        : field_(&RenderStats::drawCalls)
+        , budget_(0)
+        , graphSize_(240.0f, 60.0f) {
+    }
+
+    RenderStatsNode* RenderStatsNode::create(RenderStatsField field) {
+        RenderStatsNode* ret = new (std::nothrow) RenderStatsNode();
+        if (ret && ret->init()) {
+            ret->field_ = field;
+            ret->autorelease();
+        }
+        else {
+            SAFE_DELETE(ret);
+        }
+
+        return ret;
+    }
+
+    void RenderStatsNode::draw(Renderer *renderer, const MATH::Matrix4 &transform, uint32_t flags) {
+        const RenderStatsHistory &history = director_->getRenderStatsHistory();
+
+        // The highest bar or the budget, whichever is larger, fills the height.
+        uint64 top = budget_;
+        for (uint64 i = 0; i < history.size(); ++i) {
+            top = std::max(top, history.at(i).*field_);
+        }
+
+        clear();
+        drawSolidRect(MATH::Vector2f(0.0f, 0.0f), MATH::Vector2f(graphSize_.width, graphSize_.height), Color4F(0.0f, 0.0f, 0.0f, 0.5f));
+        if (top > 0) {
+            float barWidth = graphSize_.width / history.capacity();
+            float x = graphSize_.width - barWidth * history.size();
+            for (uint64 i = 0; i < history.size(); ++i, x += barWidth) {
+                uint64 value = history.at(i).*field_;
+                if (value == 0) {
+                    continue;
+                }
+                float height = graphSize_.height * value / top;
+                drawSolidRect(MATH::Vector2f(x, 0.0f), MATH::Vector2f(x + barWidth, height), budget_ && value > budget_ ? Color4F::RED : Color4F::GREEN);
+            }
+            if (budget_) {
+                float y = graphSize_.height * budget_ / top;
+                drawLine(MATH::Vector2f(0.0f, y), MATH::Vector2f(graphSize_.width, y), Color4F::YELLOW);
+            }
+        }
+
+        DrawNode::draw(renderer, transform, flags);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef RENDERSTATS_H
+#define RENDERSTATS_H
+
+#include <vector>
+#include "GRAPH/DrawNode.h"
+#include "GRAPH/UNITY3D/Unity3D.h"
+
+namespace GRAPH
+{
+    typedef uint64 RenderStats::*RenderStatsField;
+
+    // The last frames' RenderStats, oldest first. Older frames are dropped once capacity is
+    // reached.
+    class RenderStatsHistory
+    {
+    public:
+        explicit RenderStatsHistory(uint64 capacity = 120);
+
+        void add(const RenderStats &stats);
+        void clear();
+
+        inline uint64 size() const { return count_; }
+        inline uint64 capacity() const { return frames_.size(); }
+        const RenderStats &at(uint64 index) const;
+
+        double average(RenderStatsField field) const;
+        // Nearest rank, fraction from 0 to 1. 0 without frames.
+        uint64 percentile(RenderStatsField field, float fraction) const;
+
+    private:
+        std::vector<RenderStats> frames_;
+        uint64 first_;
+        uint64 count_;
+        mutable std::vector<uint64> sorted_;
+    };
+
+    // Bar graph of one field over the Director's history, a bar per frame, newest on the right.
+    // Bars above the budget are red. Shown by Director::setDisplayStats().
+    class RenderStatsNode : public DrawNode
+    {
+    public:
+        static RenderStatsNode* create(RenderStatsField field = &RenderStats::drawCalls);
+
+        inline void setField(RenderStatsField field) { field_ = field; }
+        inline RenderStatsField getField() const { return field_; }
+        // 0 draws no budget line.
+        inline void setBudget(uint64 budget) { budget_ = budget; }
+        inline uint64 getBudget() const { return budget_; }
+        inline void setGraphSize(const MATH::Sizef &size) { graphSize_ = size; }
+        inline const MATH::Sizef &getGraphSize() const { return graphSize_; }
+
+        virtual void draw(Renderer *renderer, const MATH::Matrix4 &transform, uint32_t flags) override;
+        virtual bool isParallelVisitSafe() const override { return false; }
+
+    public:
+        RenderStatsNode();
+
+    private:
+        RenderStatsField field_;
+        uint64 budget_;
+        MATH::Sizef graphSize_;
+
+    private:
+        DISALLOW_COPY_AND_ASSIGN(RenderStatsNode)
+    };
+}
+
+#endif // RENDERSTATS_H
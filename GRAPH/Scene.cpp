@@ -4,6 +4,7 @@
 #include "GRAPH/Camera.h"
 #include "GRAPH/UNITY3D/Renderer.h"
 #include "MATH/Vector.h"
+#include "UTILS/TIME/Profiler.h"
 
 namespace GRAPH
 {
@@ -62,7 +63,10 @@ namespace GRAPH
         defaultCamera_->apply();
         
         //visit the scene
-        visit(renderer, transform, 0);
+        {
+            PROFILE_ZONE("Node::visit");
+            visit(renderer, transform, 0);
+        }
 
         renderer->render();
 
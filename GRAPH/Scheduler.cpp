@@ -1,5 +1,6 @@
 #include "GRAPH/Scheduler.h"
 #include "MATH/MathDefine.h"
+#include "UTILS/TIME/Profiler.h"
 
 namespace GRAPH
 {
@@ -491,6 +492,7 @@ namespace GRAPH
 
     // main loop
     void Scheduler::update(float dt) {
+        PROFILE_ZONE("Scheduler::update");
         updateMapLocked_ = true;
 
         //
@@ -8,6 +8,7 @@
 #include <unordered_map>
 #include <string.h>
 #include "BASE/HObject.h"
+#include "BASE/SlabAllocator.h"
 
 namespace GRAPH
 {
@@ -16,6 +17,8 @@ namespace GRAPH
 
     class Timer : public HObject
     {
+        USE_SLAB_ALLOCATOR()
+
     protected:
         Timer();
     public:
@@ -42,6 +45,8 @@ namespace GRAPH
 
     struct ListEntry
     {
+        USE_SLAB_ALLOCATOR()
+
         ListEntry() {
             memset(this, 0, sizeof(ListEntry));
         }
@@ -55,6 +60,8 @@ namespace GRAPH
 
     struct UpdateEntry
     {
+        USE_SLAB_ALLOCATOR()
+
         UpdateEntry() {
             memset(this, 0, sizeof(UpdateEntry));
         }
@@ -65,6 +72,8 @@ namespace GRAPH
 
     struct TimerEntry
     {
+        USE_SLAB_ALLOCATOR()
+
         TimerEntry() {
             memset(this, 0, sizeof(TimerEntry));
         }
@@ -266,7 +266,6 @@ namespace GRAPH
     }
 
     Sprite::~Sprite(void) {
-        SAFE_RELEASE(spriteFrame_);
         SAFE_RELEASE(texture_);
     }
 
@@ -364,11 +363,7 @@ namespace GRAPH
     }
 
     void Sprite::setSpriteFrame(SpriteFrame *spriteFrame) {
-        if (spriteFrame_ != spriteFrame) {
-            SAFE_RELEASE(spriteFrame_);
-            spriteFrame_ = spriteFrame;
-            spriteFrame->retain();
-        }
+        spriteFrame_.reset(spriteFrame);
 
         unflippedOffsetPositionFromCenter_ = spriteFrame->getOffset();
 
@@ -586,6 +581,7 @@ namespace GRAPH
     void Sprite::sortAllChildren() {
         if (reorderChildDirty_) {
             std::sort(std::begin(children_), std::end(children_), NodeComparisonLess);
+            children_.reindex();
 
             if ( batchNode_) {
                 for(const auto &child : children_)
@@ -938,6 +934,7 @@ namespace GRAPH
     void SpriteBatchNode::sortAllChildren() {
         if (reorderChildDirty_) {
             std::sort(std::begin(children_), std::end(children_), NodeComparisonLess);
+            children_.reindex();
 
             if (!children_.empty()) {
                 for (const auto &child : children_) {
@@ -154,7 +154,7 @@ namespace GRAPH
         MATH::Matrix4       transformToBatch_;
         BlendFunc        blendFunc_;
         Unity3DTexture*       texture_;
-        SpriteFrame*     spriteFrame_;
+        HRef<SpriteFrame> spriteFrame_;
         TrianglesCommand trianglesCommand_;
         MATH::Rectf rect_;
         bool   rectRotated_;
@@ -200,6 +200,7 @@ namespace GRAPH
         virtual const BlendFunc& getBlendFunc() const override;
 
         virtual void visit(Renderer *renderer, const MATH::Matrix4 &parentTransform, uint32_t parentFlags) override;
+        virtual bool isParallelVisitSafe() const override { return false; }
 
         virtual void addChild(Node * child, int zOrder, int tag) override;
         virtual void addChild(Node * child, int zOrder, const std::string &name) override;
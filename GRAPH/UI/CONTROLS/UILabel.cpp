@@ -312,9 +312,7 @@ namespace GRAPH
                 utf8Text_ = text;
                 contentDirty_ = true;
 
-                std::u16string utf16String;
-                UTILS::STRING::UTF8ToUTF16(utf8Text_, utf16String);
-                utf16Text_  = utf16String;
+                UTILS::STRING::UTF8ToUTF16(utf8Text_, utf16Text_);
             }
         }
 
@@ -840,9 +838,7 @@ namespace GRAPH
             SAFE_RELEASE_NULL(shadowNode_);
 
             if (fontAtlas_) {
-                std::u16string utf16String;
-                UTILS::STRING::UTF8ToUTF16(utf8Text_, utf16String);
-                utf16Text_ = utf16String;
+                UTILS::STRING::UTF8ToUTF16(utf8Text_, utf16Text_);
                 alignText();
             }
             else {
@@ -88,6 +88,7 @@ namespace GRAPH
             virtual MATH::Rectf getBoundingBox() const override;
 
             virtual void visit(Renderer *renderer, const MATH::Matrix4 &parentTransform, uint32_t parentFlags) override;
+            virtual bool isParallelVisitSafe() const override { return false; }
             virtual void draw(Renderer *renderer, const MATH::Matrix4 &transform, uint32_t flags) override;
 
             virtual void setCameraMask(unsigned short mask, bool applyChildren = true) override;
@@ -296,13 +296,13 @@ namespace GRAPH
 
         void Layout::onBeforeVisitScissor()
         {
-            glEnable(GL_SCISSOR_TEST);
+            Unity3DGLState::OpenGLState().scissorTest.enable();
             // TODO
         }
 
         void Layout::onAfterVisitScissor()
         {
-            glDisable(GL_SCISSOR_TEST);
+            Unity3DGLState::OpenGLState().scissorTest.disable();
         }
 
         void Layout::scissorClippingVisit(Renderer *renderer, const MATH::Matrix4& parentTransform, uint32_t parentFlags)
@@ -325,7 +325,7 @@ namespace GRAPH
                     if (able)
                     {
                         static bool once = true;
-                        if (once)
+                        if (once && Unity3DCreator::EngineMode != Unity3DCreator::RECORDING)
                         {
                             glGetIntegerv(GL_STENCIL_BITS, &g_sStencilBits);
                             once = false;
@@ -1555,6 +1555,7 @@ namespace GRAPH
                 return true;
             }
 
+            parent->sortAllChildren();
             auto& container = parent->getChildren();
             uint64 index = container.getIndex(widget);
             if (parent->getLayoutType() == Type::THORIZONTAL)
@@ -1668,6 +1669,9 @@ namespace GRAPH
 
         Widget* Layout::findNextFocusedWidget(FocusDirection direction, Widget* current)
         {
+            // Focus moves by child position, removals leave children_ unordered until sorted.
+            sortAllChildren();
+
             if (isFocusPassing_ || this->isFocused())
             {
                 Layout* parent = dynamic_cast<Layout*>(this->getParent());
@@ -1960,7 +1964,7 @@ namespace GRAPH
         void LinearHorizontalLayoutManager::doLayout(LayoutProtocol* layout)
         {
             MATH::Sizef layoutSize = layout->getLayoutContentSize();
-            HObjectVector<Node*> container = layout->getLayoutElements();
+            const HObjectVector<Node*> &container = layout->getLayoutElements();
             float leftBoundary = 0.0f;
             for (auto& subWidget : container)
             {
@@ -2016,7 +2020,7 @@ namespace GRAPH
         void LinearVerticalLayoutManager::doLayout(LayoutProtocol* layout)
         {
             MATH::Sizef layoutSize = layout->getLayoutContentSize();
-            HObjectVector<Node*> container = layout->getLayoutElements();
+            const HObjectVector<Node*> &container = layout->getLayoutElements();
             float topBoundary = layoutSize.height;
 
             for (auto& subWidget : container)
@@ -2076,7 +2080,7 @@ namespace GRAPH
 
         HObjectVector<Widget*> RelativeLayoutManager::getAllWidgets(LayoutProtocol *layout)
         {
-            HObjectVector<Node*> container = layout->getLayoutElements();
+            const HObjectVector<Node*> &container = layout->getLayoutElements();
             HObjectVector<Widget*> widgetChildren;
             for (auto& subWidget : container)
             {
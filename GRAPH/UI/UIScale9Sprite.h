@@ -98,6 +98,7 @@ namespace GRAPH
             bool isScale9Enabled()const;
 
             virtual void visit(Renderer *renderer, const MATH::Matrix4 &parentTransform, uint32_t parentFlags) override;
+            virtual bool isParallelVisitSafe() const override { return false; }
             virtual void cleanup() override;
 
             virtual void onEnter() override;
@@ -28,6 +28,9 @@ namespace GRAPH
     #include "GLSL/Shader_PositionTextureColor_noMVP.frag"
     #include "GLSL/Shader_PositionTextureColor_noMVP.vert"
 
+    //
+    #include "GLSL/Shader_PositionTextureColor_instanced.vert"
+
     //
     #include "GLSL/Shader_PositionTextureColorAlphaTest.frag"
 
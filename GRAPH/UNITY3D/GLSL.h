@@ -25,6 +25,8 @@ namespace GRAPH
     extern  const GLchar * PositionTextureColor_noMVP_frag;
     extern  const GLchar * PositionTextureColor_noMVP_vert;
 
+    extern  const GLchar * PositionTextureColor_instanced_vert;
+
     extern  const GLchar * PositionTextureColorAlphaTest_frag;
 
     extern  const GLchar * PositionTexture_uColor_frag;
@@ -0,0 +1,23 @@
+const char* PositionTextureColor_instanced_vert = STRINGIFY(
+attribute vec2 a_position;
+attribute vec3 a_texCoord1;
+attribute vec3 a_texCoord2;
+attribute vec4 a_texCoord3;
+attribute vec4 a_color;
+
+\n#ifdef GL_ES\n
+varying lowp vec4 v_fragmentColor;
+varying mediump vec2 v_texCoord;
+\n#else\n
+varying vec4 v_fragmentColor;
+varying vec2 v_texCoord;
+\n#endif\n
+
+void main()
+{
+    vec3 corner = vec3(a_position, 1.0);
+    gl_Position = _MVPMatrix * vec4(dot(a_texCoord1, corner), dot(a_texCoord2, corner), 0.0, 1.0);
+    v_fragmentColor = a_color;
+    v_texCoord = mix(a_texCoord3.xy, a_texCoord3.zw, a_position);
+}
+);
@@ -178,6 +178,54 @@ namespace GRAPH
         shaderState_->apply(matrix4_);
     }
 
+    void InstancedQuadCommand::Instance::setFromQuad(const V3F_C4B_T2F_Quad &quad, const MATH::Matrix4 &transform) {
+        MATH::Vector3f origin, right, top;
+        transform.transformPoint(quad.bl.vertices, &origin);
+        transform.transformPoint(quad.br.vertices, &right);
+        transform.transformPoint(quad.tl.vertices, &top);
+
+        this->transform[0] = right.x - origin.x;
+        this->transform[1] = top.x - origin.x;
+        this->transform[2] = origin.x;
+        this->transform[3] = right.y - origin.y;
+        this->transform[4] = top.y - origin.y;
+        this->transform[5] = origin.y;
+        color = quad.bl.colors;
+        texRect[0] = quad.bl.texCoords.u;
+        texRect[1] = quad.bl.texCoords.v;
+        texRect[2] = quad.tr.texCoords.u;
+        texRect[3] = quad.tr.texCoords.v;
+    }
+
+    InstancedQuadCommand::InstancedQuadCommand()
+        :textureID_(0)
+        ,blendType_(BlendFunc::DISABLE)
+        ,instances_(nullptr)
+        ,instanceCount_(0) {
+        commandType_ = RenderCommand::Type::INSTANCED_QUAD_COMMAND;
+    }
+
+    void InstancedQuadCommand::init(float globalOrder, uint32 textureID, const BlendFunc& blendType, const Instance* instances, uint64 instanceCount,
+                                    const MATH::Matrix4& mv, uint32_t flags) {
+        RenderCommand::init(globalOrder, mv, flags);
+
+        textureID_ = textureID;
+        blendType_ = blendType;
+        instances_ = instances;
+        instanceCount_ = instanceCount;
+        matrix4_ = mv;
+    }
+
+    InstancedQuadCommand::~InstancedQuadCommand() {
+    }
+
+    void InstancedQuadCommand::useMaterial(Unity3DShaderSet* shader) const {
+        shader->apply();
+        shader->setUniformsForBuiltins(matrix4_);
+        Unity3DGLState::OpenGLState().texture2d.set(textureID_);
+        Unity3DGLState::OpenGLState().blendFunc.set(blendType_.src, blendType_.dst);
+    }
+
     CustomCommand::CustomCommand()
         : func(nullptr) {
         commandType_ = RenderCommand::Type::CUSTOM_COMMAND;
@@ -1,15 +1,69 @@
 #include <algorithm>
+#include <string.h>
 #include "GRAPH/UNITY3D/Renderer.h"
+#include "GRAPH/Director.h"
 #include "GRAPH/UNITY3D/RenderCommand.h"
+#include "GRAPH/UNITY3D/ShaderCache.h"
+#include "GRAPH/UNITY3D/Unity3DGLState.h"
+#include "UTILS/TIME/Profiler.h"
+#include "BASE/WorkStealingPool.h"
 
 namespace GRAPH
 {
-    static bool CompareRenderCommand(RenderCommand* a, RenderCommand* b) {
-        return a->getGlobalOrder() < b->getGlobalOrder();
+    // Vertices filled by one task at least, smaller batches are filled on the rendering thread.
+    static const uint64 PARALLEL_FILL_VERTICES = 4096;
+
+    // Where addCommand goes on this thread while capturing.
+    static thread_local RenderCommandList* CaptureList = nullptr;
+
+    // Maps a float to an unsigned int with the same ordering, negatives included.
+    static inline uint32 FloatToSortable(float value) {
+        uint32 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits ^ ((uint32) ((int32) bits >> 31) | 0x80000000u);
     }
 
-    static bool Compare3DCommand(RenderCommand* a, RenderCommand* b) {
-        return  a->getDepth() > b->getDepth();
+    // LSD radix sort, 8 bits per pass. All histograms are built in one read, digits every key
+    // shares are skipped, so keys that only differ in a few bytes take few passes.
+    static void RadixSortKeys(std::vector<uint64> &keys, std::vector<uint64> &scratch) {
+        const uint64 count = keys.size();
+        uint32 histograms[8][256];
+        memset(histograms, 0, sizeof(histograms));
+
+        for (uint64 i = 0; i < count; ++i) {
+            uint64 key = keys[i];
+            for (int pass = 0; pass < 8; ++pass) {
+                histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+            }
+        }
+
+        scratch.resize(count);
+        uint64 *from = keys.data();
+        uint64 *to = scratch.data();
+
+        for (int pass = 0; pass < 8; ++pass) {
+            uint32 *histogram = histograms[pass];
+            if (histogram[(from[0] >> (pass * 8)) & 0xFF] == count) {
+                continue;
+            }
+
+            uint32 offset = 0;
+            for (int digit = 0; digit < 256; ++digit) {
+                uint32 digitCount = histogram[digit];
+                histogram[digit] = offset;
+                offset += digitCount;
+            }
+
+            for (uint64 i = 0; i < count; ++i) {
+                uint64 key = from[i];
+                to[histogram[(key >> (pass * 8)) & 0xFF]++] = key;
+            }
+            std::swap(from, to);
+        }
+
+        if (from != keys.data()) {
+            memcpy(keys.data(), from, sizeof(uint64) * count);
+        }
     }
 
     RenderQueue::RenderQueue()
@@ -18,15 +72,44 @@ namespace GRAPH
 
     void RenderQueue::push_back(RenderCommand* command) {
         float z = command->getGlobalOrder();
+        QUEUE_GROUP group;
         if(z < 0) {
-            commands_[QUEUE_GROUP::GLOBALZ_NEG].push_back(command);
+            group = QUEUE_GROUP::GLOBALZ_NEG;
         }
         else if(z > 0) {
-            commands_[QUEUE_GROUP::GLOBALZ_POS].push_back(command);
+            group = QUEUE_GROUP::GLOBALZ_POS;
         }
         else {
-            commands_[QUEUE_GROUP::GLOBALZ_ZERO].push_back(command);
+            group = QUEUE_GROUP::GLOBALZ_ZERO;
         }
+
+        sortKeys_[group].push_back(createSortKey(group, command, commands_[group].size()));
+        commands_[group].push_back(command);
+    }
+
+    uint64 RenderQueue::createSortKey(QUEUE_GROUP group, RenderCommand* command, uint64 index) {
+        uint32 high = 0;
+        switch (group) {
+        case QUEUE_GROUP::GLOBALZ_NEG:
+        case QUEUE_GROUP::GLOBALZ_POS:
+            high = FloatToSortable(command->getGlobalOrder());
+            break;
+        case QUEUE_GROUP::TRANSPARENT_3D:
+            high = ~FloatToSortable(command->getDepth());
+            break;
+        case QUEUE_GROUP::OPAQUE_3D:
+            // Depth tested, any order is correct, so commands sharing a material end up adjacent.
+            if (command->getType() == RenderCommand::Type::QUAD_COMMAND) {
+                high = static_cast<QuadCommand*>(command)->getMaterialID();
+            }
+            else if (command->getType() == RenderCommand::Type::TRIANGLES_COMMAND) {
+                high = static_cast<TrianglesCommand*>(command)->getMaterialID();
+            }
+            break;
+        default:
+            break;
+        }
+        return ((uint64) high << 32) | (index & 0xFFFFFFFF);
     }
 
     uint64 RenderQueue::size() const {
@@ -39,10 +122,34 @@ namespace GRAPH
     }
 
     void RenderQueue::sort() {
-        // Don't sort _queue0, it already comes sorted
-        std::sort(std::begin(commands_[QUEUE_GROUP::TRANSPARENT_3D]), std::end(commands_[QUEUE_GROUP::TRANSPARENT_3D]), Compare3DCommand);
-        std::sort(std::begin(commands_[QUEUE_GROUP::GLOBALZ_NEG]), std::end(commands_[QUEUE_GROUP::GLOBALZ_NEG]), CompareRenderCommand);
-        std::sort(std::begin(commands_[QUEUE_GROUP::GLOBALZ_POS]), std::end(commands_[QUEUE_GROUP::GLOBALZ_POS]), CompareRenderCommand);
+        // Don't sort GLOBALZ_ZERO, it already comes sorted
+        sortSubQueue(QUEUE_GROUP::OPAQUE_3D);
+        sortSubQueue(QUEUE_GROUP::TRANSPARENT_3D);
+        sortSubQueue(QUEUE_GROUP::GLOBALZ_NEG);
+        sortSubQueue(QUEUE_GROUP::GLOBALZ_POS);
+    }
+
+    void RenderQueue::sortSubQueue(QUEUE_GROUP group) {
+        std::vector<uint64> &keys = sortKeys_[group];
+        std::vector<RenderCommand*> &commands = commands_[group];
+        if (commands.size() < 2) {
+            return;
+        }
+
+        // Radix passes only pay off once the histogram setup is amortized.
+        if (keys.size() < 256) {
+            std::sort(keys.begin(), keys.end());
+        }
+        else {
+            RadixSortKeys(keys, sortScratch_);
+        }
+
+        commandScratch_.assign(commands.begin(), commands.end());
+        for (uint64 i = 0; i < keys.size(); ++i) {
+            uint64 from = keys[i] & 0xFFFFFFFF;
+            commands[i] = commandScratch_[from];
+            keys[i] = (keys[i] & 0xFFFFFFFF00000000ull) | i;
+        }
     }
 
     RenderCommand* RenderQueue::operator[](uint64 index) const {
@@ -60,6 +167,7 @@ namespace GRAPH
     void RenderQueue::clear() {
         for(int i = 0; i < QUEUE_COUNT; ++i) {
             commands_[i].clear();
+            sortKeys_[i].clear();
         }
     }
 
@@ -67,6 +175,8 @@ namespace GRAPH
         for(int i = 0; i < QUEUE_COUNT; ++i) {
             commands_[i] = std::vector<RenderCommand*>();
             commands_[i].reserve(reserveSize);
+            sortKeys_[i] = std::vector<uint64>();
+            sortKeys_[i].reserve(reserveSize);
         }
     }
 
@@ -78,26 +188,294 @@ namespace GRAPH
         depthState_->apply();
     }
 
+    RenderBatchReorder::RenderBatchReorder()
+        : stamp_(0)
+        , gridX_(0.0f)
+        , gridY_(0.0f)
+        , cellWidth_(1.0f)
+        , cellHeight_(1.0f) {
+        memset(cellHeads_, 0, sizeof(cellHeads_));
+        memset(cellStamps_, 0, sizeof(cellStamps_));
+    }
+
+    uint64 RenderBatchReorder::reorder(std::vector<RenderCommand*> &commands, const MATH::Matrix4 &projection) {
+        uint64 saved = 0;
+        uint64 begin = 0;
+        items_.resize(commands.size());
+        for (uint64 i = 0; i < commands.size(); ++i) {
+            items_[i].command = commands[i];
+            if (!ComputeItem(commands[i], projection, items_[i])) {
+                saved += reorderSegment(begin, i);
+                begin = i + 1;
+            }
+        }
+        saved += reorderSegment(begin, commands.size());
+
+        if (saved > 0) {
+            for (uint64 i = 0; i < commands.size(); ++i) {
+                commands[i] = items_[i].command;
+            }
+        }
+        return saved;
+    }
+
+    bool RenderBatchReorder::ComputeItem(RenderCommand* command, const MATH::Matrix4 &projection, Item &item) {
+        const V3F_C4B_T2F *vertices;
+        uint64 vertexCount;
+        const MATH::Matrix4 *modelView;
+        uint32 materialID;
+
+        if (command->getType() == RenderCommand::Type::QUAD_COMMAND) {
+            auto cmd = static_cast<QuadCommand*>(command);
+            vertices = (const V3F_C4B_T2F *) cmd->getQuads();
+            vertexCount = cmd->getQuadCount() * 4;
+            modelView = &cmd->getModelView();
+            materialID = cmd->getMaterialID();
+        }
+        else if (command->getType() == RenderCommand::Type::TRIANGLES_COMMAND) {
+            auto cmd = static_cast<TrianglesCommand*>(command);
+            vertices = cmd->getVertices();
+            vertexCount = cmd->getVertexCount();
+            modelView = &cmd->getModelView();
+            materialID = cmd->getMaterialID();
+        }
+        else {
+            return false;
+        }
+
+        if (command->isSkipBatching() || materialID == Renderer::MATERIAL_ID_DO_NOT_BATCH || vertexCount == 0) {
+            return false;
+        }
+
+        // Transform the corners of the local box rather than every vertex.
+        MATH::Vector3f localMin = vertices[0].vertices;
+        MATH::Vector3f localMax = vertices[0].vertices;
+        for (uint64 i = 1; i < vertexCount; ++i) {
+            const MATH::Vector3f &vertex = vertices[i].vertices;
+            localMin.x = std::min(localMin.x, vertex.x);
+            localMin.y = std::min(localMin.y, vertex.y);
+            localMin.z = std::min(localMin.z, vertex.z);
+            localMax.x = std::max(localMax.x, vertex.x);
+            localMax.y = std::max(localMax.y, vertex.y);
+            localMax.z = std::max(localMax.z, vertex.z);
+        }
+
+        // Clip space corners, the box is in front of the eye when every w is positive and then
+        // projects inside the rectangle of its projected corners.
+        MATH::Matrix4 modelViewProjection = projection * *modelView;
+        for (int corner = 0; corner < 8; ++corner) {
+            MATH::Vector4f point(corner & 1 ? localMax.x : localMin.x, corner & 2 ? localMax.y : localMin.y, corner & 4 ? localMax.z : localMin.z, 1.0f);
+            modelViewProjection.transformVector(&point);
+            if (point.w <= 1e-6f) {
+                return false;
+            }
+            point.x /= point.w;
+            point.y /= point.w;
+            if (corner == 0) {
+                item.minX = item.maxX = point.x;
+                item.minY = item.maxY = point.y;
+            }
+            else {
+                item.minX = std::min(item.minX, point.x);
+                item.minY = std::min(item.minY, point.y);
+                item.maxX = std::max(item.maxX, point.x);
+                item.maxY = std::max(item.maxY, point.y);
+            }
+        }
+
+        // Quads and triangles flush each other, so the type is part of the batch.
+        item.key = ((uint64) command->getType() << 32) | materialID;
+        return true;
+    }
+
+    static inline int GridCell(float value, float origin, float cellSize) {
+        float cell = (value - origin) / cellSize;
+        return cell <= 0.0f ? 0 : (cell >= RenderBatchReorder::GRID_SIZE - 1 ? RenderBatchReorder::GRID_SIZE - 1 : (int) cell);
+    }
+
+    uint64 RenderBatchReorder::CountBreaks(const Item *items, uint64 count) {
+        uint64 breaks = 0;
+        for (uint64 i = 1; i < count; ++i) {
+            if (items[i].key != items[i - 1].key) {
+                ++breaks;
+            }
+        }
+        return breaks;
+    }
+
+    uint64 RenderBatchReorder::reorderSegment(uint64 begin, uint64 end) {
+        if (end - begin < 3) {
+            return 0;
+        }
+
+        float minX = items_[begin].minX, minY = items_[begin].minY;
+        float maxX = items_[begin].maxX, maxY = items_[begin].maxY;
+        for (uint64 i = begin + 1; i < end; ++i) {
+            minX = std::min(minX, items_[i].minX);
+            minY = std::min(minY, items_[i].minY);
+            maxX = std::max(maxX, items_[i].maxX);
+            maxY = std::max(maxY, items_[i].maxY);
+        }
+        gridX_ = minX;
+        gridY_ = minY;
+        cellWidth_ = std::max((maxX - minX) / GRID_SIZE, 1e-6f);
+        cellHeight_ = std::max((maxY - minY) / GRID_SIZE, 1e-6f);
+
+        uint64 saved = 0;
+        uint64 runBegin = begin;
+        ++stamp_;
+        cellEntries_.clear();
+
+        for (uint64 i = begin; i < end; ++i) {
+            const Item &item = items_[i];
+            int cellX0 = GridCell(item.minX, gridX_, cellWidth_);
+            int cellX1 = GridCell(item.maxX, gridX_, cellWidth_);
+            int cellY0 = GridCell(item.minY, gridY_, cellHeight_);
+            int cellY1 = GridCell(item.maxY, gridY_, cellHeight_);
+
+            // Edges that only touch don't share pixels, so the test is strict.
+            bool overlaps = false;
+            for (int y = cellY0; y <= cellY1 && !overlaps; ++y) {
+                for (int x = cellX0; x <= cellX1 && !overlaps; ++x) {
+                    int cell = y * GRID_SIZE + x;
+                    if (cellStamps_[cell] != stamp_) {
+                        continue;
+                    }
+                    for (int32 entry = cellHeads_[cell]; entry >= 0; entry = cellEntries_[entry].next) {
+                        const Item &other = items_[cellEntries_[entry].item];
+                        if (item.minX < other.maxX && other.minX < item.maxX && item.minY < other.maxY && other.minY < item.maxY) {
+                            overlaps = true;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            if (overlaps) {
+                saved += sortRun(runBegin, i, runBegin > begin);
+                runBegin = i;
+                ++stamp_;
+                cellEntries_.clear();
+            }
+
+            for (int y = cellY0; y <= cellY1; ++y) {
+                for (int x = cellX0; x <= cellX1; ++x) {
+                    int cell = y * GRID_SIZE + x;
+                    if (cellStamps_[cell] != stamp_) {
+                        cellStamps_[cell] = stamp_;
+                        cellHeads_[cell] = -1;
+                    }
+                    CellEntry entry = { (uint32) i, cellHeads_[cell] };
+                    cellHeads_[cell] = (int32) cellEntries_.size();
+                    cellEntries_.push_back(entry);
+                }
+            }
+        }
+        saved += sortRun(runBegin, end, runBegin > begin);
+
+        return saved;
+    }
+
+    uint64 RenderBatchReorder::sortRun(uint64 begin, uint64 end, bool joinsPrevious) {
+        if (end - begin < 2) {
+            return 0;
+        }
+
+        // Breaks are counted from the last item of the previous run on, if there is one.
+        uint64 first = joinsPrevious ? begin - 1 : begin;
+        uint64 breaksBefore = CountBreaks(items_.data() + first, end - first);
+        if (breaksBefore == 0) {
+            return 0;
+        }
+
+        // The batch left open by the previous run goes first, so it is continued.
+        uint64 leadKey = items_[first].key;
+        runScratch_.assign(items_.begin() + begin, items_.begin() + end);
+        std::stable_sort(runScratch_.begin(), runScratch_.end(), [leadKey](const Item &a, const Item &b) {
+            bool aLeads = a.key == leadKey;
+            bool bLeads = b.key == leadKey;
+            return aLeads != bLeads ? aLeads : a.key < b.key;
+        });
+        std::copy(runScratch_.begin(), runScratch_.end(), items_.begin() + begin);
+
+        return breaksBefore - CountBreaks(items_.data() + first, end - first);
+    }
+
     static const int DEFAULT_RENDER_QUEUE = 0;
 
+    static uint64 NextPowerOfTwo(uint64 value) {
+        uint64 result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    template <typename I>
+    static void FillQuadIndices(I *indices, uint64 quadCount) {
+        for (uint64 i = 0; i < quadCount; i++) {
+            indices[i * 6 + 0] = (I) (i * 4 + 0);
+            indices[i * 6 + 1] = (I) (i * 4 + 1);
+            indices[i * 6 + 2] = (I) (i * 4 + 2);
+            indices[i * 6 + 3] = (I) (i * 4 + 3);
+            indices[i * 6 + 4] = (I) (i * 4 + 2);
+            indices[i * 6 + 5] = (I) (i * 4 + 1);
+        }
+    }
+
+    template <typename I>
+    static void CopyIndices(I *dst, const uint16 *src, uint64 count, uint32 baseVertex) {
+        for (uint64 i = 0; i < count; ++i) {
+            dst[i] = (I) (src[i] + baseVertex);
+        }
+    }
+
+    template <typename I>
+    static void OffsetIndices(I *indices, uint64 count, uint32 baseVertex) {
+        for (uint64 i = 0; i < count; ++i) {
+            indices[i] = (I) (indices[i] + baseVertex);
+        }
+    }
+
     Renderer::Renderer()
-        : u3dContext_(Unity3DCreator::CreateContext())
+        : baseVertexDraws_(false)
+        , indexType_(INDEX_UINT16)
+        , indexSize_(sizeof(uint16))
+        , instancedDraws_(false)
+        , u3dCornerBuffer_(nullptr)
+        , u3dInstanceBuffer_(nullptr)
+        , u3dCornerFormat_(nullptr)
+        , u3dInstanceFormat_(nullptr)
+        , instancedShader_(nullptr)
+        , expandedShader_(nullptr)
+        , u3dContext_(Unity3DCreator::CreateContext())
         , depthState_(Unity3DCreator::CreateDepthState())
         , glViewAssigned_(false)
         , isRendering_(false)
         , isDepthTestFor2D_(false)
-        , lastMaterialID_(0) {
+        , lastMaterialID_(0)
+        , batchReordering_(false)
+        , parallelVisitPool_(nullptr)
+        , parallelFillPool_(nullptr)
+        , usedCommandLists_(0) {
+        memset(&batchStats_, 0, sizeof(batchStats_));
+        stateChangesAtClear_ = 0;
         groupCommandManager_ = new (std::nothrow) GroupCommandManager(this);
         commandGroupStack_.push(DEFAULT_RENDER_QUEUE);
         RenderQueue defaultRenderQueue;
         renderGroups_.push_back(defaultRenderQueue);
         batchedCommands_.reserve(BATCH_QUADCOMMAND_RESEVER_SIZE);
 
-        memset(vboArray_, 0, sizeof(VertexBufferObject<V3F_C4B_T2F>) * 2);
+        memset(vboArray_, 0, sizeof(vboArray_));
+        memset(indexData32_, 0, sizeof(indexData32_));
+        memset(u3dVertexBuffer_, 0, sizeof(u3dVertexBuffer_));
+        memset(u3dIndexBuffer_, 0, sizeof(u3dIndexBuffer_));
+        memset(u3dVertexFormat_, 0, sizeof(u3dVertexFormat_));
+        memset(renderVertices_, 0, sizeof(renderVertices_));
+        memset(renderIndices_, 0, sizeof(renderIndices_));
+        memset(batchFilled_, 0, sizeof(batchFilled_));
         for (auto &object : vboArray_) {
-            object.u2.bufferData = new V3F_C4B_T2F[VBO_SIZE];
             object.u2.bufferCapacity = VBO_SIZE;
-            object.u2.indexData = new uint16[INDEX_VBO_SIZE];
             object.u2.indexCapacity = INDEX_VBO_SIZE;
         }
 
@@ -110,49 +488,207 @@ namespace GRAPH
         SAFE_DELETE_PTRARRAY(u3dVertexBuffer_, 2);
         SAFE_DELETE_PTRARRAY(u3dIndexBuffer_, 2);
         SAFE_DELETE_PTRARRAY(u3dVertexFormat_, 2);
+        SAFE_DELETE(u3dCornerBuffer_);
+        SAFE_DELETE(u3dInstanceBuffer_);
+        SAFE_DELETE(u3dCornerFormat_);
+        SAFE_DELETE(u3dInstanceFormat_);
+        for (auto list : commandLists_) {
+            delete list;
+        }
+        for (int type = 0; type < 2; ++type) {
+            SAFE_DELETE_ARRAY(vboArray_[type].u2.bufferData);
+            SAFE_DELETE_ARRAY(vboArray_[type].u2.indexData);
+            SAFE_DELETE_ARRAY(indexData32_[type]);
+        }
         SAFE_RELEASE(u3dContext_);
         SAFE_RELEASE(depthState_);
     }
 
     void Renderer::initGLView() {
-        for (int i = 0; i < VBO_SIZE / 4; i++) {
-            vboArray_[QUADS].u2.indexData[i * 6 + 0] = (uint16) (i * 4 + 0);
-            vboArray_[QUADS].u2.indexData[i * 6 + 1] = (uint16) (i * 4 + 1);
-            vboArray_[QUADS].u2.indexData[i * 6 + 2] = (uint16) (i * 4 + 2);
-            vboArray_[QUADS].u2.indexData[i * 6 + 3] = (uint16) (i * 4 + 3);
-            vboArray_[QUADS].u2.indexData[i * 6 + 4] = (uint16) (i * 4 + 2);
-            vboArray_[QUADS].u2.indexData[i * 6 + 5] = (uint16) (i * 4 + 1);
-        }
-
         setupBuffer();
         glViewAssigned_ = true;
     }
 
     void Renderer::setupBuffer() {
-        for (int index = 0; index < 2; ++index) {
-            u3dVertexBuffer_[index] = Unity3DCreator::CreateBuffer(VERTEXDATA | DYNAMIC);
-            u3dIndexBuffer_[index] = Unity3DCreator::CreateBuffer(INDEXDATA);
-
-            u3dVertexBuffer_[index]->setData((const uint8 *) vboArray_[index].u2.bufferData, sizeof(V3F_C4B_T2F) * vboArray_[index].u2.bufferCapacity);
-            u3dIndexBuffer_[index]->setData((const uint8 *) vboArray_[index].u2.indexData, sizeof(uint16) * vboArray_[index].u2.indexCapacity);
+        baseVertexDraws_ = u3dContext_->supportsBaseVertex();
 
+        for (int index = 0; index < 2; ++index) {
             std::vector<U3DVertexComponent> vertexFormat = {
                 U3DVertexComponent(SEM_POSITION, FLOATx3, sizeof(V3F_C4B_T2F), offsetof(V3F_C4B_T2F, vertices)),
                 U3DVertexComponent(SEM_COLOR0, UNORM8x4, sizeof(V3F_C4B_T2F), offsetof(V3F_C4B_T2F, colors)),
                 U3DVertexComponent(SEM_TEXCOORD0, FLOATx2, sizeof(V3F_C4B_T2F), offsetof(V3F_C4B_T2F, texCoords)) };
             u3dVertexFormat_[index] = Unity3DCreator::CreateVertexFormat(vertexFormat);
+
+            allocateBatch(index, vboArray_[index].u2.bufferCapacity, vboArray_[index].u2.indexCapacity);
+        }
+
+        instancedDraws_ = u3dContext_->supportsInstancing();
+        instancedShader_ = ShaderCache::getInstance().getU3DShader(Unity3DShader::SHADER_NAME_POSITION_TEXTURE_COLOR_INSTANCED);
+        expandedShader_ = ShaderCache::getInstance().getU3DShader(Unity3DShader::SHADER_NAME_POSITION_TEXTURE_COLOR);
+        if (instancedDraws_) {
+            // tl, bl, tr, br, split along the same diagonal as the quad index pattern.
+            static const float corners[] = { 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.0f };
+            u3dCornerFormat_ = Unity3DCreator::CreateVertexFormat(U3DVertexComponent(SEM_POSITION, FLOATx2, sizeof(float) * 2, 0));
+            u3dCornerBuffer_ = Unity3DCreator::CreateBuffer(VERTEXDATA);
+            u3dCornerBuffer_->setData((const uint8 *) corners, sizeof(corners));
+
+            std::vector<U3DVertexComponent> instanceFormat = {
+                U3DVertexComponent(SEM_TEXCOORD1, FLOATx3, sizeof(InstancedQuadCommand::Instance), offsetof(InstancedQuadCommand::Instance, transform), 1),
+                U3DVertexComponent(SEM_TEXCOORD2, FLOATx3, sizeof(InstancedQuadCommand::Instance), offsetof(InstancedQuadCommand::Instance, transform) + sizeof(float) * 3, 1),
+                U3DVertexComponent(SEM_COLOR0, UNORM8x4, sizeof(InstancedQuadCommand::Instance), offsetof(InstancedQuadCommand::Instance, color), 1),
+                U3DVertexComponent(SEM_TEXCOORD3, FLOATx4, sizeof(InstancedQuadCommand::Instance), offsetof(InstancedQuadCommand::Instance, texRect), 1) };
+            u3dInstanceFormat_ = Unity3DCreator::CreateVertexFormat(instanceFormat);
+            u3dInstanceBuffer_ = Unity3DCreator::CreateBuffer(VERTEXDATA | STREAM);
+            u3dInstanceBuffer_->setData(nullptr, sizeof(InstancedQuadCommand::Instance) * VBO_SIZE / 4);
+        }
+    }
+
+    void Renderer::allocateBatch(int type, uint64 vertexCapacity, uint64 indexCapacity) {
+        auto &object = vboArray_[type];
+        SAFE_DELETE_ARRAY(object.u2.bufferData);
+        SAFE_DELETE_ARRAY(object.u2.indexData);
+        SAFE_DELETE_ARRAY(indexData32_[type]);
+        object.u2.bufferData = new V3F_C4B_T2F[vertexCapacity];
+        object.u2.bufferCapacity = vertexCapacity;
+        if (indexType_ == INDEX_UINT32) {
+            indexData32_[type] = new uint32[indexCapacity];
+        }
+        else {
+            object.u2.indexData = new uint16[indexCapacity];
+        }
+        object.u2.indexCapacity = indexCapacity;
+        object.u2.bufferCount = 0;
+        object.u2.indexCount = 0;
+
+        SAFE_DELETE(u3dVertexBuffer_[type]);
+        SAFE_DELETE(u3dIndexBuffer_[type]);
+        uint32 indexFlags = indexType_ == INDEX_UINT32 ? INDEX32 : 0;
+
+        // Vertices are streamed into a ring of one batch, so quad indices and rebased triangle
+        // indices reach every vertex of it.
+        u3dVertexBuffer_[type] = Unity3DCreator::CreateBuffer(VERTEXDATA | STREAM);
+        u3dVertexBuffer_[type]->setData(nullptr, sizeof(V3F_C4B_T2F) * vertexCapacity);
+
+        // The quad pattern is static, triangle indices are streamed like the vertices.
+        if (type == QUADS) {
+            if (indexType_ == INDEX_UINT32) {
+                FillQuadIndices(indexData32_[type], vertexCapacity / 4);
+            }
+            else {
+                FillQuadIndices(object.u2.indexData, vertexCapacity / 4);
+            }
+            u3dIndexBuffer_[type] = Unity3DCreator::CreateBuffer(INDEXDATA | indexFlags);
+            u3dIndexBuffer_[type]->setData(getIndexBytes(type), indexSize_ * indexCapacity);
+        }
+        else {
+            u3dIndexBuffer_[type] = Unity3DCreator::CreateBuffer(INDEXDATA | STREAM | indexFlags);
+            u3dIndexBuffer_[type]->setData(nullptr, indexSize_ * indexCapacity);
+        }
+    }
+
+    uint64 Renderer::getMaxBatchVertices(int type) const {
+        // uint16 indices address 65536 vertices, unless triangles are drawn from base vertices.
+        if (indexType_ == INDEX_UINT32 || (type == TRIANGLES && baseVertexDraws_)) {
+            return MAX_VBO_SIZE;
+        }
+        return VBO_SIZE;
+    }
+
+    const uint8 *Renderer::getIndexBytes(int type) const {
+        if (indexType_ == INDEX_UINT32) {
+            return (const uint8 *) indexData32_[type];
+        }
+        return (const uint8 *) vboArray_[type].u2.indexData;
+    }
+
+    void Renderer::growBatches() {
+        for (int type = 0; type < 2; ++type) {
+            if (!batchFilled_[type]) {
+                continue;
+            }
+
+            // Enough for everything the last render() batched, so a similar frame won't fill up.
+            auto &object = vboArray_[type];
+            uint64 vertexCapacity = std::min(NextPowerOfTwo(renderVertices_[type]), getMaxBatchVertices(type));
+            uint64 indexCapacity = vertexCapacity * 6 / 4;
+            if (type == TRIANGLES) {
+                indexCapacity = std::max(indexCapacity, std::min(NextPowerOfTwo(renderIndices_[type]), (uint64) MAX_VBO_SIZE * 6 / 4));
+            }
+            if (vertexCapacity > object.u2.bufferCapacity || indexCapacity > object.u2.indexCapacity) {
+                allocateBatch(type, std::max(vertexCapacity, object.u2.bufferCapacity), std::max(indexCapacity, object.u2.indexCapacity));
+            }
+        }
+    }
+
+    void Renderer::setIndexType(U3DIndexType indexType) {
+        if (isRendering_) {
+            throw _HException_Normal("Renderer: index type changed while rendering");
+        }
+        if (indexType == indexType_) {
+            return;
+        }
+
+        indexType_ = indexType;
+        indexSize_ = indexType == INDEX_UINT32 ? sizeof(uint32) : sizeof(uint16);
+        for (int type = 0; type < 2; ++type) {
+            uint64 vertexCapacity = std::min(vboArray_[type].u2.bufferCapacity, getMaxBatchVertices(type));
+            uint64 indexCapacity = type == QUADS ? vertexCapacity * 6 / 4 : vboArray_[type].u2.indexCapacity;
+            if (glViewAssigned_) {
+                allocateBatch(type, vertexCapacity, indexCapacity);
+            }
+            else {
+                vboArray_[type].u2.bufferCapacity = vertexCapacity;
+                vboArray_[type].u2.indexCapacity = indexCapacity;
+            }
         }
     }
 
     void Renderer::addCommand(RenderCommand* command) {
+        if (CaptureList) {
+            CaptureList->commands.push_back({ command, CaptureList->renderQueue });
+            return;
+        }
         int renderQueue =commandGroupStack_.top();
         addCommand(command, renderQueue);
     }
 
     void Renderer::addCommand(RenderCommand* command, int renderQueue) {
+        if (CaptureList) {
+            CaptureList->commands.push_back({ command, renderQueue });
+            return;
+        }
         renderGroups_[renderQueue].push_back(command);
     }
 
+    Renderer::CaptureScope::CaptureScope(RenderCommandList* list)
+        : previous_(CaptureList) {
+        CaptureList = list;
+    }
+
+    Renderer::CaptureScope::~CaptureScope() {
+        CaptureList = previous_;
+    }
+
+    bool Renderer::IsCapturing() {
+        return CaptureList != nullptr;
+    }
+
+    RenderCommandList* Renderer::createCommandList() {
+        if (usedCommandLists_ == commandLists_.size()) {
+            commandLists_.push_back(new RenderCommandList());
+        }
+        RenderCommandList* list = commandLists_[usedCommandLists_++];
+        list->renderQueue = commandGroupStack_.top();
+        list->commands.clear();
+        return list;
+    }
+
+    void Renderer::addCommands(const RenderCommandList& list) {
+        for (const auto &entry : list.commands) {
+            addCommand(entry.command, entry.renderQueue);
+        }
+    }
+
     void Renderer::pushGroup(int renderQueueID) {
         commandGroupStack_.push(renderQueueID);
     }
@@ -168,6 +704,7 @@ namespace GRAPH
     }
 
     void Renderer::processRenderCommand(RenderCommand* command) {
+        batchStats_.commands++;
         auto commandType = command->getType();
         if( RenderCommand::Type::TRIANGLES_COMMAND == commandType) {
             //Draw if we have batched other commands which are not triangle command
@@ -177,15 +714,32 @@ namespace GRAPH
             auto cmd = static_cast<TrianglesCommand*>(command);
 
             //Draw batched Triangles if necessary
-            if (cmd->isSkipBatching() || vboArray_[TRIANGLES].u2.bufferCount + cmd->getVertexCount() > VBO_SIZE || vboArray_[TRIANGLES].u2.indexCount + cmd->getIndexCount() > INDEX_VBO_SIZE) {
+            auto &object = vboArray_[TRIANGLES];
+            bool full = object.u2.bufferCount + cmd->getVertexCount() > object.u2.bufferCapacity || object.u2.indexCount + cmd->getIndexCount() > object.u2.indexCapacity;
+            if (cmd->isSkipBatching() || full) {
                 //Draw batched Triangles if VBO is full
                 drawBatchedTriangles();
             }
+            if (full) {
+                batchFilled_[TRIANGLES] = true;
+                batchStats_.capacityFlushes++;
+                // A single command bigger than a batch, the batch is empty now.
+                if (cmd->getVertexCount() > object.u2.bufferCapacity || cmd->getIndexCount() > object.u2.indexCapacity) {
+                    allocateBatch(TRIANGLES, std::max(object.u2.bufferCapacity, NextPowerOfTwo(cmd->getVertexCount())), std::max(object.u2.indexCapacity, NextPowerOfTwo(cmd->getIndexCount())));
+                }
+            }
+            renderVertices_[TRIANGLES] += cmd->getVertexCount();
+            renderIndices_[TRIANGLES] += cmd->getIndexCount();
 
             //Batch Triangles
             batchedCommands_.push_back(cmd);
+            batchedBaseVertices_.push_back((int) object.u2.bufferCount);
 
-            fillVerticesAndIndices(cmd);
+            if (!parallelFillPool_) {
+                fillVerticesAndIndices(cmd, object.u2.bufferCount, object.u2.indexCount);
+            }
+            object.u2.bufferCount += cmd->getVertexCount();
+            object.u2.indexCount += cmd->getIndexCount();
 
             if(cmd->isSkipBatching()) {
                 drawBatchedTriangles();
@@ -200,20 +754,51 @@ namespace GRAPH
             auto cmd = static_cast<QuadCommand*>(command);
 
             //Draw batched quads if necessary
-            if (cmd->isSkipBatching() || (vboArray_[QUADS].u2.bufferCount + cmd->getQuadCount()) * 4 > VBO_SIZE) {
+            auto &object = vboArray_[QUADS];
+            uint64 vertexCount = cmd->getQuadCount() * 4;
+            bool full = object.u2.bufferCount * 4 + vertexCount > object.u2.bufferCapacity;
+            if (cmd->isSkipBatching() || full) {
                 //Draw batched quads if VBO is full
                 drawBatchedQuads();
             }
+            if (full) {
+                batchFilled_[QUADS] = true;
+                batchStats_.capacityFlushes++;
+                // A single command bigger than a batch, the batch is empty now.
+                if (vertexCount > object.u2.bufferCapacity) {
+                    if (vertexCount > getMaxBatchVertices(QUADS)) {
+                        throw _HException_Normal("Renderer: QuadCommand has more quads than indices can address");
+                    }
+                    uint64 vertexCapacity = NextPowerOfTwo(vertexCount);
+                    allocateBatch(QUADS, vertexCapacity, vertexCapacity * 6 / 4);
+                }
+            }
+            renderVertices_[QUADS] += vertexCount;
 
             //Batch Quads
             batchQuadCommands_.push_back(cmd);
 
-            fillQuads(cmd);
+            if (!parallelFillPool_) {
+                fillQuads(cmd, object.u2.bufferCount);
+            }
+            object.u2.bufferCount += cmd->getQuadCount();
 
             if(cmd->isSkipBatching()) {
                 drawBatchedQuads();
             }
         }
+        else if(RenderCommand::Type::INSTANCED_QUAD_COMMAND == commandType) {
+            flush();
+            auto cmd = static_cast<InstancedQuadCommand*>(command);
+            if (instancedDraws_) {
+                drawInstancedQuads(cmd);
+            }
+            else {
+                expandInstancedQuads(cmd);
+            }
+            // The material was applied outside the batches.
+            lastMaterialID_ = 0;
+        }
         else if(RenderCommand::Type::GROUP_COMMAND == commandType) {
             flush();
             int renderQueueID = ((GroupCommand*) command)->getRenderQueueID();
@@ -231,12 +816,21 @@ namespace GRAPH
         }
     }
 
+    void Renderer::prepareSubQueue(std::vector<RenderCommand*>& commands) {
+        if (batchReordering_) {
+            // Batches are drawn with the projection current now.
+            const MATH::Matrix4 &projection = Director::getInstance().getMatrix(MATRIX_STACK_TYPE::MATRIX_STACK_PROJECTION);
+            batchStats_.drawCallsWithoutReorder += batchReorder_.reorder(commands, projection);
+        }
+    }
+
     void Renderer::visitRenderQueue(RenderQueue& queue) {
         queue.saveRenderState();
 
         //
         //Process Global-Z < 0 Objects
         //
+        prepareSubQueue(queue.getSubQueue(RenderQueue::QUEUE_GROUP::GLOBALZ_NEG));
         const auto& zNegQueue = queue.getSubQueue(RenderQueue::QUEUE_GROUP::GLOBALZ_NEG);
         if (zNegQueue.size() > 0) {
             if(isDepthTestFor2D_) {
@@ -289,6 +883,7 @@ namespace GRAPH
         //
         //Process Global-Z = 0 Queue
         //
+        prepareSubQueue(queue.getSubQueue(RenderQueue::QUEUE_GROUP::GLOBALZ_ZERO));
         const auto& zZeroQueue = queue.getSubQueue(RenderQueue::QUEUE_GROUP::GLOBALZ_ZERO);
         if (zZeroQueue.size() > 0) {
             if(isDepthTestFor2D_) {
@@ -310,6 +905,7 @@ namespace GRAPH
         //
         //Process Global-Z > 0 Queue
         //
+        prepareSubQueue(queue.getSubQueue(RenderQueue::QUEUE_GROUP::GLOBALZ_POS));
         const auto& zPosQueue = queue.getSubQueue(RenderQueue::QUEUE_GROUP::GLOBALZ_POS);
         if (zPosQueue.size() > 0) {
             for (auto it = zPosQueue.cbegin(); it != zPosQueue.cend(); ++it) {
@@ -322,6 +918,7 @@ namespace GRAPH
     }
 
     void Renderer::render() {
+        PROFILE_ZONE("Renderer::render");
         isRendering_ = true;
 
         if (glViewAssigned_) {
@@ -336,23 +933,46 @@ namespace GRAPH
         }
 
         batchedCommands_.clear();
+        batchedBaseVertices_.clear();
         batchQuadCommands_.clear();
         lastMaterialID_ = 0;
+        usedCommandLists_ = 0;
 
         for (auto &object : vboArray_) {
             object.u2.bufferCount = 0;
             object.u2.indexCount = 0;
         }
 
+        if (glViewAssigned_) {
+            growBatches();
+        }
+        memset(renderVertices_, 0, sizeof(renderVertices_));
+        memset(renderIndices_, 0, sizeof(renderIndices_));
+        memset(batchFilled_, 0, sizeof(batchFilled_));
+
         isRendering_ = false;
     }
 
     void Renderer::clear() {
+        // Called once at the start of every frame, while render() may run several times.
+        memset(&batchStats_, 0, sizeof(batchStats_));
+        Unity3DContext::FrameStats = RenderStats();
+        stateChangesAtClear_ = Unity3DGLState::change_count;
         u3dContext_->clear(U3DClear::COLOR, clearColor_, 1.0, 0);
         depthState_->setDepthTest(false);
         depthState_->apply();
     }
 
+    RenderStats Renderer::getRenderStats() const {
+        RenderStats stats = Unity3DContext::FrameStats;
+        stats.stateChanges = Unity3DGLState::change_count - stateChangesAtClear_;
+        stats.commands = batchStats_.commands;
+        stats.batches = batchStats_.drawCalls;
+        stats.materialSwitches = batchStats_.materialSwitches;
+        stats.capacityFlushes = batchStats_.capacityFlushes;
+        return stats;
+    }
+
     void Renderer::setDepthTest(bool enable) {
         if (enable) {
             u3dContext_->clear(U3DClear::DEPTH, 0, 1.0f, 0.0);
@@ -368,35 +988,96 @@ namespace GRAPH
         isDepthTestFor2D_ = enable;
     }
 
-    void Renderer::fillVerticesAndIndices(const TrianglesCommand* cmd) {
-        memcpy(vboArray_[TRIANGLES].u2.bufferData + vboArray_[TRIANGLES].u2.bufferCount, cmd->getVertices(), sizeof(V3F_C4B_T2F) * cmd->getVertexCount());
+    void Renderer::fillVerticesAndIndices(const TrianglesCommand* cmd, uint64 vertexOffset, uint64 indexOffset) {
+        V3F_C4B_T2F *vertices = vboArray_[TRIANGLES].u2.bufferData + vertexOffset;
+        memcpy(vertices, cmd->getVertices(), sizeof(V3F_C4B_T2F) * cmd->getVertexCount());
         const MATH::Matrix4& modelView = cmd->getModelView();
 
         for(uint64 i=0; i< cmd->getVertexCount(); ++i) {
-            V3F_C4B_T2F *q = &vboArray_[TRIANGLES].u2.bufferData[i + vboArray_[TRIANGLES].u2.bufferCount];
-            MATH::Vector3f *vec1 = (MATH::Vector3f*)&q->vertices;
+            MATH::Vector3f *vec1 = (MATH::Vector3f*)&vertices[i].vertices;
             modelView.transformPoint(vec1);
         }
 
         const unsigned short* indices = cmd->getIndices();
         //fill index
-        for(uint64 i=0; i< cmd->getIndexCount(); ++i) {
-            vboArray_[TRIANGLES].u2.indexData[vboArray_[TRIANGLES].u2.indexCount + i] = vboArray_[TRIANGLES].u2.bufferCount + indices[i];
+        uint32 baseVertex = baseVertexDraws_ ? 0 : (uint32) vertexOffset;
+        if (indexType_ == INDEX_UINT32) {
+            CopyIndices(indexData32_[TRIANGLES] + indexOffset, indices, cmd->getIndexCount(), baseVertex);
+        }
+        else if (baseVertexDraws_) {
+            memcpy(vboArray_[TRIANGLES].u2.indexData + indexOffset, indices, sizeof(uint16) * cmd->getIndexCount());
+        }
+        else {
+            CopyIndices(vboArray_[TRIANGLES].u2.indexData + indexOffset, indices, cmd->getIndexCount(), baseVertex);
         }
-
-        vboArray_[TRIANGLES].u2.bufferCount += cmd->getVertexCount();
-        vboArray_[TRIANGLES].u2.indexCount += cmd->getIndexCount();
     }
 
-    void Renderer::fillQuads(const QuadCommand *cmd) {
+    void Renderer::fillQuads(const QuadCommand *cmd, uint64 quadOffset) {
         const MATH::Matrix4& modelView = cmd->getModelView();
         const V3F_C4B_T2F* quads =  (V3F_C4B_T2F*)cmd->getQuads();
+        V3F_C4B_T2F *vertices = vboArray_[QUADS].u2.bufferData + quadOffset * 4;
         for(uint64 i=0; i< cmd->getQuadCount() * 4; ++i) {
-            vboArray_[QUADS].u2.bufferData[i + vboArray_[QUADS].u2.bufferCount * 4] = quads[i];
-            modelView.transformPoint(quads[i].vertices, &(vboArray_[QUADS].u2.bufferData[i + vboArray_[QUADS].u2.bufferCount * 4].vertices));
+            vertices[i] = quads[i];
+            modelView.transformPoint(quads[i].vertices, &vertices[i].vertices);
+        }
+    }
+
+    void Renderer::fillBatch(int type) {
+        // Tasks of about PARALLEL_FILL_VERTICES vertices, the last one is run here.
+        fillTasks_.clear();
+        FillTask task = { this, type, 0, 0, 0, 0 };
+        uint64 commandCount = type == TRIANGLES ? batchedCommands_.size() : batchQuadCommands_.size();
+        uint64 vertexOffset = 0;
+        uint64 indexOffset = 0;
+        for (uint64 i = 0; i < commandCount; ++i) {
+            if (type == TRIANGLES) {
+                vertexOffset += batchedCommands_[i]->getVertexCount();
+                indexOffset += batchedCommands_[i]->getIndexCount();
+            }
+            else {
+                vertexOffset += batchQuadCommands_[i]->getQuadCount() * 4;
+            }
+            if (vertexOffset - task.vertexOffset >= PARALLEL_FILL_VERTICES) {
+                task.last = i + 1;
+                fillTasks_.push_back(task);
+                task.first = task.last;
+                task.vertexOffset = vertexOffset;
+                task.indexOffset = indexOffset;
+            }
+        }
+        task.last = commandCount;
+
+        if (fillTasks_.empty()) {
+            RunFillTask(&task);
+            return;
         }
 
-        vboArray_[QUADS].u2.bufferCount += cmd->getQuadCount();
+        WorkStealingPool::TaskGroup group;
+        for (auto &fillTask : fillTasks_) {
+            parallelFillPool_->submit(group, RunFillTask, &fillTask);
+        }
+        RunFillTask(&task);
+        parallelFillPool_->wait(group);
+    }
+
+    void Renderer::RunFillTask(void* data) {
+        auto task = static_cast<FillTask*>(data);
+        Renderer* renderer = task->renderer;
+        uint64 vertexOffset = task->vertexOffset;
+        uint64 indexOffset = task->indexOffset;
+        for (uint64 i = task->first; i < task->last; ++i) {
+            if (task->type == TRIANGLES) {
+                const TrianglesCommand* cmd = renderer->batchedCommands_[i];
+                renderer->fillVerticesAndIndices(cmd, vertexOffset, indexOffset);
+                vertexOffset += cmd->getVertexCount();
+                indexOffset += cmd->getIndexCount();
+            }
+            else {
+                const QuadCommand* cmd = renderer->batchQuadCommands_[i];
+                renderer->fillQuads(cmd, vertexOffset / 4);
+                vertexOffset += cmd->getQuadCount() * 4;
+            }
+        }
     }
 
     void Renderer::drawBatchedTriangles()
@@ -409,27 +1090,44 @@ namespace GRAPH
         if (vboArray_[TRIANGLES].u2.bufferCount <= 0 || vboArray_[TRIANGLES].u2.indexCount <= 0 || batchedCommands_.empty()) {
             return;
         }
+        if (parallelFillPool_) {
+            fillBatch(TRIANGLES);
+        }
 
-        u3dVertexBuffer_[TRIANGLES]->bind();
-        u3dVertexBuffer_[TRIANGLES]->setData((const uint8 *) vboArray_[TRIANGLES].u2.bufferData, sizeof(V3F_C4B_T2F) * vboArray_[TRIANGLES].u2.bufferCount);
+        uint64 vertexOffset = u3dVertexBuffer_[TRIANGLES]->stream((const uint8 *) vboArray_[TRIANGLES].u2.bufferData, sizeof(V3F_C4B_T2F) * vboArray_[TRIANGLES].u2.bufferCount);
+        int baseVertex = (int) (vertexOffset / sizeof(V3F_C4B_T2F));
 
-        u3dIndexBuffer_[TRIANGLES]->bind();
-        u3dIndexBuffer_[TRIANGLES]->setData((const uint8 *) vboArray_[TRIANGLES].u2.indexData, sizeof(uint16) * vboArray_[TRIANGLES].u2.indexCount);
+        // Without base vertex draws, indices were filled for a batch starting at vertex 0, move
+        // them to where it landed.
+        if (!baseVertexDraws_ && baseVertex > 0) {
+            if (indexType_ == INDEX_UINT32) {
+                OffsetIndices(indexData32_[TRIANGLES], vboArray_[TRIANGLES].u2.indexCount, baseVertex);
+            }
+            else {
+                OffsetIndices(vboArray_[TRIANGLES].u2.indexData, vboArray_[TRIANGLES].u2.indexCount, baseVertex);
+            }
+        }
+        uint64 indexOffset = u3dIndexBuffer_[TRIANGLES]->stream(getIndexBytes(TRIANGLES), indexSize_ * vboArray_[TRIANGLES].u2.indexCount);
+        startIndex = (int) (indexOffset / indexSize_);
 
         // Start drawing verties in batch
-        for(const auto& cmd : batchedCommands_) {
+        uint64 runBegin = 0;
+        for (uint64 i = 0; i < batchedCommands_.size(); ++i) {
+            const auto& cmd = batchedCommands_[i];
             auto newMaterialID = cmd->getMaterialID();
             if(lastMaterialID_ != newMaterialID || newMaterialID == MATERIAL_ID_DO_NOT_BATCH) {
                 // Draw quads
                 if(indexToDraw > 0) {
-                    u3dContext_->drawIndexed(PRIM_TRIANGLES, u3dVertexFormat_[TRIANGLES], u3dVertexBuffer_[TRIANGLES], u3dIndexBuffer_[TRIANGLES], (void *) (startIndex*sizeof(uint16)), indexToDraw);
+                    drawTriangleRun(runBegin, i, startIndex, indexToDraw, baseVertex);
                     startIndex += indexToDraw;
                     indexToDraw = 0;
                 }
+                runBegin = i;
 
                 // Use new material
                 cmd->useMaterial();
                 lastMaterialID_ = newMaterialID;
+                batchStats_.materialSwitches++;
             }
 
             indexToDraw += cmd->getIndexCount();
@@ -437,14 +1135,37 @@ namespace GRAPH
 
         //Draw any remaining triangles
         if(indexToDraw > 0) {
-            u3dContext_->drawIndexed(PRIM_TRIANGLES, u3dVertexFormat_[TRIANGLES], u3dVertexBuffer_[TRIANGLES], u3dIndexBuffer_[TRIANGLES], (void *) (startIndex*sizeof(uint16)), indexToDraw);
+            drawTriangleRun(runBegin, batchedCommands_.size(), startIndex, indexToDraw, baseVertex);
         }
 
         batchedCommands_.clear();
+        batchedBaseVertices_.clear();
         vboArray_[TRIANGLES].u2.bufferCount = 0;
         vboArray_[TRIANGLES].u2.indexCount = 0;
     }
 
+    void Renderer::drawTriangleRun(uint64 first, uint64 last, int startIndex, int indexCount, int baseVertex) {
+        if (!baseVertexDraws_) {
+            u3dContext_->drawIndexed(PRIM_TRIANGLES, u3dVertexFormat_[TRIANGLES], u3dVertexBuffer_[TRIANGLES], u3dIndexBuffer_[TRIANGLES], (void *) (intptr) (startIndex*indexSize_), indexCount);
+        }
+        else {
+            drawCounts_.clear();
+            drawIndices_.clear();
+            drawBaseVertices_.clear();
+            intptr index = startIndex;
+            for (uint64 i = first; i < last; ++i) {
+                int count = (int) batchedCommands_[i]->getIndexCount();
+                drawCounts_.push_back(count);
+                drawIndices_.push_back((void *) (index * indexSize_));
+                drawBaseVertices_.push_back(baseVertex + batchedBaseVertices_[i]);
+                index += count;
+            }
+            u3dContext_->multiDrawIndexedBaseVertex(PRIM_TRIANGLES, u3dVertexFormat_[TRIANGLES], u3dVertexBuffer_[TRIANGLES], u3dIndexBuffer_[TRIANGLES], drawCounts_.data(), drawIndices_.data(), drawBaseVertices_.data(), (int) drawCounts_.size());
+        }
+        batchStats_.drawCalls++;
+        batchStats_.drawCallsWithoutReorder++;
+    }
+
     void Renderer::drawBatchedQuads() {
         //TODO: we can improve the draw performance by insert material switching command before hand.
         uint64 indexToDraw = 0;
@@ -454,9 +1175,13 @@ namespace GRAPH
         if (vboArray_[QUADS].u2.bufferCount <= 0 || batchQuadCommands_.empty()) {
             return;
         }
+        if (parallelFillPool_) {
+            fillBatch(QUADS);
+        }
 
-        u3dVertexBuffer_[QUADS]->bind();
-        u3dVertexBuffer_[QUADS]->setData((const uint8 *) vboArray_[QUADS].u2.bufferData, sizeof(V3F_C4B_T2F) * vboArray_[QUADS].u2.bufferCount * 4);
+        // Quads land on a multiple of 4 vertices, the static pattern reaches them from the matching index.
+        uint64 vertexOffset = u3dVertexBuffer_[QUADS]->stream((const uint8 *) vboArray_[QUADS].u2.bufferData, sizeof(V3F_C4B_T2F) * vboArray_[QUADS].u2.bufferCount * 4);
+        startIndex = (int) (vertexOffset / (sizeof(V3F_C4B_T2F) * 4) * 6);
 
         //Start drawing vertices in batch
         for(const auto& cmd : batchQuadCommands_) {
@@ -465,7 +1190,9 @@ namespace GRAPH
             if(lastMaterialID_ != newMaterialID || newMaterialID == MATERIAL_ID_DO_NOT_BATCH) {
                 // flush buffer
                 if(indexToDraw > 0) {
-                    u3dContext_->drawIndexed(PRIM_TRIANGLES, u3dVertexFormat_[QUADS], u3dVertexBuffer_[QUADS], u3dIndexBuffer_[QUADS], (void *) (startIndex*sizeof(uint16)), indexToDraw);
+                    u3dContext_->drawIndexed(PRIM_TRIANGLES, u3dVertexFormat_[QUADS], u3dVertexBuffer_[QUADS], u3dIndexBuffer_[QUADS], (void *) (intptr) (startIndex*indexSize_), indexToDraw);
+                    batchStats_.drawCalls++;
+                    batchStats_.drawCallsWithoutReorder++;
                     startIndex += indexToDraw;
                     indexToDraw = 0;
                 }
@@ -474,6 +1201,7 @@ namespace GRAPH
                 lastMaterialID_ = newMaterialID;
 
                 cmd->useMaterial();
+                batchStats_.materialSwitches++;
             }
 
             if (commandQueued) {
@@ -483,13 +1211,65 @@ namespace GRAPH
 
         //Draw any remaining quad
         if(indexToDraw > 0) {
-            u3dContext_->drawIndexed(PRIM_TRIANGLES, u3dVertexFormat_[QUADS], u3dVertexBuffer_[QUADS], u3dIndexBuffer_[QUADS], (void *) (startIndex*sizeof(uint16)), indexToDraw);
+            u3dContext_->drawIndexed(PRIM_TRIANGLES, u3dVertexFormat_[QUADS], u3dVertexBuffer_[QUADS], u3dIndexBuffer_[QUADS], (void *) (intptr) (startIndex*indexSize_), indexToDraw);
+            batchStats_.drawCalls++;
+            batchStats_.drawCallsWithoutReorder++;
         }
 
         batchQuadCommands_.clear();
         vboArray_[QUADS].u2.bufferCount = 0;
     }
 
+    void Renderer::drawInstancedQuads(const InstancedQuadCommand* cmd) {
+        if (cmd->getInstanceCount() == 0) {
+            return;
+        }
+
+        uint64 instanceOffset = u3dInstanceBuffer_->stream((const uint8 *) cmd->getInstances(), sizeof(InstancedQuadCommand::Instance) * cmd->getInstanceCount());
+        cmd->useMaterial(instancedShader_);
+        batchStats_.materialSwitches++;
+        u3dContext_->drawInstanced(PRIM_TRIANGLESGL_STRIP, u3dCornerFormat_, u3dCornerBuffer_, 4, u3dInstanceFormat_, u3dInstanceBuffer_, instanceOffset, (int) cmd->getInstanceCount());
+        batchStats_.drawCalls++;
+        batchStats_.drawCallsWithoutReorder++;
+    }
+
+    void Renderer::expandInstancedQuads(const InstancedQuadCommand* cmd) {
+        if (cmd->getInstanceCount() == 0) {
+            return;
+        }
+
+        // Same vertices the instanced shader computes, the model view is left to the shader.
+        auto &object = vboArray_[QUADS];
+        cmd->useMaterial(expandedShader_);
+        batchStats_.materialSwitches++;
+        const InstancedQuadCommand::Instance* instances = cmd->getInstances();
+        uint64 batchCapacity = object.u2.bufferCapacity / 4;
+        for (uint64 first = 0; first < cmd->getInstanceCount(); first += batchCapacity) {
+            uint64 count = std::min(batchCapacity, cmd->getInstanceCount() - first);
+            for (uint64 i = 0; i < count; ++i) {
+                const InstancedQuadCommand::Instance &instance = instances[first + i];
+                V3F_C4B_T2F *quad = object.u2.bufferData + i * 4;
+                for (int corner = 0; corner < 4; ++corner) {
+                    // tl, bl, tr, br
+                    float x = corner < 2 ? 0.0f : 1.0f;
+                    float y = corner & 1 ? 0.0f : 1.0f;
+                    quad[corner].vertices.x = instance.transform[0] * x + instance.transform[1] * y + instance.transform[2];
+                    quad[corner].vertices.y = instance.transform[3] * x + instance.transform[4] * y + instance.transform[5];
+                    quad[corner].vertices.z = 0.0f;
+                    quad[corner].colors = instance.color;
+                    quad[corner].texCoords.u = x == 0.0f ? instance.texRect[0] : instance.texRect[2];
+                    quad[corner].texCoords.v = y == 0.0f ? instance.texRect[1] : instance.texRect[3];
+                }
+            }
+
+            uint64 vertexOffset = u3dVertexBuffer_[QUADS]->stream((const uint8 *) object.u2.bufferData, sizeof(V3F_C4B_T2F) * count * 4);
+            uint64 startIndex = vertexOffset / (sizeof(V3F_C4B_T2F) * 4) * 6;
+            u3dContext_->drawIndexed(PRIM_TRIANGLES, u3dVertexFormat_[QUADS], u3dVertexBuffer_[QUADS], u3dIndexBuffer_[QUADS], (void *) (intptr) (startIndex*indexSize_), (int) count * 6);
+            batchStats_.drawCalls++;
+            batchStats_.drawCallsWithoutReorder++;
+        }
+    }
+
     void Renderer::flush() {
         flush2D();
     }
@@ -6,10 +6,13 @@
 #include "GRAPH/UNITY3D/Unity3D.h"
 #include "GRAPH/UNITY3D/RenderCommand.h"
 
+class WorkStealingPool;
+
 namespace GRAPH
 {
     class QuadCommand;
     class TrianglesCommand;
+    class InstancedQuadCommand;
 
     class RenderQueue {
     public:
@@ -45,10 +48,68 @@ namespace GRAPH
         void restoreRenderState();
 
     protected:
+        // Sort keys, one per command and in the same order. The low 32 bits are the position
+        // the command was pushed at, which keeps the sort stable and maps a sorted key back to
+        // its command. The high 32 bits depend on the group: globalZ for GLOBALZ_NEG/POS,
+        // inverted depth (back to front) for TRANSPARENT_3D, material ID for OPAQUE_3D.
+        static uint64 createSortKey(QUEUE_GROUP group, RenderCommand* command, uint64 index);
+        void sortSubQueue(QUEUE_GROUP group);
+
         std::vector<RenderCommand*> commands_[QUEUE_COUNT];
+        std::vector<uint64> sortKeys_[QUEUE_COUNT];
+        std::vector<uint64> sortScratch_;
+        std::vector<RenderCommand*> commandScratch_;
         Unity3DDepthState *depthState_;
     };
 
+    // Reorders 2D commands by material where that can't change the picture. Quad and triangle
+    // commands between two commands that can't be batched (custom, group, skip batching) are
+    // cut into runs whose bounds don't overlap, each run is then stably sorted by command type
+    // and material ID. Bounds are the screen rectangles of the commands projected through the
+    // projection they are drawn with, commands reaching behind the eye are not reordered.
+    class RenderBatchReorder
+    {
+    public:
+        RenderBatchReorder();
+
+        // Reorders in place. Returns the number of batch breaks saved, counted as material
+        // changes in the old order minus material changes in the new one.
+        uint64 reorder(std::vector<RenderCommand*> &commands, const MATH::Matrix4 &projection);
+
+        static const int GRID_SIZE = 32;
+
+    private:
+
+        struct Item
+        {
+            RenderCommand* command;
+            uint64 key;
+            float minX, minY, maxX, maxY;
+        };
+
+        struct CellEntry
+        {
+            uint32 item;
+            int32 next;
+        };
+
+        static bool ComputeItem(RenderCommand* command, const MATH::Matrix4 &projection, Item &item);
+        static uint64 CountBreaks(const Item *items, uint64 count);
+
+        uint64 reorderSegment(uint64 begin, uint64 end);
+        uint64 sortRun(uint64 begin, uint64 end, bool joinsPrevious);
+
+        std::vector<Item> items_;
+        std::vector<Item> runScratch_;
+        // Cells of a uniform grid over the segment, each heads a list of the run's items
+        // touching it. A cell is empty unless its stamp is the current run's.
+        int32 cellHeads_[GRID_SIZE * GRID_SIZE];
+        uint32 cellStamps_[GRID_SIZE * GRID_SIZE];
+        std::vector<CellEntry> cellEntries_;
+        uint32 stamp_;
+        float gridX_, gridY_, cellWidth_, cellHeight_;
+    };
+
     struct RenderStackElement
     {
         int renderQueueID;
@@ -57,14 +118,43 @@ namespace GRAPH
 
     class GroupCommandManager;
 
+    // Commands added on a thread while it captures into the list, in the order they came.
+    struct RenderCommandList
+    {
+        struct Entry
+        {
+            RenderCommand* command;
+            int renderQueue;
+        };
+
+        // Queue of the commands added without one.
+        int renderQueue;
+        std::vector<Entry> commands;
+    };
+
     class Renderer : public HObject
     {
     public:
+        // Initial batch capacity in vertices. Batches grow when a frame keeps filling them, up to
+        // 65536 vertices with uint16 indices and MAX_VBO_SIZE with uint32 ones.
         static const int VBO_SIZE = 65536;
         static const int INDEX_VBO_SIZE = VBO_SIZE * 6 / 4;
+        static const int MAX_VBO_SIZE = 1 << 20;
         static const int BATCH_QUADCOMMAND_RESEVER_SIZE = 64;
         static const int MATERIAL_ID_DO_NOT_BATCH = 0;
 
+        struct BatchStats
+        {
+            // Batched quad, triangle and instanced quad draws issued since the last clear().
+            uint64 drawCalls;
+            // What drawCalls would have been with batch reordering off.
+            uint64 drawCallsWithoutReorder;
+            // Batches drawn early because they were full.
+            uint64 capacityFlushes;
+            uint64 commands;
+            uint64 materialSwitches;
+        };
+
         Renderer();
         ~Renderer();
 
@@ -85,13 +175,65 @@ namespace GRAPH
         void setClearColor(const Color4F& clearColor);
         void setDepthTest(bool enable);
 
+        // Off by default. Lets the 2D queues be reordered by material before batching, see
+        // RenderBatchReorder.
+        inline void setBatchReordering(bool enabled) { batchReordering_ = enabled; }
+        inline bool isBatchReordering() const { return batchReordering_; }
+        inline const BatchStats &getBatchStats() const { return batchStats_; }
+        // Everything counted since the last clear(), times are left to the Director.
+        RenderStats getRenderStats() const;
+
+        // uint16 by default. Can't change while rendering.
+        void setIndexType(U3DIndexType indexType);
+        inline U3DIndexType getIndexType() const { return indexType_; }
+        // Vertices a quad or triangle batch holds before it is drawn.
+        inline uint64 getQuadBatchCapacity() const { return vboArray_[QUADS].u2.bufferCapacity; }
+        inline uint64 getTriangleBatchCapacity() const { return vboArray_[TRIANGLES].u2.bufferCapacity; }
+
+        // Lets Node::visit hand subtrees to tasks of pool, see Node::isParallelVisitSafe. Null, the
+        // default, visits everything on the calling thread.
+        inline void setParallelVisitPool(WorkStealingPool* pool) { parallelVisitPool_ = pool; }
+        inline WorkStealingPool* getParallelVisitPool() const { return parallelVisitPool_; }
+        // With a pool, batched vertices are copied and transformed right before the batch is
+        // uploaded, large batches split over tasks of pool writing disjoint ranges.
+        inline void setParallelFillPool(WorkStealingPool* pool) { parallelFillPool_ = pool; }
+        inline WorkStealingPool* getParallelFillPool() const { return parallelFillPool_; }
+
+        // While it lives, commands added on the calling thread go to list instead of a render
+        // queue, the previous capture is restored when it ends, also by an exception. Group
+        // pushes are not captured, a capturing thread must not push groups.
+        class CaptureScope final
+        {
+        public:
+            explicit CaptureScope(RenderCommandList* list);
+            ~CaptureScope();
+
+        private:
+            RenderCommandList* previous_;
+
+            DISALLOW_COPY_AND_ASSIGN(CaptureScope)
+        };
+        static bool IsCapturing();
+        // An empty list for the current render queue, reused after the next render(). Not thread
+        // safe, call from the thread that renders.
+        RenderCommandList* createCommandList();
+        // Adds the captured commands as if they had been added now, in order.
+        void addCommands(const RenderCommandList& list);
+
         inline GroupCommandManager* getGroupCommandManager() const { return groupCommandManager_; }
 
     protected:
         void setupBuffer();
+        void allocateBatch(int type, uint64 vertexCapacity, uint64 indexCapacity);
+        void growBatches();
+        uint64 getMaxBatchVertices(int type) const;
+        const uint8 *getIndexBytes(int type) const;
 
         void drawBatchedTriangles();
+        void drawTriangleRun(uint64 first, uint64 last, int startIndex, int indexCount, int baseVertex);
         void drawBatchedQuads();
+        void drawInstancedQuads(const InstancedQuadCommand* cmd);
+        void expandInstancedQuads(const InstancedQuadCommand* cmd);
 
         void flush();
         void flush2D();
@@ -100,9 +242,26 @@ namespace GRAPH
 
         void processRenderCommand(RenderCommand* command);
         void visitRenderQueue(RenderQueue& queue);
+        void prepareSubQueue(std::vector<RenderCommand*>& commands);
+
+        void fillVerticesAndIndices(const TrianglesCommand* cmd, uint64 vertexOffset, uint64 indexOffset);
+        void fillQuads(const QuadCommand* cmd, uint64 quadOffset);
+        // Fills the commands batched for type when filling was left for the upload.
+        void fillBatch(int type);
 
-        void fillVerticesAndIndices(const TrianglesCommand* cmd);
-        void fillQuads(const QuadCommand* cmd);
+    private:
+        // Batched commands [first, last) of type, filled from the given offsets.
+        struct FillTask
+        {
+            Renderer* renderer;
+            int type;
+            uint64 first;
+            uint64 last;
+            uint64 vertexOffset;
+            uint64 indexOffset;
+        };
+
+        static void RunFillTask(void* data);
 
     private:
         Color4F clearColor_;
@@ -110,6 +269,13 @@ namespace GRAPH
         GroupCommandManager* groupCommandManager_;
         std::vector<RenderQueue> renderGroups_;
         std::vector<TrianglesCommand*> batchedCommands_;
+        // With base vertex draws, indices are copied as they are and every batched triangle
+        // command is drawn from the vertex its data starts at in the batch.
+        bool baseVertexDraws_;
+        std::vector<int> batchedBaseVertices_;
+        std::vector<int> drawCounts_;
+        std::vector<void*> drawIndices_;
+        std::vector<int> drawBaseVertices_;
         std::vector<QuadCommand*> batchQuadCommands_;
 
         enum
@@ -117,10 +283,29 @@ namespace GRAPH
             TRIANGLES,
             QUADS,
         };
+        // uint16 indices live in vboArray_, uint32 ones in indexData32_. Only the buffer of the
+        // current index type is allocated.
         VertexBufferObject<V3F_C4B_T2F> vboArray_[2];
+        uint32 *indexData32_[2];
+        U3DIndexType indexType_;
+        uint32 indexSize_;
+        // Vertices and indices that went through each batch type during the last render(), and
+        // whether any batch filled up.
+        uint64 renderVertices_[2];
+        uint64 renderIndices_[2];
+        bool batchFilled_[2];
         Unity3DBuffer *u3dVertexBuffer_[2];
         Unity3DBuffer *u3dIndexBuffer_[2];
         Unity3DVertexFormat *u3dVertexFormat_[2];
+        // Instanced quads draw the corners of the unit quad as a strip, once per instance. Without
+        // instancing they are expanded into the quad batch and drawn with expandedShader_.
+        bool instancedDraws_;
+        Unity3DBuffer *u3dCornerBuffer_;
+        Unity3DBuffer *u3dInstanceBuffer_;
+        Unity3DVertexFormat *u3dCornerFormat_;
+        Unity3DVertexFormat *u3dInstanceFormat_;
+        Unity3DShaderSet *instancedShader_;
+        Unity3DShaderSet *expandedShader_;
         Unity3DContext *u3dContext_;
 
         Unity3DDepthState *depthState_;
@@ -129,6 +314,16 @@ namespace GRAPH
         bool isRendering_;
         bool isDepthTestFor2D_;
         uint32 lastMaterialID_;
+
+        bool batchReordering_;
+        RenderBatchReorder batchReorder_;
+        WorkStealingPool* parallelVisitPool_;
+        WorkStealingPool* parallelFillPool_;
+        std::vector<FillTask> fillTasks_;
+        std::vector<RenderCommandList*> commandLists_;
+        uint64 usedCommandLists_;
+        BatchStats batchStats_;
+        uint64 stateChangesAtClear_;
     };
 }
 
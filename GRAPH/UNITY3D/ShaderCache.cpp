@@ -7,6 +7,7 @@ namespace GRAPH
     {
         kShaderType_PositionTextureColor,
         kShaderType_PositionTextureColor_noMVP,
+        kShaderType_PositionTextureColor_instanced,
         kShaderType_PositionTextureColorAlphaTest,
         kShaderType_PositionTextureColorAlphaTestNoMV,
         kShaderType_PositionColor,
@@ -54,6 +55,9 @@ namespace GRAPH
         p = Unity3DCreator::CreateShaderSetWithByteArray(PositionTextureColor_noMVP_vert, PositionTextureColor_noMVP_frag);
         programs_.insert(std::make_pair(Unity3DShader::SHADER_NAME_POSITION_TEXTURE_COLOR_NO_MVP, p));
 
+        p = Unity3DCreator::CreateShaderSetWithByteArray(PositionTextureColor_instanced_vert, PositionTextureColor_frag);
+        programs_.insert(std::make_pair(Unity3DShader::SHADER_NAME_POSITION_TEXTURE_COLOR_INSTANCED, p));
+
         p = Unity3DCreator::CreateShaderSetWithByteArray(PositionTextureColor_vert, PositionTextureColorAlphaTest_frag);
         programs_.insert(std::make_pair(Unity3DShader::SHADER_NAME_POSITION_TEXTURE_ALPHA_TEST, p));
 
@@ -7,6 +7,7 @@
 #include <condition_variable>
 #include <queue>
 #include <unordered_map>
+#include "BASE/SlabAllocator.h"
 #include "GRAPH/UNITY3D/Unity3D.h"
 
 namespace GRAPH
@@ -45,6 +46,8 @@ namespace GRAPH
     protected:
         struct AsyncStruct
         {
+            USE_SLAB_ALLOCATOR()
+
         public:
             AsyncStruct(const std::string& fn, std::function<void(Unity3DTexture*)> f) : filename(fn), callback(f) {}
 
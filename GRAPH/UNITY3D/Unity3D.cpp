@@ -1,5 +1,6 @@
 #include "GRAPH/UNITY3D/Unity3D.h"
 #include "GRAPH/UNITY3D/Unity3DGL.h"
+#include "GRAPH/UNITY3D/Unity3DRecord.h"
 #include "IMAGE/ImageConvert.h"
 #include "MATH/Size.h"
 
@@ -7,6 +8,7 @@ namespace GRAPH
 {
     const char* Unity3DShader::SHADER_NAME_POSITION_TEXTURE_COLOR = "ShaderPositionTextureColor";
     const char* Unity3DShader::SHADER_NAME_POSITION_TEXTURE_COLOR_NO_MVP = "ShaderPositionTextureColor_noMVP";
+    const char* Unity3DShader::SHADER_NAME_POSITION_TEXTURE_COLOR_INSTANCED = "ShaderPositionTextureColor_instanced";
     const char* Unity3DShader::SHADER_NAME_POSITION_TEXTURE_ALPHA_TEST = "ShaderPositionTextureColorAlphaTest";
     const char* Unity3DShader::SHADER_NAME_POSITION_TEXTURE_ALPHA_TEST_NO_MV = "ShaderPositionTextureColorAlphaTest_NoMV";
     const char* Unity3DShader::SHADER_NAME_POSITION_COLOR = "ShaderPositionColor";
@@ -23,6 +25,8 @@ namespace GRAPH
     const char* Unity3DShader::SHADER_NAME_LABEL_NORMAL = "ShaderLabelNormal";
     const char* Unity3DShader::SHADER_NAME_LABEL_OUTLINE = "ShaderLabelOutline";
 
+    RenderStats Unity3DContext::FrameStats;
+
     bool Unity3DTexture::initWithData(const void *data, uint64 dataLen, IMAGE::ImageFormat imageFormat, uint32 imageWidth, uint32 imageHeight) {
         U3DMipmap mipmap;
         mipmap.address = (unsigned char*) data;
@@ -104,6 +108,8 @@ namespace GRAPH
         switch (EngineMode) {
         case OPENGL:
             return Unity3DGLCreator::CreateContext();
+        case RECORDING:
+            return Unity3DRecordCreator::CreateContext();
         default:
             throw _HException_Normal("Unsupport Engine Mode!");
             break;
@@ -114,6 +120,8 @@ namespace GRAPH
         switch (EngineMode) {
         case OPENGL:
             return Unity3DGLCreator::CreateDepthState();
+        case RECORDING:
+            return Unity3DRecordCreator::CreateDepthState();
         default:
             throw _HException_Normal("Unsupport Engine Mode!");
             break;
@@ -124,6 +132,8 @@ namespace GRAPH
         switch (EngineMode) {
         case OPENGL:
             return Unity3DGLCreator::CreateBuffer(usageFlags);
+        case RECORDING:
+            return Unity3DRecordCreator::CreateBuffer(usageFlags);
         default:
             throw _HException_Normal("Unsupport Engine Mode!");
             break;
@@ -134,6 +144,8 @@ namespace GRAPH
         switch (EngineMode) {
         case OPENGL:
             return Unity3DGLCreator::CreateShaderSet(vshader, fshader);
+        case RECORDING:
+            return Unity3DRecordCreator::CreateShaderSet(vshader, fshader);
         default:
             throw _HException_Normal("Unsupport Engine Mode!");
             break;
@@ -144,6 +156,8 @@ namespace GRAPH
         switch (EngineMode) {
         case OPENGL:
             return Unity3DGLCreator::CreateShaderSetWithByteArray(vShaderByteArray, fShaderByteArray, compileTimeDefines);
+        case RECORDING:
+            return Unity3DRecordCreator::CreateShaderSetWithByteArray(vShaderByteArray, fShaderByteArray, compileTimeDefines);
         default:
             throw _HException_Normal("Unsupport Engine Mode!");
             break;
@@ -154,6 +168,8 @@ namespace GRAPH
         switch (EngineMode) {
         case OPENGL:
             return Unity3DGLCreator::CreateShaderSetWithFileName(vShaderFilename, fShaderFilename, compileTimeDefines);
+        case RECORDING:
+            return Unity3DRecordCreator::CreateShaderSetWithFileName(vShaderFilename, fShaderFilename, compileTimeDefines);
         default:
             throw _HException_Normal("Unsupport Engine Mode!");
             break;
@@ -164,6 +180,8 @@ namespace GRAPH
         switch (EngineMode) {
         case OPENGL:
             return Unity3DGLCreator::CreateVertexFormat(component);
+        case RECORDING:
+            return Unity3DRecordCreator::CreateVertexFormat(component);
         default:
             throw _HException_Normal("Unsupport Engine Mode!");
             break;
@@ -174,6 +192,8 @@ namespace GRAPH
         switch (EngineMode) {
         case OPENGL:
             return Unity3DGLCreator::CreateVertexFormat(components);
+        case RECORDING:
+            return Unity3DRecordCreator::CreateVertexFormat(components);
         default:
             throw _HException_Normal("Unsupport Engine Mode!");
             break;
@@ -184,6 +204,8 @@ namespace GRAPH
         switch (EngineMode) {
         case OPENGL:
             return Unity3DGLCreator::CreateUniformFormat(u3dShader, component);
+        case RECORDING:
+            return Unity3DRecordCreator::CreateUniformFormat(u3dShader, component);
         default:
             throw _HException_Normal("Unsupport Engine Mode!");
             break;
@@ -194,6 +216,8 @@ namespace GRAPH
         switch (EngineMode) {
         case OPENGL:
             return Unity3DGLCreator::CreateTexture(type, antialias);
+        case RECORDING:
+            return Unity3DRecordCreator::CreateTexture(type, antialias);
         default:
             throw _HException_Normal("Unsupport Engine Mode!");
             break;
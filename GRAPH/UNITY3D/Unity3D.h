@@ -78,6 +78,14 @@ namespace GRAPH
         GENERIC = 4,
         DYNAMIC = 8,
         STREAM = 16,
+        // Index data is uint32 rather than uint16. GLES2 needs OES_element_index_uint for it.
+        INDEX32 = 32,
+    };
+
+    enum U3DIndexType : uint8
+    {
+        INDEX_UINT16,
+        INDEX_UINT32,
     };
 
     enum U3DVertexDataType : uint32
@@ -226,6 +234,13 @@ namespace GRAPH
         virtual void setData(const uint8 *data, uint64 size) = 0;
         virtual void subData(const uint8 *data, uint64 offset, uint64 size) = 0;
         virtual void bind() = 0;
+
+        // Ring buffered streaming. Appends behind the data streamed before and returns the byte
+        // offset it landed at. When it doesn't fit in what is left, writing restarts at offset
+        // 0, in storage the GPU is done with (orphaned, or fenced when persistently mapped).
+        // The ring is as big as the last setData(), grown when a single stream exceeds it.
+        // Buffers meant for this should be created with STREAM.
+        virtual uint64 stream(const uint8 *data, uint64 size) = 0;
     };
 
     struct U3DVertexAttrib
@@ -239,12 +254,13 @@ namespace GRAPH
     struct U3DVertexComponent
     {
         U3DVertexComponent() { memset(this, 0, sizeof(*this)); }
-        U3DVertexComponent(U3DSemantic semantic, U3DVertexDataType dataType, int stride = 0, intptr offset = 0) {
+        U3DVertexComponent(U3DSemantic semantic, U3DVertexDataType dataType, int stride = 0, intptr offset = 0, uint32 divisor = 0) {
             memset(this, 0, sizeof(*this));
             this->type = dataType;
             this->semantic = semantic;
             this->stride = stride;
             this->offset = offset;
+            this->divisor = divisor;
         }
         uint8 semantic;
         U3DVertexDataType type;
@@ -252,6 +268,8 @@ namespace GRAPH
         intptr offset;
         int stride;
         bool normalized;
+        // 0 for per vertex data, otherwise the component advances once every divisor instances.
+        uint32 divisor;
     };
 
     class Unity3DVertexFormat : public Unity3DObject
@@ -341,6 +359,8 @@ namespace GRAPH
         static const char* SHADER_NAME_POSITION_TEXTURE_COLOR;
         /**Built in shader for 2d. Support Position, Texture and Color vertex attribute, but without multiply vertex by MVP matrix.*/
         static const char* SHADER_NAME_POSITION_TEXTURE_COLOR_NO_MVP;
+        /**Built in shader for instanced 2d quads. Reads a corner of the unit quad per vertex, an affine transform, color and texture rect per instance.*/
+        static const char* SHADER_NAME_POSITION_TEXTURE_COLOR_INSTANCED;
         /**Built in shader for 2d. Support Position, Texture vertex attribute, but include alpha test.*/
         static const char* SHADER_NAME_POSITION_TEXTURE_ALPHA_TEST;
         /**Built in shader for 2d. Support Position, Texture and Color vertex attribute, include alpha test and without multiply vertex by MVP matrix.*/
@@ -426,15 +446,53 @@ namespace GRAPH
         std::unordered_map<std::string, U3DVertexAttrib> vertexAttribs_;
     };
 
+    // Work of one frame. The backends count the calls they issue, the Renderer and the Director
+    // add the rest, see Renderer::getRenderStats().
+    struct RenderStats
+    {
+        RenderStats() { memset(this, 0, sizeof(*this)); }
+
+        uint64 drawCalls;
+        // Vertices of non indexed draws.
+        uint64 verticesDrawn;
+        uint64 indicesDrawn;
+        uint64 instancesDrawn;
+        uint64 bufferUploads;
+        uint64 bufferBytes;
+        // Unity3DGLState changes that reached GL, binds included.
+        uint64 stateChanges;
+        uint64 commands;
+        // Draw calls of the quad, triangle and instanced quad batches.
+        uint64 batches;
+        uint64 materialSwitches;
+        uint64 capacityFlushes;
+        // Microseconds.
+        uint64 frameTime;
+        uint64 renderTime;
+    };
+
     class Unity3DContext : public Unity3DObject
     {
     public:
         Unity3DContext() {}
         virtual ~Unity3DContext() {}
 
-        // TODO: Add more sophisticated draws with buffer offsets, and multidraws.
+        // Counted by every context and buffer of the backend, zeroed by Renderer::clear().
+        static RenderStats FrameStats;
+
         virtual void draw(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, int vertexCount, int offset) = 0;
         virtual void drawIndexed(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, Unity3DBuffer *idata, void *indices, int offset) = 0;
+        // baseVertex is added to every index before the vertex is fetched.
+        virtual void drawIndexedBaseVertex(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, Unity3DBuffer *idata, void *indices, int count, int baseVertex) = 0;
+        // drawIndexedBaseVertex for each i < drawCount, in one call where the backend can.
+        virtual void multiDrawIndexedBaseVertex(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, Unity3DBuffer *idata, const int *counts, void *const *indices, const int *baseVertices, int drawCount) = 0;
+        // Without it base vertices are emulated, one draw call each.
+        virtual bool supportsBaseVertex() const = 0;
+        // Draws vertexCount vertices of vdata instanceCount times. instanceFormat reads from
+        // instanceData starting instanceOffset bytes in, its components should have divisors.
+        virtual void drawInstanced(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, int vertexCount, Unity3DVertexFormat *instanceFormat, Unity3DBuffer *instanceData, uint64 instanceOffset, int instanceCount) = 0;
+        // Without it drawInstanced must not be called.
+        virtual bool supportsInstancing() const = 0;
         virtual void drawUp(U3DPrimitive prim, Unity3DVertexFormat *format, const void *vdata, int vertexCount) = 0;
         virtual void clear(int mask, uint32 colorval, float depthVal, int stencilVal) = 0;
     };
@@ -504,7 +562,9 @@ namespace GRAPH
         enum RenderEngine
         {
             OPENGL,
-            D3D
+            D3D,
+            // No GPU calls, everything goes to Unity3DRecorder. Select before the Director is created.
+            RECORDING
         };
         static RenderEngine EngineMode;
 
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "GRAPH/UNITY3D/Unity3DGL.h"
 #include "GRAPH/UNITY3D/Unity3DGLShader.h"
 #include "GRAPH/UNITY3D/TextureCache.h"
@@ -52,6 +53,28 @@ namespace GRAPH
         f[3] = ((u >> 24) & 0xFF) * (1.0f / 255.0f);
     }
 
+#if !defined(USING_GLES2) && !defined(IOS)
+    #define U3D_PERSISTENT_BUFFERS
+#endif
+
+    static bool SupportsMapBufferRange() {
+#if defined(USING_GLES2)
+        return false;
+#elif defined(IOS)
+        return true;
+#else
+        return GLEW_VERSION_3_0 || GLEW_ARB_map_buffer_range;
+#endif
+    }
+
+    static bool SupportsPersistentBuffers() {
+#ifdef U3D_PERSISTENT_BUFFERS
+        return GLEW_ARB_buffer_storage && GLEW_ARB_sync;
+#else
+        return false;
+#endif
+    }
+
     Unity3DGLBuffer::Unity3DGLBuffer(uint32 flags) {
         glGenBuffers(1, &buffer_);
         target_ = (flags & U3DBufferUsage::INDEXDATA) ? GL_ELEMENT_ARRAY_BUFFER : GL_ARRAY_BUFFER;
@@ -62,22 +85,62 @@ namespace GRAPH
             usage_ = GL_STREAM_DRAW;
         else
             usage_ = GL_STATIC_DRAW;
+        indexType_ = (flags & U3DBufferUsage::INDEX32) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
         knownSize_ = 0;
+        streamHead_ = 0;
+        persistentData_ = nullptr;
+        memset(regionFences_, 0, sizeof(regionFences_));
+        currentRegion_ = 0;
+        writtenFirst_ = -1;
+        writtenLast_ = -1;
     }
 
     Unity3DGLBuffer::~Unity3DGLBuffer() {
+        releasePersistentStorage();
+        // The next buffer may get the same name, the cached binding must not match it.
+        if (target_ == GL_ARRAY_BUFFER) {
+            Unity3DGLState::OpenGLState().arrayBuffer.unbind();
+        }
+        else {
+            Unity3DGLState::OpenGLState().elementArrayBuffer.unbind();
+        }
         glDeleteBuffers(1, &buffer_);
     }
 
     void Unity3DGLBuffer::setData(const uint8 *data, uint64 size) {
-        bind();
-        glBufferData(target_, size, data, usage_);
-        knownSize_ = size;
+        if (usage_ == GL_STREAM_DRAW && SupportsPersistentBuffers()) {
+            createPersistentStorage(size);
+            if (data) {
+                memcpy(persistentData_, data, size);
+                markWritten(0, size);
+            }
+        }
+        else {
+            bind();
+            glBufferData(target_, size, data, usage_);
+            knownSize_ = size;
+        }
+        streamHead_ = data ? size : 0;
+        if (data) {
+            Unity3DContext::FrameStats.bufferUploads++;
+            Unity3DContext::FrameStats.bufferBytes += size;
+        }
     }
 
     void Unity3DGLBuffer::subData(const uint8 *data, uint64 offset, uint64 size) {
+        Unity3DContext::FrameStats.bufferUploads++;
+        Unity3DContext::FrameStats.bufferBytes += size;
+        if (persistentData_) {
+            if (offset + size > knownSize_) {
+                throw _HException_Normal("Unity3DGLBuffer: subData outside persistent storage");
+            }
+            memcpy(persistentData_ + offset, data, size);
+            markWritten(offset, size);
+            return;
+        }
+
         bind();
-        if (size > knownSize_) {
+        if (offset + size > knownSize_) {
             // Allocate the buffer.
             glBufferData(target_, size + offset, nullptr, usage_);
             knownSize_ = size + offset;
@@ -85,6 +148,158 @@ namespace GRAPH
         glBufferSubData(target_, offset, size, data);
     }
 
+    uint64 Unity3DGLBuffer::stream(const uint8 *data, uint64 size) {
+        Unity3DContext::FrameStats.bufferUploads++;
+        Unity3DContext::FrameStats.bufferBytes += size;
+        if (persistentData_) {
+            if (size > knownSize_) {
+                createPersistentStorage(size);
+            }
+            fenceWrittenRegions();
+
+            // Entering a region waits for the GPU to be done with what was written there a lap
+            // ago. A stream as big as the whole ring is correct, but waits for everything.
+            uint64 offset = streamHead_;
+            if (offset + size > knownSize_) {
+                do {
+                    enterRegion((currentRegion_ + 1) % STREAM_REGIONS);
+                } while (currentRegion_ != 0);
+                offset = 0;
+            }
+            int lastRegion = regionOf(offset + size - 1);
+            while (currentRegion_ != lastRegion) {
+                enterRegion(currentRegion_ + 1);
+            }
+
+            memcpy(persistentData_ + offset, data, size);
+            markWritten(offset, size);
+            streamHead_ = offset + size;
+            return offset;
+        }
+
+        bind();
+        uint64 offset = streamHead_;
+        if (offset + size > knownSize_) {
+            // Orphan: the driver hands out fresh storage and frees the old one once the GPU is done.
+            knownSize_ = std::max(knownSize_, size);
+            glBufferData(target_, knownSize_, nullptr, usage_);
+            offset = 0;
+        }
+
+        if (SupportsMapBufferRange()) {
+#ifndef USING_GLES2
+            // Nothing in flight reads this range before the next orphan, no sync is needed.
+            void *mapped = glMapBufferRange(target_, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            if (mapped) {
+                memcpy(mapped, data, size);
+                glUnmapBuffer(target_);
+            }
+            else {
+                glBufferSubData(target_, offset, size, data);
+            }
+#endif
+        }
+        else {
+            glBufferSubData(target_, offset, size, data);
+        }
+
+        streamHead_ = offset + size;
+        return offset;
+    }
+
+    void Unity3DGLBuffer::createPersistentStorage(uint64 size) {
+#ifdef U3D_PERSISTENT_BUFFERS
+        // Storage is immutable, resizing takes a new buffer object.
+        releasePersistentStorage();
+        if (target_ == GL_ARRAY_BUFFER) {
+            Unity3DGLState::OpenGLState().arrayBuffer.unbind();
+        }
+        else {
+            Unity3DGLState::OpenGLState().elementArrayBuffer.unbind();
+        }
+        glDeleteBuffers(1, &buffer_);
+        glGenBuffers(1, &buffer_);
+
+        bind();
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target_, size, nullptr, flags);
+        persistentData_ = (uint8 *) glMapBufferRange(target_, 0, size, flags);
+        if (!persistentData_) {
+            throw _HException_Normal("Unity3DGLBuffer: unable to map persistent storage");
+        }
+        knownSize_ = size;
+        streamHead_ = 0;
+        currentRegion_ = 0;
+        writtenFirst_ = -1;
+        writtenLast_ = -1;
+#else
+        UNUSED(size);
+#endif
+    }
+
+    void Unity3DGLBuffer::releasePersistentStorage() {
+#ifdef U3D_PERSISTENT_BUFFERS
+        if (!persistentData_) {
+            return;
+        }
+
+        bind();
+        glUnmapBuffer(target_);
+        persistentData_ = nullptr;
+        for (auto &fence : regionFences_) {
+            if (fence) {
+                glDeleteSync((GLsync) fence);
+                fence = nullptr;
+            }
+        }
+#endif
+    }
+
+    int Unity3DGLBuffer::regionOf(uint64 offset) const {
+        uint64 regionSize = std::max<uint64>(knownSize_ / STREAM_REGIONS, 1);
+        return (int) std::min<uint64>(offset / regionSize, STREAM_REGIONS - 1);
+    }
+
+    void Unity3DGLBuffer::markWritten(uint64 offset, uint64 size) {
+        if (size == 0) {
+            return;
+        }
+        int first = regionOf(offset);
+        int last = regionOf(offset + size - 1);
+        writtenFirst_ = writtenFirst_ < 0 ? first : std::min(writtenFirst_, first);
+        writtenLast_ = std::max(writtenLast_, last);
+    }
+
+    void Unity3DGLBuffer::fenceWrittenRegions() {
+#ifdef U3D_PERSISTENT_BUFFERS
+        // Draws reading the data written before are all issued by now. A region fenced again
+        // only needs the newest fence, it completes after the older ones.
+        for (int region = writtenFirst_; region >= 0 && region <= writtenLast_; ++region) {
+            if (regionFences_[region]) {
+                glDeleteSync((GLsync) regionFences_[region]);
+            }
+            regionFences_[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        writtenFirst_ = -1;
+        writtenLast_ = -1;
+#endif
+    }
+
+    void Unity3DGLBuffer::enterRegion(int region) {
+#ifdef U3D_PERSISTENT_BUFFERS
+        currentRegion_ = region;
+        GLsync fence = (GLsync) regionFences_[region];
+        if (fence) {
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+            }
+            glDeleteSync(fence);
+            regionFences_[region] = nullptr;
+        }
+#else
+        UNUSED(region);
+#endif
+    }
+
     void Unity3DGLBuffer::bind() {
         if (target_ == GL_ARRAY_BUFFER) {
             Unity3DGLState::OpenGLState().arrayBuffer.bind(buffer_);
@@ -199,6 +414,14 @@ namespace GRAPH
                 glVertexAttribPointer(components_[i].semantic, components_[i].size, components_[i].type, components_[i].normalized, components_[i].stride, (void *) (b + (intptr) components_[i].offset));
             }
         }
+
+#if !defined(USING_GLES2) && !defined(IOS)
+        for (uint64 i = 0; i < components_.size(); i++) {
+            if (components_[i].divisor != 0) {
+                glVertexAttribDivisor(components_[i].semantic, components_[i].divisor);
+            }
+        }
+#endif
     }
 
     void Unity3DGLVertexFormat::unApply() {
@@ -207,14 +430,28 @@ namespace GRAPH
                 glDisableVertexAttribArray(i);
             }
         }
+
+        // Divisors stick to the attribute, the next format may use it per vertex.
+#if !defined(USING_GLES2) && !defined(IOS)
+        for (int i = 0; i < SEM_MAX; i++) {
+            if (divisorsMask_ & (1 << i)) {
+                glVertexAttribDivisor(i, 0);
+            }
+        }
+#endif
     }
 
     void Unity3DGLVertexFormat::compile() {
         int sem = 0;
+        int divisors = 0;
         for (int i = 0; i < (int) components_.size(); i++) {
             sem |= 1 << components_[i].semantic;
+            if (components_[i].divisor != 0) {
+                divisors |= 1 << components_[i].semantic;
+            }
         }
         semanticsMask_ = sem;
+        divisorsMask_ = divisors;
     }
 
     void Unity3DGLContext::draw(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, int vertexCount, int offset) {
@@ -225,6 +462,8 @@ namespace GRAPH
         fmt->apply();
 
         glDrawArrays(primToGL[prim], offset, vertexCount);
+        FrameStats.drawCalls++;
+        FrameStats.verticesDrawn += vertexCount;
 
         fmt->unApply();
     }
@@ -238,11 +477,111 @@ namespace GRAPH
         ibuf->bind();
         fmt->apply();
 
-        glDrawElements(primToGL[prim], offset, GL_UNSIGNED_SHORT, indices);
+        glDrawElements(primToGL[prim], offset, ibuf->getIndexType(), indices);
+        FrameStats.drawCalls++;
+        FrameStats.indicesDrawn += offset;
 
         fmt->unApply();
     }
 
+    bool Unity3DGLContext::supportsBaseVertex() const {
+#if defined(USING_GLES2) || defined(IOS)
+        return false;
+#else
+        return GLEW_VERSION_3_2 || GLEW_ARB_draw_elements_base_vertex;
+#endif
+    }
+
+    void Unity3DGLContext::drawIndexedBaseVertex(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, Unity3DBuffer *idata, void *indices, int count, int baseVertex) {
+        Unity3DGLBuffer *vbuf = static_cast<Unity3DGLBuffer *>(vdata);
+        Unity3DGLBuffer *ibuf = static_cast<Unity3DGLBuffer *>(idata);
+        Unity3DGLVertexFormat *fmt = static_cast<Unity3DGLVertexFormat *>(format);
+
+        vbuf->bind();
+        ibuf->bind();
+
+#if !defined(USING_GLES2) && !defined(IOS)
+        if (supportsBaseVertex()) {
+            fmt->apply();
+            glDrawElementsBaseVertex(primToGL[prim], count, ibuf->getIndexType(), indices, baseVertex);
+            fmt->unApply();
+            FrameStats.drawCalls++;
+            FrameStats.indicesDrawn += count;
+            return;
+        }
+#endif
+
+        // Start the attribute pointers at the base vertex instead.
+        intptr stride = fmt->components().empty() ? 0 : fmt->components()[0].stride;
+        fmt->apply((const void *) (stride * baseVertex));
+        glDrawElements(primToGL[prim], count, ibuf->getIndexType(), indices);
+        fmt->unApply();
+        FrameStats.drawCalls++;
+        FrameStats.indicesDrawn += count;
+    }
+
+    void Unity3DGLContext::multiDrawIndexedBaseVertex(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, Unity3DBuffer *idata, const int *counts, void *const *indices, const int *baseVertices, int drawCount) {
+#if !defined(USING_GLES2) && !defined(IOS)
+        if (supportsBaseVertex()) {
+            Unity3DGLBuffer *ibuf = static_cast<Unity3DGLBuffer *>(idata);
+            Unity3DGLVertexFormat *fmt = static_cast<Unity3DGLVertexFormat *>(format);
+
+            static_cast<Unity3DGLBuffer *>(vdata)->bind();
+            ibuf->bind();
+            fmt->apply();
+            glMultiDrawElementsBaseVertex(primToGL[prim], counts, ibuf->getIndexType(), indices, drawCount, baseVertices);
+            fmt->unApply();
+            FrameStats.drawCalls++;
+            for (int i = 0; i < drawCount; ++i) {
+                FrameStats.indicesDrawn += counts[i];
+            }
+            return;
+        }
+#endif
+
+        for (int i = 0; i < drawCount; ++i) {
+            drawIndexedBaseVertex(prim, format, vdata, idata, indices[i], counts[i], baseVertices[i]);
+        }
+    }
+
+    bool Unity3DGLContext::supportsInstancing() const {
+#if defined(USING_GLES2) || defined(IOS)
+        return false;
+#else
+        return GLEW_VERSION_3_3 || (GLEW_ARB_draw_instanced && GLEW_ARB_instanced_arrays);
+#endif
+    }
+
+    void Unity3DGLContext::drawInstanced(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, int vertexCount, Unity3DVertexFormat *instanceFormat, Unity3DBuffer *instanceData, uint64 instanceOffset, int instanceCount) {
+#if !defined(USING_GLES2) && !defined(IOS)
+        Unity3DGLVertexFormat *fmt = static_cast<Unity3DGLVertexFormat *>(format);
+        Unity3DGLVertexFormat *instanceFmt = static_cast<Unity3DGLVertexFormat *>(instanceFormat);
+
+        // Attribute pointers take the buffer bound when they are set.
+        static_cast<Unity3DGLBuffer *>(vdata)->bind();
+        fmt->apply();
+        static_cast<Unity3DGLBuffer *>(instanceData)->bind();
+        instanceFmt->apply((const void *) (intptr) instanceOffset);
+
+        glDrawArraysInstanced(primToGL[prim], 0, vertexCount, instanceCount);
+        FrameStats.drawCalls++;
+        FrameStats.instancesDrawn += instanceCount;
+
+        instanceFmt->unApply();
+        fmt->unApply();
+#else
+        UNUSED(prim);
+        UNUSED(format);
+        UNUSED(vdata);
+        UNUSED(vertexCount);
+        UNUSED(instanceFormat);
+        UNUSED(instanceData);
+        UNUSED(instanceOffset);
+        UNUSED(instanceCount);
+        throw _HException_Normal("Unity3DGLContext: instanced draws are not supported");
+#endif
+    }
+
     void Unity3DGLContext::drawUp(U3DPrimitive prim, Unity3DVertexFormat *format, const void *vdata, int vertexCount) {
         Unity3DGLState::OpenGLState().arrayBuffer.bind(0);
 
@@ -251,6 +590,8 @@ namespace GRAPH
         fmt->apply(vdata);
 
         glDrawArrays(primToGL[prim], 0, vertexCount);
+        FrameStats.drawCalls++;
+        FrameStats.verticesDrawn += vertexCount;
 
         fmt->unApply();
     }
@@ -410,6 +751,10 @@ namespace GRAPH
     }
 
     const IMAGE::ImageFormatInfoMap &Unity3DGLTexture::imageFormatInfoMap() {
+        return FormatInfoMap();
+    }
+
+    const IMAGE::ImageFormatInfoMap &Unity3DGLTexture::FormatInfoMap() {
         static const IMAGE::ImageFormatInfoMapValue TexturePixelFormatInfoTablesValue [] =
         {
             IMAGE::ImageFormatInfoMapValue(IMAGE::ImageFormat::BGRA8888, IMAGE::ImageFormatInfo(GL_BGRA, GL_BGRA, GL_UNSIGNED_BYTE, 32, false, true)),
@@ -41,12 +41,36 @@ namespace GRAPH
         void setData(const uint8 *data, uint64 size) override;
         void subData(const uint8 *data, uint64 offset, uint64 size) override;
         void bind() override;
+        uint64 stream(const uint8 *data, uint64 size) override;
+
+        inline GLenum getIndexType() const { return indexType_; }
 
     private:
+        // Regions of a persistently mapped ring. The draws reading a write are issued before the
+        // next stream(), which fences the regions the write touched.
+        static const int STREAM_REGIONS = 4;
+
+        void createPersistentStorage(uint64 size);
+        void releasePersistentStorage();
+        int regionOf(uint64 offset) const;
+        void markWritten(uint64 offset, uint64 size);
+        void fenceWrittenRegions();
+        void enterRegion(int region);
+
         GLuint buffer_;
         GLuint target_;
         GLuint usage_;
+        GLenum indexType_;
         uint64 knownSize_;
+
+        uint64 streamHead_;
+        uint8 *persistentData_;
+        // GLsync, which GLES2 headers lack.
+        void *regionFences_[STREAM_REGIONS];
+        int currentRegion_;
+        // Regions written since the last fenceWrittenRegions(), -1 when none.
+        int writtenFirst_;
+        int writtenLast_;
     };
 
     class Unity3DGLVertexFormat final : public Unity3DVertexFormat
@@ -60,6 +84,7 @@ namespace GRAPH
 
     protected:
         int semanticsMask_;
+        int divisorsMask_;
     };
 
     class Unity3DGLUniformFormat final : public Unity3DUniformFormat
@@ -89,9 +114,13 @@ namespace GRAPH
         Unity3DGLContext() {}
         ~Unity3DGLContext() {}
 
-        // TODO: Add more sophisticated draws with buffer offsets, and multidraws.
         void draw(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, int vertexCount, int offset) override;
         void drawIndexed(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, Unity3DBuffer *idata, void *indices, int offset) override;
+        void drawIndexedBaseVertex(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, Unity3DBuffer *idata, void *indices, int count, int baseVertex) override;
+        void multiDrawIndexedBaseVertex(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, Unity3DBuffer *idata, const int *counts, void *const *indices, const int *baseVertices, int drawCount) override;
+        bool supportsBaseVertex() const override;
+        void drawInstanced(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, int vertexCount, Unity3DVertexFormat *instanceFormat, Unity3DBuffer *instanceData, uint64 instanceOffset, int instanceCount) override;
+        bool supportsInstancing() const override;
         void drawUp(U3DPrimitive prim, Unity3DVertexFormat *format, const void *vdata, int vertexCount) override;
         void clear(int mask, uint32 colorval, float depthVal, int stencilVal) override;
     };
@@ -125,6 +154,7 @@ namespace GRAPH
         bool hasMipmaps() const override { return hasMipmaps_; }
 
         const IMAGE::ImageFormatInfoMap &imageFormatInfoMap() override;
+        static const IMAGE::ImageFormatInfoMap &FormatInfoMap();
 
     private:
         GLuint target_;
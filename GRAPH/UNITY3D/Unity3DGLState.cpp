@@ -3,7 +3,9 @@
 
 namespace GRAPH
 {
+    Unity3DGLState::StateSink *Unity3DGLState::Sink = nullptr;
     int Unity3DGLState::state_count = 0;
+    uint64 Unity3DGLState::change_count = 0;
 
     Unity3DGLState &Unity3DGLState::OpenGLState() {
         static Unity3DGLState instance;
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <string.h>
+#include "BASE/Honey.h"
 #include "GRAPH/UNITY3D/GLCommon.h"
 
 namespace GRAPH
@@ -21,13 +22,9 @@ namespace GRAPH
             }
 
             inline void set(bool value) {
-                if(value && value != _value) {
+                if(value != _value) {
                     _value = value;
-                    glEnable(cap);
-                }
-                if(!value && value != _value) {
-                    _value = value;
-                    glDisable(cap);
+                    apply();
                 }
             }
             inline bool get() {
@@ -46,7 +43,14 @@ namespace GRAPH
                 return _value;
             }
             void restore() {
-                if(_value)
+                apply();
+            }
+        private:
+            inline void apply() {
+                Unity3DGLState::change_count++;
+                if(Unity3DGLState::Sink)
+                    Unity3DGLState::Sink->stateChanged(_value ? "glEnable" : "glDisable");
+                else if(_value)
                     glEnable(cap);
                 else
                     glDisable(cap);
@@ -63,14 +67,14 @@ namespace GRAPH
             void set(p1type newp1) { \
                 if(newp1 != p1) { \
                     p1 = newp1; \
-                    func(p1); \
+                    Unity3DGLState::change_count++; if(Unity3DGLState::Sink) Unity3DGLState::Sink->stateChanged(#func); else func(p1); \
                                 } \
                     } \
             p1type get() { \
                 return p1; \
             } \
             void restore() { \
-                func(p1); \
+                Unity3DGLState::change_count++; if(Unity3DGLState::Sink) Unity3DGLState::Sink->stateChanged(#func); else func(p1); \
             } \
         }
 
@@ -86,11 +90,11 @@ namespace GRAPH
                 if(newp1 != p1 || newp2 != p2) { \
                     p1 = newp1; \
                     p2 = newp2; \
-                    func(p1, p2); \
+                    Unity3DGLState::change_count++; if(Unity3DGLState::Sink) Unity3DGLState::Sink->stateChanged(#func); else func(p1, p2); \
                 } \
             } \
             inline void restore() { \
-                func(p1, p2); \
+                Unity3DGLState::change_count++; if(Unity3DGLState::Sink) Unity3DGLState::Sink->stateChanged(#func); else func(p1, p2); \
             } \
         }
 
@@ -108,11 +112,11 @@ namespace GRAPH
                     p1 = newp1; \
                     p2 = newp2; \
                     p3 = newp3; \
-                    func(p1, p2, p3); \
+                    Unity3DGLState::change_count++; if(Unity3DGLState::Sink) Unity3DGLState::Sink->stateChanged(#func); else func(p1, p2, p3); \
                 } \
             } \
             inline void restore() { \
-                func(p1, p2, p3); \
+                Unity3DGLState::change_count++; if(Unity3DGLState::Sink) Unity3DGLState::Sink->stateChanged(#func); else func(p1, p2, p3); \
             } \
         }
 
@@ -132,11 +136,11 @@ namespace GRAPH
                     p2 = newp2; \
                     p3 = newp3; \
                     p4 = newp4; \
-                    func(p1, p2, p3, p4); \
+                    Unity3DGLState::change_count++; if(Unity3DGLState::Sink) Unity3DGLState::Sink->stateChanged(#func); else func(p1, p2, p3, p4); \
                 } \
             } \
             inline void restore() { \
-                func(p1, p2, p3, p4); \
+                Unity3DGLState::change_count++; if(Unity3DGLState::Sink) Unity3DGLState::Sink->stateChanged(#func); else func(p1, p2, p3, p4); \
             } \
         }
 
@@ -151,11 +155,11 @@ namespace GRAPH
             inline void set(const float v[4]) { \
                 if(memcmp(p,v,sizeof(float)*4)) { \
                     memcpy(p,v,sizeof(float)*4); \
-                    func(p[0], p[1], p[2], p[3]); \
+                    Unity3DGLState::change_count++; if(Unity3DGLState::Sink) Unity3DGLState::Sink->stateChanged(#func); else func(p[0], p[1], p[2], p[3]); \
                 } \
             } \
             inline void restore() { \
-                func(p[0], p[1], p[2], p[3]); \
+                Unity3DGLState::change_count++; if(Unity3DGLState::Sink) Unity3DGLState::Sink->stateChanged(#func); else func(p[0], p[1], p[2], p[3]); \
             } \
         }
 
@@ -169,7 +173,7 @@ namespace GRAPH
             } \
             inline void bind(GLuint val) { \
                 if (val_ != val) { \
-                    func(target, val); \
+                    Unity3DGLState::change_count++; if(Unity3DGLState::Sink) Unity3DGLState::Sink->stateChanged(#func); else func(target, val); \
                     val_ = val; \
                 } \
             } \
@@ -177,7 +181,7 @@ namespace GRAPH
                 bind(0); \
             } \
             inline void restore() { \
-                func(target, val_); \
+                Unity3DGLState::change_count++; if(Unity3DGLState::Sink) Unity3DGLState::Sink->stateChanged(#func); else func(target, val_); \
             } \
         }
 
@@ -201,7 +205,19 @@ namespace GRAPH
         }
 
     public:
+        // Takes the GL calls of every state below while installed, the cached values are
+        // still tracked. Used by the recording backend, which must not touch GL.
+        class StateSink
+        {
+        public:
+            virtual ~StateSink() {}
+            virtual void stateChanged(const char *function) = 0;
+        };
+
+        static StateSink *Sink;
         static int state_count;
+        // Changes sent to GL or the sink, restores included.
+        static uint64 change_count;
         static Unity3DGLState &OpenGLState();
 
         void restore();
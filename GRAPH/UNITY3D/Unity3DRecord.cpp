@@ -0,0 +1,690 @@
+#include <algorithm>
+#include <ctype.h>
+#include "GRAPH/UNITY3D/Unity3DRecord.h"
+#include "GRAPH/UNITY3D/Unity3DGL.h"
+#include "GRAPH/UNITY3D/Unity3DGLShader.h"
+#include "GRAPH/Director.h"
+#include "IO/FileUtils.h"
+#include "UTILS/RANDOM/RandomUtils.h"
+#include "UTILS/STRING/StringUtils.h"
+
+namespace GRAPH
+{
+    static const struct {
+        const char *typeName;
+        uint32 type;
+    } GLSLTypes [] =
+    {
+        { "float", GL_FLOAT },
+        { "vec2", GL_FLOAT_VEC2 },
+        { "vec3", GL_FLOAT_VEC3 },
+        { "vec4", GL_FLOAT_VEC4 },
+        { "int", GL_INT },
+        { "ivec2", GL_INT_VEC2 },
+        { "ivec3", GL_INT_VEC3 },
+        { "ivec4", GL_INT_VEC4 },
+        { "bool", GL_BOOL },
+        { "mat2", GL_FLOAT_MAT2 },
+        { "mat3", GL_FLOAT_MAT3 },
+        { "mat4", GL_FLOAT_MAT4 },
+        { "sampler2D", GL_SAMPLER_2D },
+        { "samplerCube", GL_SAMPLER_CUBE },
+    };
+
+    static uint32 GLSLTypeToGL(const std::string &typeName) {
+        for (const auto &entry : GLSLTypes) {
+            if (typeName == entry.typeName) {
+                return entry.type;
+            }
+        }
+        return 0;
+    }
+
+    // Identifiers, numbers and single punctuation characters, comments dropped.
+    static void TokenizeGLSL(const std::string &source, std::vector<std::string> &tokens) {
+        uint64 i = 0;
+        const uint64 length = source.size();
+        while (i < length) {
+            char c = source[i];
+            if (c == '/' && i + 1 < length && source[i + 1] == '/') {
+                while (i < length && source[i] != '\n') {
+                    ++i;
+                }
+            }
+            else if (c == '/' && i + 1 < length && source[i + 1] == '*') {
+                uint64 end = source.find("*/", i + 2);
+                i = end == std::string::npos ? length : end + 2;
+            }
+            else if (isalnum((unsigned char) c) || c == '_') {
+                uint64 start = i;
+                while (i < length && (isalnum((unsigned char) source[i]) || source[i] == '_')) {
+                    ++i;
+                }
+                tokens.push_back(source.substr(start, i - start));
+            }
+            else {
+                if (!isspace((unsigned char) c)) {
+                    tokens.push_back(std::string(1, c));
+                }
+                ++i;
+            }
+        }
+    }
+
+    Unity3DRecorder &Unity3DRecorder::getInstance() {
+        static Unity3DRecorder instance;
+        return instance;
+    }
+
+    Unity3DRecorder::Unity3DRecorder()
+        : lastObject_(0)
+        , logEnabled_(true) {
+        Unity3DGLState::Sink = this;
+    }
+
+    void Unity3DRecorder::stateChanged(const char *function) {
+        record(U3DRecordEvent::STATE_CHANGE, 0, 0, 0, 0, function);
+    }
+
+    void Unity3DRecorder::record(U3DRecordEvent::Type type, uint32 object, uint64 count, uint64 offset, uint8 primitive, const char *name) {
+        switch (type) {
+        case U3DRecordEvent::DRAW:
+        case U3DRecordEvent::DRAW_UP:
+            counters_.drawCalls++;
+            counters_.verticesDrawn += count;
+            Unity3DContext::FrameStats.drawCalls++;
+            Unity3DContext::FrameStats.verticesDrawn += count;
+            break;
+        case U3DRecordEvent::DRAW_INDEXED:
+            counters_.drawCalls++;
+            counters_.indicesDrawn += count;
+            Unity3DContext::FrameStats.drawCalls++;
+            Unity3DContext::FrameStats.indicesDrawn += count;
+            break;
+        case U3DRecordEvent::DRAW_INSTANCED:
+            counters_.drawCalls++;
+            counters_.instancesDrawn += count;
+            Unity3DContext::FrameStats.drawCalls++;
+            Unity3DContext::FrameStats.instancesDrawn += count;
+            break;
+        case U3DRecordEvent::CLEAR:
+            counters_.clears++;
+            break;
+        case U3DRecordEvent::STATE_CHANGE:
+            counters_.stateChanges++;
+            break;
+        case U3DRecordEvent::VERTEX_FORMAT:
+            counters_.vertexFormatApplies++;
+            break;
+        case U3DRecordEvent::UNIFORM:
+            counters_.uniformUpdates++;
+            break;
+        case U3DRecordEvent::BUFFER_UPLOAD:
+            counters_.bufferUploads++;
+            counters_.bufferBytes += count;
+            if (count) {
+                Unity3DContext::FrameStats.bufferUploads++;
+                Unity3DContext::FrameStats.bufferBytes += count;
+            }
+            break;
+        case U3DRecordEvent::TEXTURE_UPLOAD:
+            counters_.textureUploads++;
+            counters_.textureBytes += count;
+            break;
+        }
+
+        if (logEnabled_) {
+            U3DRecordEvent event;
+            event.type = type;
+            event.primitive = primitive;
+            event.object = object;
+            event.count = count;
+            event.offset = offset;
+            event.name = name;
+            events_.push_back(event);
+        }
+    }
+
+    void Unity3DRecorder::reset() {
+        counters_ = U3DRecordCounters();
+        events_.clear();
+    }
+
+    Unity3DRecordBuffer::Unity3DRecordBuffer(uint32 flags)
+        : buffer_(Unity3DRecorder::getInstance().createObject())
+        , indexData_((flags & U3DBufferUsage::INDEXDATA) != 0)
+        , knownSize_(0)
+        , streamHead_(0)
+        , streamWraps_(0) {
+    }
+
+    void Unity3DRecordBuffer::setData(const uint8 *data, uint64 size) {
+        bind();
+        Unity3DRecorder::getInstance().record(U3DRecordEvent::BUFFER_UPLOAD, buffer_, data ? size : 0);
+        knownSize_ = size;
+        streamHead_ = data ? size : 0;
+    }
+
+    void Unity3DRecordBuffer::subData(const uint8 *data, uint64 offset, uint64 size) {
+        UNUSED(data);
+        bind();
+        if (offset + size > knownSize_) {
+            knownSize_ = size + offset;
+        }
+        Unity3DRecorder::getInstance().record(U3DRecordEvent::BUFFER_UPLOAD, buffer_, size, offset);
+    }
+
+    uint64 Unity3DRecordBuffer::stream(const uint8 *data, uint64 size) {
+        UNUSED(data);
+        bind();
+        uint64 offset = streamHead_;
+        if (offset + size > knownSize_) {
+            knownSize_ = std::max(knownSize_, size);
+            offset = 0;
+            streamWraps_++;
+        }
+        Unity3DRecorder::getInstance().record(U3DRecordEvent::BUFFER_UPLOAD, buffer_, size, offset);
+        streamHead_ = offset + size;
+        return offset;
+    }
+
+    void Unity3DRecordBuffer::bind() {
+        if (indexData_) {
+            Unity3DGLState::OpenGLState().elementArrayBuffer.bind(buffer_);
+        }
+        else {
+            Unity3DGLState::OpenGLState().arrayBuffer.bind(buffer_);
+        }
+    }
+
+    Unity3DRecordVertexFormat::Unity3DRecordVertexFormat(const U3DVertexComponent &component) {
+        components_.push_back(component);
+    }
+
+    Unity3DRecordVertexFormat::Unity3DRecordVertexFormat(const std::vector<U3DVertexComponent> &components) {
+        components_ = components;
+    }
+
+    void Unity3DRecordVertexFormat::apply(const void *base) {
+        for (const auto &component : components_) {
+            if (component.type == INVALID) {
+                throw _HException_Normal("Unity3DRecordVertexFormat: Invalid component type applied");
+            }
+        }
+        Unity3DRecorder::getInstance().record(U3DRecordEvent::VERTEX_FORMAT, 0, components_.size(), (uint64) base);
+    }
+
+    void Unity3DRecordVertexFormat::unApply() {
+    }
+
+    void Unity3DRecordContext::draw(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, int vertexCount, int offset) {
+        Unity3DRecordBuffer *vbuf = static_cast<Unity3DRecordBuffer *>(vdata);
+
+        vbuf->bind();
+        format->apply();
+
+        Unity3DRecorder::getInstance().record(U3DRecordEvent::DRAW, Unity3DGLState::OpenGLState().useProgram.get(), vertexCount, offset, (uint8) prim);
+    }
+
+    void Unity3DRecordContext::drawIndexed(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, Unity3DBuffer *idata, void *indices, int offset) {
+        vdata->bind();
+        idata->bind();
+        format->apply();
+
+        Unity3DRecorder::getInstance().record(U3DRecordEvent::DRAW_INDEXED, Unity3DGLState::OpenGLState().useProgram.get(), offset, (uint64) indices, (uint8) prim);
+    }
+
+    void Unity3DRecordContext::drawIndexedBaseVertex(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, Unity3DBuffer *idata, void *indices, int count, int baseVertex) {
+        UNUSED(baseVertex);
+        drawIndexed(prim, format, vdata, idata, indices, count);
+    }
+
+    void Unity3DRecordContext::multiDrawIndexedBaseVertex(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, Unity3DBuffer *idata, const int *counts, void *const *indices, const int *baseVertices, int drawCount) {
+        UNUSED(baseVertices);
+        if (drawCount <= 0) {
+            return;
+        }
+
+        // One call, recorded as a single draw of all indices.
+        uint64 count = 0;
+        for (int i = 0; i < drawCount; ++i) {
+            count += counts[i];
+        }
+        vdata->bind();
+        idata->bind();
+        format->apply();
+
+        Unity3DRecorder::getInstance().record(U3DRecordEvent::DRAW_INDEXED, Unity3DGLState::OpenGLState().useProgram.get(), count, (uint64) indices[0], (uint8) prim);
+    }
+
+    void Unity3DRecordContext::drawInstanced(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, int vertexCount, Unity3DVertexFormat *instanceFormat, Unity3DBuffer *instanceData, uint64 instanceOffset, int instanceCount) {
+        UNUSED(vertexCount);
+        vdata->bind();
+        format->apply();
+        instanceData->bind();
+        instanceFormat->apply((const void *) (intptr) instanceOffset);
+
+        Unity3DRecorder::getInstance().record(U3DRecordEvent::DRAW_INSTANCED, Unity3DGLState::OpenGLState().useProgram.get(), instanceCount, instanceOffset, (uint8) prim);
+    }
+
+    void Unity3DRecordContext::drawUp(U3DPrimitive prim, Unity3DVertexFormat *format, const void *vdata, int vertexCount) {
+        Unity3DGLState::OpenGLState().arrayBuffer.bind(0);
+
+        format->apply(vdata);
+
+        Unity3DRecorder::getInstance().record(U3DRecordEvent::DRAW_UP, Unity3DGLState::OpenGLState().useProgram.get(), vertexCount, 0, (uint8) prim);
+    }
+
+    void Unity3DRecordContext::clear(int mask, uint32 colorval, float depthVal, int stencilVal) {
+        UNUSED(colorval);
+        UNUSED(depthVal);
+        UNUSED(stencilVal);
+        Unity3DRecorder::getInstance().record(U3DRecordEvent::CLEAR, 0, (uint64) mask);
+    }
+
+    Unity3DRecordShaderSet::Unity3DRecordShaderSet(const std::string &vShaderSource, const std::string &fShaderSource)
+        : program_(0)
+        , sources_(vShaderSource + "\n" + fShaderSource) {
+    }
+
+    int Unity3DRecordShaderSet::name() {
+        return (int) program_;
+    }
+
+    void Unity3DRecordShaderSet::link() {
+        program_ = Unity3DRecorder::getInstance().createObject();
+
+        vertexAttribs_.clear();
+        userUniforms_.clear();
+        uniformLocations_.clear();
+        uniformValues_.clear();
+
+        parseDeclarations(sources_);
+
+        static const char *builtInNames [BUILTIN_MAX] =
+        {
+            Unity3DGLShaderSet::UNIFORM_NAME_P_MATRIX,
+            Unity3DGLShaderSet::UNIFORM_NAME_MV_MATRIX,
+            Unity3DGLShaderSet::UNIFORM_NAME_MVP_MATRIX,
+            Unity3DGLShaderSet::UNIFORM_NAME_NORMAL_MATRIX,
+            Unity3DGLShaderSet::UNIFORM_NAME_RANDOM01,
+            Unity3DGLShaderSet::UNIFORM_NAME_SAMPLER0,
+            Unity3DGLShaderSet::UNIFORM_NAME_SAMPLER1,
+            Unity3DGLShaderSet::UNIFORM_NAME_SAMPLER2,
+            Unity3DGLShaderSet::UNIFORM_NAME_SAMPLER3,
+        };
+
+        // Builtins are declared by the GL shader prologue, a shader uses one by naming it.
+        std::vector<std::string> tokens;
+        TokenizeGLSL(sources_, tokens);
+        for (int i = 0; i < BUILTIN_MAX; ++i) {
+            builtInUniforms_[i] = -1;
+            if (std::find(tokens.begin(), tokens.end(), builtInNames[i]) != tokens.end()) {
+                builtInUniforms_[i] = (int32) uniformLocations_.size();
+                uniformLocations_[builtInNames[i]] = builtInUniforms_[i];
+            }
+        }
+
+        apply();
+
+        for (int i = BUILTIN_SAMPLER0; i <= BUILTIN_SAMPLER3; ++i) {
+            if (builtInUniforms_[i] != -1) {
+                setUniformLocationWith1i(builtInUniforms_[i], i - BUILTIN_SAMPLER0);
+            }
+        }
+    }
+
+    void Unity3DRecordShaderSet::parseDeclarations(const std::string &source) {
+        static const struct {
+            const char *attributeName;
+            int location;
+        } attribute_locations [] =
+        {
+            { Unity3DGLShaderSet::ATTRIBUTE_NAME_POSITION, SEM_POSITION },
+            { Unity3DGLShaderSet::ATTRIBUTE_NAME_COLOR, SEM_COLOR0 },
+            { Unity3DGLShaderSet::ATTRIBUTE_NAME_TEX_COORD, SEM_TEXCOORD0 },
+            { Unity3DGLShaderSet::ATTRIBUTE_NAME_TEX_COORD1, SEM_TEXCOORD1 },
+            { Unity3DGLShaderSet::ATTRIBUTE_NAME_TEX_COORD2, SEM_TEXCOORD2 },
+            { Unity3DGLShaderSet::ATTRIBUTE_NAME_TEX_COORD3, SEM_TEXCOORD3 },
+            { Unity3DGLShaderSet::ATTRIBUTE_NAME_NORMAL, SEM_NORMAL },
+        };
+
+        std::vector<std::string> tokens;
+        TokenizeGLSL(source, tokens);
+
+        int nextAttribLocation = SEM_MAX;
+        for (uint64 i = 0; i < tokens.size(); ++i) {
+            bool isAttribute = tokens[i] == "attribute";
+            if (!isAttribute && tokens[i] != "uniform") {
+                continue;
+            }
+
+            uint64 t = i + 1;
+            while (t < tokens.size() && (tokens[t] == "lowp" || tokens[t] == "mediump" || tokens[t] == "highp")) {
+                ++t;
+            }
+            if (t >= tokens.size()) {
+                break;
+            }
+            uint32 type = GLSLTypeToGL(tokens[t++]);
+
+            // "uniform vec4 a, b[2];" declares two.
+            while (t < tokens.size() && tokens[t] != ";") {
+                std::string name = tokens[t++];
+                int32 size = 1;
+                if (t + 2 < tokens.size() && tokens[t] == "[" && tokens[t + 2] == "]") {
+                    size = atoi(tokens[t + 1].c_str());
+                    t += 3;
+                }
+                if (t < tokens.size() && tokens[t] == ",") {
+                    ++t;
+                }
+
+                if (isAttribute) {
+                    if (vertexAttribs_.count(name)) {
+                        continue;
+                    }
+                    U3DVertexAttrib attribute;
+                    attribute.name = name;
+                    attribute.size = size;
+                    attribute.type = type;
+                    attribute.semantic = (uint8) nextAttribLocation;
+                    for (const auto &predefined : attribute_locations) {
+                        if (name == predefined.attributeName) {
+                            attribute.semantic = (uint8) predefined.location;
+                        }
+                    }
+                    if (attribute.semantic == nextAttribLocation) {
+                        ++nextAttribLocation;
+                    }
+                    vertexAttribs_[name] = attribute;
+                }
+                else if (name[0] != '_' && !uniformLocations_.count(name)) {
+                    U3DUniform uniform;
+                    uniform.name = name;
+                    uniform.size = size;
+                    uniform.type = type;
+                    uniform.location = (int32) uniformLocations_.size();
+                    uniformLocations_[name] = uniform.location;
+                    userUniforms_[name] = uniform;
+                }
+            }
+            i = t;
+        }
+    }
+
+    void Unity3DRecordShaderSet::apply() {
+        Unity3DGLState::OpenGLState().useProgram.set(program_);
+    }
+
+    void Unity3DRecordShaderSet::unApply() {
+        Unity3DGLState::OpenGLState().useProgram.set(0);
+    }
+
+    int32 Unity3DRecordShaderSet::getAttribLocation(const std::string &attributeName) const {
+        auto iter = vertexAttribs_.find(attributeName);
+        return iter != vertexAttribs_.end() ? iter->second.semantic : -1;
+    }
+
+    int32 Unity3DRecordShaderSet::getUniformLocation(const std::string &attributeName) const {
+        auto iter = uniformLocations_.find(attributeName);
+        return iter != uniformLocations_.end() ? iter->second : -1;
+    }
+
+    void Unity3DRecordShaderSet::bindAttribLocation(const std::string &attributeName, uint32 index) const {
+        auto iter = vertexAttribs_.find(attributeName);
+        if (iter != vertexAttribs_.end()) {
+            const_cast<U3DVertexAttrib&>(iter->second).semantic = (uint8) index;
+        }
+    }
+
+    void Unity3DRecordShaderSet::updateUniform(int location, const void *data, uint64 bytes) {
+        if (location < 0) {
+            return;
+        }
+
+        std::string &value = uniformValues_[location];
+        if (value.size() != bytes || memcmp(value.data(), data, bytes) != 0) {
+            value.assign((const char *) data, bytes);
+            Unity3DRecorder::getInstance().record(U3DRecordEvent::UNIFORM, program_, location);
+        }
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWith1i(int location, int i1) {
+        updateUniform(location, &i1, sizeof(i1));
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWith2i(int location, int i1, int i2) {
+        int ints[2] = { i1, i2 };
+        updateUniform(location, ints, sizeof(ints));
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWith3i(int location, int i1, int i2, int i3) {
+        int ints[3] = { i1, i2, i3 };
+        updateUniform(location, ints, sizeof(ints));
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWith4i(int location, int i1, int i2, int i3, int i4) {
+        int ints[4] = { i1, i2, i3, i4 };
+        updateUniform(location, ints, sizeof(ints));
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWith2iv(int location, int* ints, unsigned int numberOfArrays) {
+        updateUniform(location, ints, sizeof(int) * 2 * numberOfArrays);
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWith3iv(int location, int* ints, unsigned int numberOfArrays) {
+        updateUniform(location, ints, sizeof(int) * 3 * numberOfArrays);
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWith4iv(int location, int* ints, unsigned int numberOfArrays) {
+        updateUniform(location, ints, sizeof(int) * 4 * numberOfArrays);
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWith1f(int location, float f1) {
+        updateUniform(location, &f1, sizeof(f1));
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWith2f(int location, float f1, float f2) {
+        float floats[2] = { f1, f2 };
+        updateUniform(location, floats, sizeof(floats));
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWith3f(int location, float f1, float f2, float f3) {
+        float floats[3] = { f1, f2, f3 };
+        updateUniform(location, floats, sizeof(floats));
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWith4f(int location, float f1, float f2, float f3, float f4) {
+        float floats[4] = { f1, f2, f3, f4 };
+        updateUniform(location, floats, sizeof(floats));
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWith1fv(int location, const float* floats, unsigned int numberOfArrays) {
+        updateUniform(location, floats, sizeof(float) * numberOfArrays);
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWith2fv(int location, const float* floats, unsigned int numberOfArrays) {
+        updateUniform(location, floats, sizeof(float) * 2 * numberOfArrays);
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWith3fv(int location, const float* floats, unsigned int numberOfArrays) {
+        updateUniform(location, floats, sizeof(float) * 3 * numberOfArrays);
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWith4fv(int location, const float* floats, unsigned int numberOfArrays) {
+        updateUniform(location, floats, sizeof(float) * 4 * numberOfArrays);
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWithMatrix2fv(int location, const float* matrixArray, unsigned int numberOfMatrices) {
+        updateUniform(location, matrixArray, sizeof(float) * 4 * numberOfMatrices);
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWithMatrix3fv(int location, const float* matrixArray, unsigned int numberOfMatrices) {
+        updateUniform(location, matrixArray, sizeof(float) * 9 * numberOfMatrices);
+    }
+
+    void Unity3DRecordShaderSet::setUniformLocationWithMatrix4fv(int location, const float* matrixArray, unsigned int numberOfMatrices) {
+        updateUniform(location, matrixArray, sizeof(float) * 16 * numberOfMatrices);
+    }
+
+    void Unity3DRecordShaderSet::setUniformsForBuiltins() {
+        setUniformsForBuiltins(Director::getInstance().getMatrix(MATRIX_STACK_TYPE::MATRIX_STACK_MODELVIEW));
+    }
+
+    void Unity3DRecordShaderSet::setUniformsForBuiltins(const MATH::Matrix4 &matrixMV) {
+        auto& matrixP = Director::getInstance().getMatrix(MATRIX_STACK_TYPE::MATRIX_STACK_PROJECTION);
+
+        if (builtInUniforms_[BUILTIN_P_MATRIX] != -1)
+            setUniformLocationWithMatrix4fv(builtInUniforms_[BUILTIN_P_MATRIX], matrixP.m, 1);
+
+        if (builtInUniforms_[BUILTIN_MV_MATRIX] != -1)
+            setUniformLocationWithMatrix4fv(builtInUniforms_[BUILTIN_MV_MATRIX], matrixMV.m, 1);
+
+        if (builtInUniforms_[BUILTIN_MVP_MATRIX] != -1) {
+            MATH::Matrix4 matrixMVP = matrixP * matrixMV;
+            setUniformLocationWithMatrix4fv(builtInUniforms_[BUILTIN_MVP_MATRIX], matrixMVP.m, 1);
+        }
+
+        if (builtInUniforms_[BUILTIN_NORMAL_MATRIX] != -1) {
+            MATH::Matrix4 mvInverse = matrixMV;
+            mvInverse.m[12] = mvInverse.m[13] = mvInverse.m[14] = 0.0f;
+            mvInverse.inverse();
+            mvInverse.transpose();
+            float normalMat[9];
+            normalMat[0] = mvInverse.m[0]; normalMat[1] = mvInverse.m[1]; normalMat[2] = mvInverse.m[2];
+            normalMat[3] = mvInverse.m[4]; normalMat[4] = mvInverse.m[5]; normalMat[5] = mvInverse.m[6];
+            normalMat[6] = mvInverse.m[8]; normalMat[7] = mvInverse.m[9]; normalMat[8] = mvInverse.m[10];
+            setUniformLocationWithMatrix3fv(builtInUniforms_[BUILTIN_NORMAL_MATRIX], normalMat, 1);
+        }
+
+        if (builtInUniforms_[BUILTIN_RANDOM01] != -1)
+            setUniformLocationWith4f(builtInUniforms_[BUILTIN_RANDOM01], UTILS::RANDOM::RANDOM_0_1(), UTILS::RANDOM::RANDOM_0_1(), UTILS::RANDOM::RANDOM_0_1(), UTILS::RANDOM::RANDOM_0_1());
+    }
+
+    Unity3DRecordTexture::Unity3DRecordTexture()
+        : hasMipmaps_(false)
+        , imageFormat_(IMAGE::ImageFormat::NONE) {
+    }
+
+    void Unity3DRecordTexture::create(U3DTextureType type, bool antialias) {
+        UNUSED(type);
+        UNUSED(antialias);
+    }
+
+    bool Unity3DRecordTexture::initWithMipmaps(U3DMipmap* mipmaps, int mipLevels, IMAGE::ImageFormat imageFormat, uint32 imageWidth, uint32 imageHeight) {
+        if (mipLevels <= 0) {
+            return false;
+        }
+
+        if (imageFormatInfoMap().find(imageFormat) == imageFormatInfoMap().end()) {
+            return false;
+        }
+
+        texture_ = Unity3DRecorder::getInstance().createObject();
+        Unity3DGLState::OpenGLState().texture2d.set(texture_);
+
+        uint64 bytes = 0;
+        for (int i = 0; i < mipLevels; ++i) {
+            bytes += mipmaps[i].length;
+        }
+        Unity3DRecorder::getInstance().record(U3DRecordEvent::TEXTURE_UPLOAD, texture_, bytes);
+
+        imageFormat_ = imageFormat;
+        width_ = imageWidth;
+        height_ = imageHeight;
+        premultipliedAlpha_ = false;
+        hasMipmaps_ = mipLevels > 1;
+
+        return true;
+    }
+
+    bool Unity3DRecordTexture::updateWithData(const void *data, int offsetX, int offsetY, int width, int height) {
+        UNUSED(data);
+        if (texture_) {
+            Unity3DGLState::OpenGLState().texture2d.set(texture_);
+            const IMAGE::ImageFormatInfo& info = imageFormatInfoMap().at(imageFormat_);
+            Unity3DRecorder::getInstance().record(U3DRecordEvent::TEXTURE_UPLOAD, texture_, (uint64) width * height * info.bpp / 8, (uint64) offsetY * width_ + offsetX);
+            return true;
+        }
+        return false;
+    }
+
+    void Unity3DRecordTexture::setAliasTexParameters() {
+        if (texture_ != 0) {
+            Unity3DGLState::OpenGLState().texture2d.set(texture_);
+        }
+    }
+
+    void Unity3DRecordTexture::autoGenMipmaps() {
+        Unity3DGLState::OpenGLState().texture2d.set(texture_);
+        hasMipmaps_ = true;
+    }
+
+    const IMAGE::ImageFormatInfoMap &Unity3DRecordTexture::imageFormatInfoMap() {
+        return Unity3DGLTexture::FormatInfoMap();
+    }
+
+    Unity3DContext *Unity3DRecordCreator::CreateContext() {
+        Unity3DRecorder::getInstance();
+        return new Unity3DRecordContext;
+    }
+
+    // Depth and uniform formats only talk to Unity3DGLState and the shader set, the GL ones
+    // are recorded through the state sink as they are.
+    Unity3DDepthState *Unity3DRecordCreator::CreateDepthState() {
+        Unity3DRecorder::getInstance();
+        return new Unity3DGLDepthState();
+    }
+
+    Unity3DBuffer *Unity3DRecordCreator::CreateBuffer(uint32 usageFlags) {
+        return new Unity3DRecordBuffer(usageFlags);
+    }
+
+    Unity3DShaderSet *Unity3DRecordCreator::CreateShaderSet(Unity3DShader *vshader, Unity3DShader *fshader) {
+        UNUSED(vshader);
+        UNUSED(fshader);
+        throw _HException_Normal("Unity3DRecordCreator: compiled shaders are not supported, create shader sets from sources");
+    }
+
+    Unity3DShaderSet *Unity3DRecordCreator::CreateShaderSetWithByteArray(const std::string &vShaderByteArray, const std::string &fShaderByteArray, const std::string& compileTimeDefines) {
+        UNUSED(compileTimeDefines);
+        if (vShaderByteArray.empty() || fShaderByteArray.empty()) {
+            throw _HException_Normal(UTILS::STRING::StringFromFormat("ShaderSet requires both a valid vertex and a fragment ByteArray: %p %p", &vShaderByteArray, &fShaderByteArray));
+        }
+
+        Unity3DRecordShaderSet *shaderSet = new Unity3DRecordShaderSet(vShaderByteArray, fShaderByteArray);
+        shaderSet->link();
+        return shaderSet;
+    }
+
+    Unity3DShaderSet *Unity3DRecordCreator::CreateShaderSetWithFileName(const std::string& vShaderFilename, const std::string& fShaderFilename, const std::string& compileTimeDefines) {
+        if (vShaderFilename.empty() || fShaderFilename.empty()) {
+            throw _HException_Normal(UTILS::STRING::StringFromFormat("ShaderSet requires both a valid vertex and a fragment ByteArray: %p %p", &vShaderFilename, &fShaderFilename));
+        }
+
+        std::string vertexSource = IO::FileUtils::getInstance().getStringFromFile(IO::FileUtils::getInstance().fullPathForFilename(vShaderFilename));
+        std::string fragmentSource = IO::FileUtils::getInstance().getStringFromFile(IO::FileUtils::getInstance().fullPathForFilename(fShaderFilename));
+
+        return CreateShaderSetWithByteArray(vertexSource, fragmentSource, compileTimeDefines);
+    }
+
+    Unity3DVertexFormat *Unity3DRecordCreator::CreateVertexFormat(const U3DVertexComponent &component) {
+        return new Unity3DRecordVertexFormat(component);
+    }
+
+    Unity3DVertexFormat *Unity3DRecordCreator::CreateVertexFormat(const std::vector<U3DVertexComponent> &components) {
+        return new Unity3DRecordVertexFormat(components);
+    }
+
+    Unity3DUniformFormat *Unity3DRecordCreator::CreateUniformFormat(Unity3DShaderSet * u3dShader, const U3DuniformComponent &component) {
+        Unity3DRecorder::getInstance();
+        return new Unity3DGLUniformFormat(u3dShader, component);
+    }
+
+    Unity3DTexture *Unity3DRecordCreator::CreateTexture(U3DTextureType type, bool antialias) {
+        Unity3DRecordTexture *texture = new Unity3DRecordTexture();
+        texture->create(type, antialias);
+        return texture;
+    }
+}
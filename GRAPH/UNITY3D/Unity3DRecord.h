@@ -0,0 +1,240 @@
+#ifndef UNITY3DRECORD_H
+#define UNITY3DRECORD_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "GRAPH/UNITY3D/Unity3D.h"
+#include "GRAPH/UNITY3D/Unity3DGLState.h"
+
+namespace GRAPH
+{
+    // One recorded backend call. Names are static strings, objects are the ids the recorder
+    // hands out in place of GL names.
+    struct U3DRecordEvent
+    {
+        enum Type : uint8
+        {
+            DRAW,
+            DRAW_INDEXED,
+            DRAW_UP,
+            DRAW_INSTANCED,
+            CLEAR,
+            STATE_CHANGE,
+            VERTEX_FORMAT,
+            UNIFORM,
+            BUFFER_UPLOAD,
+            TEXTURE_UPLOAD,
+        };
+
+        Type type;
+        uint8 primitive;
+        uint32 object;
+        // Vertices or indices for draws, instances for instanced draws, bytes for uploads, the
+        // location for uniforms.
+        uint64 count;
+        // First vertex, byte offset into the index, vertex or instance buffer.
+        uint64 offset;
+        const char *name;
+    };
+
+    struct U3DRecordCounters
+    {
+        U3DRecordCounters() { memset(this, 0, sizeof(*this)); }
+
+        uint64 drawCalls;
+        uint64 verticesDrawn;
+        uint64 indicesDrawn;
+        uint64 instancesDrawn;
+        uint64 clears;
+        uint64 stateChanges;
+        uint64 vertexFormatApplies;
+        uint64 uniformUpdates;
+        uint64 bufferUploads;
+        uint64 bufferBytes;
+        uint64 textureUploads;
+        uint64 textureBytes;
+    };
+
+    // Collects everything the RECORDING engine mode would have sent to the GPU. Counters are
+    // always kept, the event log can be turned off for long runs. Installs itself as the
+    // Unity3DGLState sink on first use, so cached state changes are recorded instead of issued.
+    class Unity3DRecorder final : public Unity3DGLState::StateSink
+    {
+    public:
+        static Unity3DRecorder &getInstance();
+
+        void stateChanged(const char *function) override;
+
+        void record(U3DRecordEvent::Type type, uint32 object, uint64 count, uint64 offset = 0, uint8 primitive = 0, const char *name = nullptr);
+        uint32 createObject() { return ++lastObject_; }
+
+        // Drops the log and zeroes the counters, call once per frame to get per frame numbers.
+        void reset();
+
+        inline const U3DRecordCounters &getCounters() const { return counters_; }
+        inline const std::vector<U3DRecordEvent> &getEvents() const { return events_; }
+
+        inline void setLogEnabled(bool enabled) { logEnabled_ = enabled; }
+        inline bool isLogEnabled() const { return logEnabled_; }
+
+    private:
+        Unity3DRecorder();
+
+        U3DRecordCounters counters_;
+        std::vector<U3DRecordEvent> events_;
+        uint32 lastObject_;
+        bool logEnabled_;
+
+        DISALLOW_COPY_AND_ASSIGN(Unity3DRecorder)
+    };
+
+    class Unity3DRecordBuffer final : public Unity3DBuffer
+    {
+    public:
+        Unity3DRecordBuffer(uint32 flags);
+
+        void setData(const uint8 *data, uint64 size) override;
+        void subData(const uint8 *data, uint64 offset, uint64 size) override;
+        void bind() override;
+        uint64 stream(const uint8 *data, uint64 size) override;
+
+        inline uint64 getKnownSize() const { return knownSize_; }
+        // Times stream() had to start over, each an orphan on the GL backend.
+        inline uint64 getStreamWraps() const { return streamWraps_; }
+
+    private:
+        uint32 buffer_;
+        bool indexData_;
+        uint64 knownSize_;
+        uint64 streamHead_;
+        uint64 streamWraps_;
+    };
+
+    class Unity3DRecordVertexFormat final : public Unity3DVertexFormat
+    {
+    public:
+        Unity3DRecordVertexFormat(const U3DVertexComponent &component);
+        Unity3DRecordVertexFormat(const std::vector<U3DVertexComponent> &components);
+        void apply(const void *base = nullptr) override;
+        void unApply() override;
+    };
+
+    class Unity3DRecordContext final : public Unity3DContext
+    {
+    public:
+        void draw(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, int vertexCount, int offset) override;
+        void drawIndexed(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, Unity3DBuffer *idata, void *indices, int offset) override;
+        void drawIndexedBaseVertex(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, Unity3DBuffer *idata, void *indices, int count, int baseVertex) override;
+        void multiDrawIndexedBaseVertex(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, Unity3DBuffer *idata, const int *counts, void *const *indices, const int *baseVertices, int drawCount) override;
+        bool supportsBaseVertex() const override { return true; }
+        void drawInstanced(U3DPrimitive prim, Unity3DVertexFormat *format, Unity3DBuffer *vdata, int vertexCount, Unity3DVertexFormat *instanceFormat, Unity3DBuffer *instanceData, uint64 instanceOffset, int instanceCount) override;
+        bool supportsInstancing() const override { return true; }
+        void drawUp(U3DPrimitive prim, Unity3DVertexFormat *format, const void *vdata, int vertexCount) override;
+        void clear(int mask, uint32 colorval, float depthVal, int stencilVal) override;
+    };
+
+    // Nothing is compiled. Attributes and uniforms are taken from the declarations in the
+    // sources, a builtin uniform counts as used when its name appears in them. Uniform types
+    // are reported as GL enums, like the GL shader set does.
+    class Unity3DRecordShaderSet final : public Unity3DShaderSet
+    {
+    public:
+        Unity3DRecordShaderSet(const std::string &vShaderSource, const std::string &fShaderSource);
+
+        int name() override;
+        void link() override;
+        void apply() override;
+        void unApply() override;
+
+        int32 getAttribLocation(const std::string &attributeName) const override;
+        int32 getUniformLocation(const std::string &attributeName) const override;
+        void bindAttribLocation(const std::string &attributeName, uint32 index) const override;
+
+        void setUniformLocationWith1i(int location, int i1) override;
+        void setUniformLocationWith2i(int location, int i1, int i2) override;
+        void setUniformLocationWith3i(int location, int i1, int i2, int i3) override;
+        void setUniformLocationWith4i(int location, int i1, int i2, int i3, int i4) override;
+        void setUniformLocationWith2iv(int location, int* ints, unsigned int numberOfArrays) override;
+        void setUniformLocationWith3iv(int location, int* ints, unsigned int numberOfArrays) override;
+        void setUniformLocationWith4iv(int location, int* ints, unsigned int numberOfArrays) override;
+        void setUniformLocationWith1f(int location, float f1) override;
+        void setUniformLocationWith2f(int location, float f1, float f2) override;
+        void setUniformLocationWith3f(int location, float f1, float f2, float f3) override;
+        void setUniformLocationWith4f(int location, float f1, float f2, float f3, float f4) override;
+        void setUniformLocationWith1fv(int location, const float* floats, unsigned int numberOfArrays) override;
+        void setUniformLocationWith2fv(int location, const float* floats, unsigned int numberOfArrays) override;
+        void setUniformLocationWith3fv(int location, const float* floats, unsigned int numberOfArrays) override;
+        void setUniformLocationWith4fv(int location, const float* floats, unsigned int numberOfArrays) override;
+        void setUniformLocationWithMatrix2fv(int location, const float* matrixArray, unsigned int numberOfMatrices) override;
+        void setUniformLocationWithMatrix3fv(int location, const float* matrixArray, unsigned int numberOfMatrices) override;
+        void setUniformLocationWithMatrix4fv(int location, const float* matrixArray, unsigned int numberOfMatrices) override;
+
+        void setUniformsForBuiltins() override;
+        void setUniformsForBuiltins(const MATH::Matrix4 &modelView) override;
+
+    private:
+        enum
+        {
+            BUILTIN_P_MATRIX,
+            BUILTIN_MV_MATRIX,
+            BUILTIN_MVP_MATRIX,
+            BUILTIN_NORMAL_MATRIX,
+            BUILTIN_RANDOM01,
+            BUILTIN_SAMPLER0,
+            BUILTIN_SAMPLER1,
+            BUILTIN_SAMPLER2,
+            BUILTIN_SAMPLER3,
+            BUILTIN_MAX,
+        };
+
+        void parseDeclarations(const std::string &source);
+        // Same filtering as the GL shader set: unchanged values are not sent again.
+        void updateUniform(int location, const void *data, uint64 bytes);
+
+        uint32 program_;
+        std::string sources_;
+        std::unordered_map<std::string, int32> uniformLocations_;
+        std::unordered_map<int32, std::string> uniformValues_;
+        int32 builtInUniforms_[BUILTIN_MAX];
+    };
+
+    class Unity3DRecordTexture final : public Unity3DTexture
+    {
+    public:
+        Unity3DRecordTexture();
+
+        void create(U3DTextureType type, bool antialias = true) override;
+
+        bool initWithMipmaps(U3DMipmap* mipmaps, int mipLevels, IMAGE::ImageFormat imageFormat, uint32 imageWidth, uint32 imageHeight) override;
+        bool updateWithData(const void *data, int offsetX, int offsetY, int width, int height) override;
+
+        void setAliasTexParameters() override;
+        void autoGenMipmaps() override;
+
+        bool hasMipmaps() const override { return hasMipmaps_; }
+
+        const IMAGE::ImageFormatInfoMap &imageFormatInfoMap() override;
+
+    private:
+        bool hasMipmaps_;
+        IMAGE::ImageFormat imageFormat_;
+    };
+
+    class Unity3DRecordCreator
+    {
+    public:
+        static Unity3DContext *CreateContext();
+        static Unity3DDepthState *CreateDepthState();
+        static Unity3DBuffer *CreateBuffer(uint32 usageFlags);
+        static Unity3DShaderSet *CreateShaderSet(Unity3DShader *vshader, Unity3DShader *fshader);
+        static Unity3DShaderSet *CreateShaderSetWithByteArray(const std::string &vShaderByteArray, const std::string &fShaderByteArray, const std::string& compileTimeDefines = std::string());
+        static Unity3DShaderSet *CreateShaderSetWithFileName(const std::string& vShaderFilename, const std::string& fShaderFilename, const std::string& compileTimeDefines = std::string());
+        static Unity3DVertexFormat *CreateVertexFormat(const U3DVertexComponent &component);
+        static Unity3DVertexFormat *CreateVertexFormat(const std::vector<U3DVertexComponent> &components);
+        static Unity3DUniformFormat *CreateUniformFormat(Unity3DShaderSet * u3dShader, const U3DuniformComponent &component);
+        static Unity3DTexture *CreateTexture(U3DTextureType type = LINEAR2D, bool antialias = true);
+    };
+}
+
+#endif // UNITY3DRECORD_H
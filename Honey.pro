@@ -23,6 +23,7 @@ SOURCES += \
     $$P/IO/*.cpp \
     $$P/UTILS/HASH/*.cpp \
     $$P/UTILS/STRING/*.cpp \
+    $$P/UTILS/RANDOM/*.cpp \
     $$P/UTILS/TIME/*.cpp
 
 HEADERS += \
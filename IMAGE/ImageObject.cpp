@@ -17,7 +17,8 @@ namespace IMAGE
         , fileType_(ImageType::UNKNOWN)
         , renderFormat_(ImageFormat::NONE)
         , hasPremultipliedAlpha_(true) {
-
+        // Created on the TextureCache loading thread and handed to the main thread.
+        setAtomicReferenceCount(true);
     }
 
     ImageObject::~ImageObject() {
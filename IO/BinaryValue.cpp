@@ -0,0 +1,604 @@
+#include "BinaryValue.h"
+
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+using UTILS::STRING::StringView;
+
+namespace IO
+{
+    namespace
+    {
+        const HBYTE MAGIC[3] = { 'H', 'B', 'V' };
+        const HBYTE VERSION = 1;
+        const uint64 HEADER_SIZE = 12;
+        // Deeper trees are rejected instead of risking the stack.
+        const uint32 MAX_DEPTH = 256;
+
+        inline uint32 ReadU32(const HBYTE *p) {
+            return (uint32)p[0] | ((uint32)p[1] << 8) | ((uint32)p[2] << 16) | ((uint32)p[3] << 24);
+        }
+
+        inline uint64 ReadU64(const HBYTE *p) {
+            return (uint64)ReadU32(p) | ((uint64)ReadU32(p + 4) << 32);
+        }
+
+        inline int32 ReadI32(const HBYTE *p) {
+            return (int32)ReadU32(p);
+        }
+
+        inline float ReadFloat(const HBYTE *p) {
+            uint32 bits = ReadU32(p);
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        inline double ReadDouble(const HBYTE *p) {
+            uint64 bits = ReadU64(p);
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        inline void WriteU32(HBYTE *p, uint32 value) {
+            p[0] = (HBYTE)value;
+            p[1] = (HBYTE)(value >> 8);
+            p[2] = (HBYTE)(value >> 16);
+            p[3] = (HBYTE)(value >> 24);
+        }
+
+        inline bool IsContainer(HValue::Type type) {
+            return type == HValue::Type::VECTOR || type == HValue::Type::MAP || type == HValue::Type::INT_KEY_MAP;
+        }
+
+        // Bytes taken by a value that has already been validated, type byte included.
+        uint64 EncodedSize(const HBYTE *value) {
+            switch ((HValue::Type)value[0]) {
+            case HValue::Type::BYTE:
+            case HValue::Type::BOOLEAN:
+                return 2;
+            case HValue::Type::INTEGER:
+            case HValue::Type::FLOAT:
+                return 5;
+            case HValue::Type::DOUBLE:
+                return 9;
+            case HValue::Type::STRING:
+                return 5 + (uint64)ReadU32(value + 1);
+            case HValue::Type::VECTOR:
+            case HValue::Type::MAP:
+            case HValue::Type::INT_KEY_MAP:
+                return 9 + (uint64)ReadU32(value + 5);
+            default:
+                return 1;
+            }
+        }
+
+        class Encoder
+        {
+        public:
+            Encoder() {
+                body_.reserve(4096);
+            }
+
+            HData finish() {
+                uint64 stringBytesSize = 0;
+                for (const auto &key : keys_) {
+                    stringBytesSize += key->size();
+                }
+                if (keys_.size() > 0xFFFFFFFFu || stringBytesSize > 0xFFFFFFFFu || body_.size() > 0xFFFFFFFFu) {
+                    throw _HException_Normal("BinaryValueWriter: value tree too large");
+                }
+
+                uint64 size = HEADER_SIZE + keys_.size() * 4 + stringBytesSize + body_.size();
+                HBYTE *buffer = (HBYTE *)malloc(size);
+                HBYTE *p = buffer;
+                memcpy(p, MAGIC, sizeof(MAGIC));
+                p[3] = VERSION;
+                WriteU32(p + 4, (uint32)keys_.size());
+                WriteU32(p + 8, (uint32)stringBytesSize);
+                p += HEADER_SIZE;
+
+                uint32 offset = 0;
+                for (const auto &key : keys_) {
+                    WriteU32(p, offset);
+                    p += 4;
+                    offset += (uint32)key->size();
+                }
+                for (const auto &key : keys_) {
+                    memcpy(p, key->data(), key->size());
+                    p += key->size();
+                }
+                if (!body_.empty()) {
+                    memcpy(p, &body_[0], body_.size());
+                }
+
+                HData ret;
+                ret.fastSet(buffer, size);
+                return ret;
+            }
+
+            void writeValue(const HValue &value) {
+                switch (value.getType()) {
+                case HValue::Type::BYTE:
+                    putByte((HBYTE)HValue::Type::BYTE);
+                    putByte(value.asByte());
+                    break;
+                case HValue::Type::INTEGER:
+                    putByte((HBYTE)HValue::Type::INTEGER);
+                    putU32((uint32)value.asInt());
+                    break;
+                case HValue::Type::FLOAT: {
+                    float floatValue = value.asFloat();
+                    uint32 bits;
+                    memcpy(&bits, &floatValue, sizeof(bits));
+                    putByte((HBYTE)HValue::Type::FLOAT);
+                    putU32(bits);
+                    break;
+                }
+                case HValue::Type::DOUBLE: {
+                    double doubleValue = value.asDouble();
+                    uint64 bits;
+                    memcpy(&bits, &doubleValue, sizeof(bits));
+                    putByte((HBYTE)HValue::Type::DOUBLE);
+                    putU32((uint32)bits);
+                    putU32((uint32)(bits >> 32));
+                    break;
+                }
+                case HValue::Type::BOOLEAN:
+                    putByte((HBYTE)HValue::Type::BOOLEAN);
+                    putByte(value.asBool() ? 1 : 0);
+                    break;
+                case HValue::Type::STRING: {
+                    const std::string string = value.asString();
+                    putByte((HBYTE)HValue::Type::STRING);
+                    putU32((uint32)string.size());
+                    putBytes(string.data(), string.size());
+                    break;
+                }
+                case HValue::Type::VECTOR: {
+                    const ValueVector &vector = value.asValueVector();
+                    uint64 payloadStart = beginContainer(HValue::Type::VECTOR, vector.size());
+                    for (const auto &child : vector) {
+                        writeValue(child);
+                    }
+                    endContainer(payloadStart);
+                    break;
+                }
+                case HValue::Type::MAP:
+                    writeMap(value.asValueMap());
+                    break;
+                case HValue::Type::INT_KEY_MAP: {
+                    // Sorted so the same map always encodes to the same bytes.
+                    const ValueMapIntKey &map = value.asIntKeyMap();
+                    std::vector<const ValueMapIntKey::value_type *> entries;
+                    entries.reserve(map.size());
+                    for (const auto &entry : map) {
+                        entries.push_back(&entry);
+                    }
+                    std::sort(entries.begin(), entries.end(), [](const ValueMapIntKey::value_type *a, const ValueMapIntKey::value_type *b) {
+                        return a->first < b->first;
+                    });
+
+                    uint64 payloadStart = beginContainer(HValue::Type::INT_KEY_MAP, entries.size());
+                    for (const auto &entry : entries) {
+                        putU32((uint32)entry->first);
+                        writeValue(entry->second);
+                    }
+                    endContainer(payloadStart);
+                    break;
+                }
+                default:
+                    putByte((HBYTE)HValue::Type::NONE);
+                    break;
+                }
+            }
+
+            void writeMap(const ValueMap &map) {
+                std::vector<const ValueMap::value_type *> entries;
+                entries.reserve(map.size());
+                for (const auto &entry : map) {
+                    entries.push_back(&entry);
+                }
+                std::sort(entries.begin(), entries.end(), [](const ValueMap::value_type *a, const ValueMap::value_type *b) {
+                    return a->first < b->first;
+                });
+
+                uint64 payloadStart = beginContainer(HValue::Type::MAP, entries.size());
+                for (const auto &entry : entries) {
+                    putU32(internKey(entry->first));
+                    writeValue(entry->second);
+                }
+                endContainer(payloadStart);
+            }
+
+        private:
+            void putByte(HBYTE value) {
+                body_.push_back(value);
+            }
+
+            void putU32(uint32 value) {
+                uint64 at = body_.size();
+                body_.resize(at + 4);
+                WriteU32(&body_[at], value);
+            }
+
+            void putBytes(const void *data, uint64 size) {
+                const HBYTE *bytes = (const HBYTE *)data;
+                body_.insert(body_.end(), bytes, bytes + size);
+            }
+
+            uint32 internKey(const std::string &key) {
+                auto iter = keyIndices_.find(key);
+                if (iter != keyIndices_.end()) {
+                    return iter->second;
+                }
+
+                uint32 index = (uint32)keys_.size();
+                iter = keyIndices_.insert(std::make_pair(key, index)).first;
+                keys_.push_back(&iter->first);
+                return index;
+            }
+
+            // Count and payload size, the size is patched once the children are written.
+            uint64 beginContainer(HValue::Type type, uint64 count) {
+                putByte((HBYTE)type);
+                putU32((uint32)count);
+                putU32(0);
+                return body_.size();
+            }
+
+            void endContainer(uint64 payloadStart) {
+                uint64 payloadSize = body_.size() - payloadStart;
+                if (payloadSize > 0xFFFFFFFFu) {
+                    throw _HException_Normal("BinaryValueWriter: container too large");
+                }
+                WriteU32(&body_[payloadStart - 4], (uint32)payloadSize);
+            }
+
+            std::vector<HBYTE> body_;
+            std::unordered_map<std::string, uint32> keyIndices_;
+            std::vector<const std::string *> keys_;
+        };
+    }
+
+    HData BinaryValueWriter::write(const HValue &root) {
+        Encoder encoder;
+        encoder.writeValue(root);
+        return encoder.finish();
+    }
+
+    HData BinaryValueWriter::write(const ValueMap &root) {
+        Encoder encoder;
+        encoder.writeMap(root);
+        return encoder.finish();
+    }
+
+    const char *BinaryValueReader::FILE_EXTENSION = ".hbv";
+
+    bool BinaryValueReader::isBinaryValue(const HBYTE *data, uint64 size) {
+        return data && size >= HEADER_SIZE && memcmp(data, MAGIC, sizeof(MAGIC)) == 0 && data[3] == VERSION;
+    }
+
+    BinaryValueReader::Element::Element()
+        : reader_(nullptr)
+        , value_(nullptr)
+        , key_(nullptr)
+        , end_(nullptr) {
+    }
+
+    BinaryValueReader::Element::Element(const BinaryValueReader *reader, const HBYTE *value, const HBYTE *key, const HBYTE *end)
+        : reader_(reader)
+        , value_(value)
+        , key_(key)
+        , end_(end) {
+    }
+
+    HValue::Type BinaryValueReader::Element::getType() const {
+        return value_ ? (HValue::Type)value_[0] : HValue::Type::NONE;
+    }
+
+    unsigned char BinaryValueReader::Element::asByte() const {
+        return (unsigned char)asInt();
+    }
+
+    int BinaryValueReader::Element::asInt() const {
+        switch (getType()) {
+        case HValue::Type::BYTE:
+        case HValue::Type::BOOLEAN:
+            return value_[1];
+        case HValue::Type::INTEGER:
+            return ReadI32(value_ + 1);
+        case HValue::Type::FLOAT:
+            return (int)ReadFloat(value_ + 1);
+        case HValue::Type::DOUBLE:
+            return (int)ReadDouble(value_ + 1);
+        default:
+            return 0;
+        }
+    }
+
+    float BinaryValueReader::Element::asFloat() const {
+        return getType() == HValue::Type::FLOAT ? ReadFloat(value_ + 1) : (float)asDouble();
+    }
+
+    double BinaryValueReader::Element::asDouble() const {
+        switch (getType()) {
+        case HValue::Type::FLOAT:
+            return ReadFloat(value_ + 1);
+        case HValue::Type::DOUBLE:
+            return ReadDouble(value_ + 1);
+        default:
+            return asInt();
+        }
+    }
+
+    bool BinaryValueReader::Element::asBool() const {
+        return getType() == HValue::Type::DOUBLE ? asDouble() != 0.0 : asInt() != 0;
+    }
+
+    StringView BinaryValueReader::Element::asString() const {
+        if (getType() != HValue::Type::STRING) {
+            return StringView();
+        }
+        return StringView((const char *)value_ + 5, ReadU32(value_ + 1));
+    }
+
+    uint32 BinaryValueReader::Element::size() const {
+        return IsContainer(getType()) ? ReadU32(value_ + 1) : 0;
+    }
+
+    BinaryValueReader::Element BinaryValueReader::Element::firstChild() const {
+        if (size() == 0) {
+            return Element();
+        }
+
+        const HBYTE *payload = value_ + 9;
+        const HBYTE *end = payload + ReadU32(value_ + 5);
+        if (getType() == HValue::Type::VECTOR) {
+            return Element(reader_, payload, nullptr, end);
+        }
+        return Element(reader_, payload + 4, payload, end);
+    }
+
+    BinaryValueReader::Element BinaryValueReader::Element::nextSibling() const {
+        if (!value_) {
+            return Element();
+        }
+
+        const HBYTE *next = value_ + EncodedSize(value_);
+        if (next >= end_) {
+            return Element();
+        }
+        if (key_) {
+            return Element(reader_, next + 4, next, end_);
+        }
+        return Element(reader_, next, nullptr, end_);
+    }
+
+    BinaryValueReader::Element BinaryValueReader::Element::at(uint32 index) const {
+        if (getType() != HValue::Type::VECTOR || index >= size()) {
+            return Element();
+        }
+
+        Element child = firstChild();
+        while (index-- > 0) {
+            child = child.nextSibling();
+        }
+        return child;
+    }
+
+    BinaryValueReader::Element BinaryValueReader::Element::get(const StringView &key) const {
+        if (getType() != HValue::Type::MAP) {
+            return Element();
+        }
+
+        for (Element child = firstChild(); child.isValid(); child = child.nextSibling()) {
+            if (child.key() == key) {
+                return child;
+            }
+        }
+        return Element();
+    }
+
+    BinaryValueReader::Element BinaryValueReader::Element::get(int key) const {
+        if (getType() != HValue::Type::INT_KEY_MAP) {
+            return Element();
+        }
+
+        for (Element child = firstChild(); child.isValid(); child = child.nextSibling()) {
+            if (child.intKey() == key) {
+                return child;
+            }
+        }
+        return Element();
+    }
+
+    StringView BinaryValueReader::Element::key() const {
+        return key_ ? reader_->getString(ReadU32(key_)) : StringView();
+    }
+
+    int BinaryValueReader::Element::intKey() const {
+        return key_ ? ReadI32(key_) : 0;
+    }
+
+    HValue BinaryValueReader::Element::toValue() const {
+        switch (getType()) {
+        case HValue::Type::BYTE:
+            return HValue(value_[1]);
+        case HValue::Type::INTEGER:
+            return HValue((int)ReadI32(value_ + 1));
+        case HValue::Type::FLOAT:
+            return HValue(ReadFloat(value_ + 1));
+        case HValue::Type::DOUBLE:
+            return HValue(ReadDouble(value_ + 1));
+        case HValue::Type::BOOLEAN:
+            return HValue(value_[1] != 0);
+        case HValue::Type::STRING: {
+            UTILS::STRING::StringView string = asString();
+            return HValue(string.data(), string.size());
+        }
+        case HValue::Type::VECTOR: {
+            ValueVector vector;
+            vector.reserve(size());
+            for (Element child = firstChild(); child.isValid(); child = child.nextSibling()) {
+                vector.push_back(child.toValue());
+            }
+            return HValue(std::move(vector));
+        }
+        case HValue::Type::MAP: {
+            ValueMap map;
+            map.reserve(size());
+            for (Element child = firstChild(); child.isValid(); child = child.nextSibling()) {
+                map.emplace(child.key().toString(), child.toValue());
+            }
+            return HValue(std::move(map));
+        }
+        case HValue::Type::INT_KEY_MAP: {
+            ValueMapIntKey map;
+            map.reserve(size());
+            for (Element child = firstChild(); child.isValid(); child = child.nextSibling()) {
+                map.emplace(child.intKey(), child.toValue());
+            }
+            return HValue(std::move(map));
+        }
+        default:
+            return HValue();
+        }
+    }
+
+    BinaryValueReader::BinaryValueReader()
+        : root_(nullptr)
+        , end_(nullptr)
+        , stringOffsets_(nullptr)
+        , stringBytes_(nullptr)
+        , stringCount_(0)
+        , stringBytesSize_(0) {
+    }
+
+    bool BinaryValueReader::open(const HData &data) {
+        if (!open(data.getBytes(), data.getSize())) {
+            return false;
+        }
+        data_ = data;
+        return true;
+    }
+
+    bool BinaryValueReader::open(const HBYTE *data, uint64 size) {
+        data_.clear();
+        root_ = nullptr;
+        end_ = nullptr;
+
+        if (!isBinaryValue(data, size)) {
+            return false;
+        }
+
+        uint64 stringCount = ReadU32(data + 4);
+        uint64 stringBytesSize = ReadU32(data + 8);
+        uint64 rootOffset = HEADER_SIZE + stringCount * 4 + stringBytesSize;
+        if (rootOffset >= size) {
+            return false;
+        }
+
+        stringOffsets_ = data + HEADER_SIZE;
+        stringBytes_ = stringOffsets_ + stringCount * 4;
+        stringCount_ = (uint32)stringCount;
+        stringBytesSize_ = (uint32)stringBytesSize;
+
+        uint32 previous = 0;
+        for (uint32 index = 0; index < stringCount_; ++index) {
+            uint32 offset = ReadU32(stringOffsets_ + index * 4);
+            if (offset < previous || offset > stringBytesSize_) {
+                return false;
+            }
+            previous = offset;
+        }
+
+        const HBYTE *cursor = data + rootOffset;
+        const HBYTE *end = data + size;
+        if (!validate(cursor, end, 0) || cursor != end) {
+            return false;
+        }
+
+        root_ = data + rootOffset;
+        end_ = end;
+        return true;
+    }
+
+    BinaryValueReader::Element BinaryValueReader::root() const {
+        return root_ ? Element(this, root_, nullptr, end_) : Element();
+    }
+
+    StringView BinaryValueReader::getString(uint32 index) const {
+        uint32 offset = ReadU32(stringOffsets_ + index * 4);
+        uint32 end = index + 1 < stringCount_ ? ReadU32(stringOffsets_ + (index + 1) * 4) : stringBytesSize_;
+        return StringView((const char *)stringBytes_ + offset, end - offset);
+    }
+
+    bool BinaryValueReader::validate(const HBYTE *&cursor, const HBYTE *end, uint32 depth) const {
+        if (cursor >= end || depth > MAX_DEPTH) {
+            return false;
+        }
+
+        uint64 available = end - cursor;
+        HValue::Type type = (HValue::Type)cursor[0];
+        switch (type) {
+        case HValue::Type::NONE:
+            cursor += 1;
+            return true;
+        case HValue::Type::BYTE:
+        case HValue::Type::BOOLEAN:
+        case HValue::Type::INTEGER:
+        case HValue::Type::FLOAT:
+        case HValue::Type::DOUBLE: {
+            uint64 size = EncodedSize(cursor);
+            if (size > available) {
+                return false;
+            }
+            cursor += size;
+            return true;
+        }
+        case HValue::Type::STRING:
+            if (available < 5 || EncodedSize(cursor) > available) {
+                return false;
+            }
+            cursor += EncodedSize(cursor);
+            return true;
+        case HValue::Type::VECTOR:
+        case HValue::Type::MAP:
+        case HValue::Type::INT_KEY_MAP: {
+            if (available < 9 || EncodedSize(cursor) > available) {
+                return false;
+            }
+
+            uint32 count = ReadU32(cursor + 1);
+            const HBYTE *payloadEnd = cursor + EncodedSize(cursor);
+            const HBYTE *child = cursor + 9;
+            for (uint32 index = 0; index < count; ++index) {
+                if (type != HValue::Type::VECTOR) {
+                    if (payloadEnd - child < 4) {
+                        return false;
+                    }
+                    if (type == HValue::Type::MAP && ReadU32(child) >= stringCount_) {
+                        return false;
+                    }
+                    child += 4;
+                }
+                if (!validate(child, payloadEnd, depth + 1)) {
+                    return false;
+                }
+            }
+            if (child != payloadEnd) {
+                return false;
+            }
+
+            cursor = payloadEnd;
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef BINARYVALUE_H
+#define BINARYVALUE_H
+
+#include <string>
+
+#include "BASE/Honey.h"
+#include "BASE/HData.h"
+#include "BASE/HValue.h"
+#include "UTILS/STRING/StringView.h"
+
+namespace IO
+{
+    // Compact little-endian encoding of an HValue tree.
+    //
+    //   "HBV" version                  4 bytes
+    //   string count, string bytes     uint32, uint32
+    //   string offsets                 uint32 per string, into the string bytes
+    //   string bytes                   map keys, each stored once
+    //   root value
+    //
+    // A value is a type byte (HValue::Type) followed by its payload: byte, int32, float,
+    // double or bool scalars, strings as uint32 length + bytes, containers as uint32 count +
+    // uint32 payload size + children. Map children are preceded by a key string index,
+    // int key map children by an int32 key.
+    class BinaryValueWriter final
+    {
+    public:
+        static HData write(const HValue &root);
+        static HData write(const ValueMap &root);
+    };
+
+    // Reads the encoding in place. open() checks the whole buffer once, afterwards every
+    // accessor is a bounds-check free walk over the bytes and strings are views into them.
+    class BinaryValueReader final
+    {
+    public:
+        static const char *FILE_EXTENSION;
+
+        static bool isBinaryValue(const HBYTE *data, uint64 size);
+
+        class Element final
+        {
+        public:
+            Element();
+
+            inline bool isValid() const { return value_ != nullptr; }
+            HValue::Type getType() const;
+
+            unsigned char asByte() const;
+            int asInt() const;
+            float asFloat() const;
+            double asDouble() const;
+            bool asBool() const;
+            UTILS::STRING::StringView asString() const;
+
+            // Children of vectors and maps.
+            uint32 size() const;
+            Element firstChild() const;
+            Element nextSibling() const;
+            Element at(uint32 index) const;
+            Element get(const UTILS::STRING::StringView &key) const;
+            Element get(int key) const;
+
+            // Key of a child of a map or int key map.
+            UTILS::STRING::StringView key() const;
+            int intKey() const;
+
+            HValue toValue() const;
+
+        private:
+            friend class BinaryValueReader;
+
+            Element(const BinaryValueReader *reader, const HBYTE *value, const HBYTE *key, const HBYTE *end);
+
+            const BinaryValueReader *reader_;
+            const HBYTE *value_;
+            const HBYTE *key_;
+            const HBYTE *end_;
+        };
+
+        BinaryValueReader();
+
+        // The reader keeps a reference to data.
+        bool open(const HData &data);
+        // The bytes must outlive the reader.
+        bool open(const HBYTE *data, uint64 size);
+
+        Element root() const;
+
+    private:
+        UTILS::STRING::StringView getString(uint32 index) const;
+        bool validate(const HBYTE *&cursor, const HBYTE *end, uint32 depth) const;
+
+        HData data_;
+        const HBYTE *root_;
+        const HBYTE *end_;
+        const HBYTE *stringOffsets_;
+        const HBYTE *stringBytes_;
+        uint32 stringCount_;
+        uint32 stringBytesSize_;
+
+        DISALLOW_COPY_AND_ASSIGN(BinaryValueReader)
+    };
+}
+
+#endif // BINARYVALUE_H
@@ -1,65 +1,156 @@
 #include "DictMaker.h"
-#include "EXTERNALS/tinyxml2/tinyxml2.h"
+#include <string.h>
 #include "IO/FileUtils.h"
 
 namespace IO
 {
-    class XmlSaxHander : public tinyxml2::XMLVisitor
+    namespace
     {
-    public:
-        XmlSaxHander()
-            : saxParserImp_(nullptr){
+        inline bool IsSpace(char c) {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r';
         }
 
-        virtual bool visitEnter(const tinyxml2::XMLElement& element, const tinyxml2::XMLAttribute* firstAttribute );
-        virtual bool visitExit(const tinyxml2::XMLElement& element );
-        virtual bool visit(const tinyxml2::XMLText& text );
-        virtual bool visit(const tinyxml2::XMLUnknown&){ return true; }
-
-        void setSAXParserImp(SAXParser* parser) {
-            saxParserImp_ = parser;
+        inline bool IsNameEnd(char c) {
+            return IsSpace(c) || c == '/' || c == '>' || c == '=';
         }
 
-    private:
-        SAXParser *saxParserImp_;
-    };
+        inline bool StartsWith(const char *begin, const char *end, const char *prefix, uint64 length) {
+            return (uint64)(end - begin) >= length && memcmp(begin, prefix, length) == 0;
+        }
 
-    bool XmlSaxHander::visitEnter( const tinyxml2::XMLElement& element, const tinyxml2::XMLAttribute* firstAttribute ) {
-        std::vector<const char*> attsVector;
-        for( const tinyxml2::XMLAttribute* attrib = firstAttribute; attrib; attrib = attrib->Next() ) {
-            attsVector.push_back(attrib->Name());
-            attsVector.push_back(attrib->Value());
+        const char *Find(const char *begin, const char *end, const char *pattern, uint64 length) {
+            while ((uint64)(end - begin) >= length) {
+                const char *first = (const char *)memchr(begin, pattern[0], end - begin - length + 1);
+                if (!first) {
+                    return nullptr;
+                }
+                if (memcmp(first, pattern, length) == 0) {
+                    return first;
+                }
+                begin = first + 1;
+            }
+            return nullptr;
         }
 
-        attsVector.push_back(nullptr);
+        void AppendUTF8(std::string &out, uint32 code) {
+            if (code < 0x80) {
+                out += (char)code;
+            }
+            else if (code < 0x800) {
+                out += (char)(0xC0 | (code >> 6));
+                out += (char)(0x80 | (code & 0x3F));
+            }
+            else if (code < 0x10000) {
+                out += (char)(0xE0 | (code >> 12));
+                out += (char)(0x80 | ((code >> 6) & 0x3F));
+                out += (char)(0x80 | (code & 0x3F));
+            }
+            else {
+                out += (char)(0xF0 | (code >> 18));
+                out += (char)(0x80 | ((code >> 12) & 0x3F));
+                out += (char)(0x80 | ((code >> 6) & 0x3F));
+                out += (char)(0x80 | (code & 0x3F));
+            }
+        }
 
-        SAXParser::startElement(saxParserImp_, element.Value(), &attsVector[0]);
-        return true;
-    }
+        // Digits of a numeric character reference, false when one is not a digit of the base.
+        // Stops accumulating past 0x10FFFF, so code is out of range rather than wrapped.
+        bool ParseCharacterReference(const char *begin, const char *end, bool hex, uint32 &code) {
+            if (begin == end) {
+                return false;
+            }
 
-    bool XmlSaxHander::visitExit( const tinyxml2::XMLElement& element ) {
-        SAXParser::endElement(saxParserImp_, element.Value());
-        return true;
-    }
+            code = 0;
+            for (; begin < end; ++begin) {
+                char ch = *begin;
+                uint32 digit;
+                if (ch >= '0' && ch <= '9') {
+                    digit = ch - '0';
+                }
+                else if (hex && ch >= 'a' && ch <= 'f') {
+                    digit = ch - 'a' + 10;
+                }
+                else if (hex && ch >= 'A' && ch <= 'F') {
+                    digit = ch - 'A' + 10;
+                }
+                else {
+                    return false;
+                }
+                if (code <= 0x10FFFF) {
+                    code = code * (hex ? 16 : 10) + digit;
+                }
+            }
+            return true;
+        }
 
-    bool XmlSaxHander::visit( const tinyxml2::XMLText& text ) {
-        SAXParser::textHandler(saxParserImp_, text.Value(), static_cast<int>(strlen(text.Value())));
-        return true;
+        // Appends text with the predefined and numeric entities replaced, unknown ones are kept.
+        // Numeric ones that are no Unicode scalar value become U+FFFD.
+        void AppendDecoded(std::string &out, const char *begin, const char *end) {
+            while (begin < end) {
+                const char *amp = (const char *)memchr(begin, '&', end - begin);
+                if (!amp) {
+                    out.append(begin, end);
+                    return;
+                }
+                out.append(begin, amp);
+
+                const char *semicolon = (const char *)memchr(amp, ';', end - amp);
+                if (!semicolon) {
+                    out.append(amp, end);
+                    return;
+                }
+
+                const char *entity = amp + 1;
+                uint64 length = semicolon - entity;
+                if (length == 2 && memcmp(entity, "lt", 2) == 0) {
+                    out += '<';
+                }
+                else if (length == 2 && memcmp(entity, "gt", 2) == 0) {
+                    out += '>';
+                }
+                else if (length == 3 && memcmp(entity, "amp", 3) == 0) {
+                    out += '&';
+                }
+                else if (length == 4 && memcmp(entity, "quot", 4) == 0) {
+                    out += '"';
+                }
+                else if (length == 4 && memcmp(entity, "apos", 4) == 0) {
+                    out += '\'';
+                }
+                else if (length > 1 && entity[0] == '#') {
+                    bool hex = entity[1] == 'x' || entity[1] == 'X';
+                    uint32 code;
+                    if (!ParseCharacterReference(entity + (hex ? 2 : 1), semicolon, hex, code)) {
+                        out.append(amp, semicolon + 1);
+                    }
+                    else if (code == 0 || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) {
+                        AppendUTF8(out, 0xFFFD);
+                    }
+                    else {
+                        AppendUTF8(out, code);
+                    }
+                }
+                else {
+                    out.append(amp, semicolon + 1);
+                }
+                begin = semicolon + 1;
+            }
+        }
     }
 
     SAXParser::SAXParser() {
         delegator_ = nullptr;
+        failed_ = false;
     }
 
     SAXParser::~SAXParser(void) {
     }
 
     bool SAXParser::parse(const HBYTE* xmlData, uint64 dataLength) {
-        tinyxml2::XMLDocument tinyDoc;
-        tinyDoc.Parse((const char *)xmlData, dataLength);
-        XmlSaxHander printer;
-        printer.setSAXParserImp(this);
-        return tinyDoc.Accept( &printer );
+        reset();
+        const char *begin = (const char *)xmlData;
+        failed_ = (tokenize(begin, begin + dataLength, true) != begin + dataLength) || failed_;
+        return finish();
     }
 
     bool SAXParser::parse(const std::string& filename) {
@@ -72,6 +163,243 @@ namespace IO
         return ret;
     }
 
+    bool SAXParser::feed(const HBYTE* xmlData, uint64 dataLength) {
+        if (failed_) {
+            return false;
+        }
+
+        const char *begin = (const char *)xmlData;
+        const char *end = begin + dataLength;
+        if (pending_.empty()) {
+            const char *rest = tokenize(begin, end, false);
+            pending_.assign(rest, end);
+        }
+        else {
+            pending_.append(begin, end);
+            const char *data = pending_.data();
+            const char *rest = tokenize(data, data + pending_.size(), false);
+            pending_.erase(0, rest - data);
+        }
+        return !failed_;
+    }
+
+    bool SAXParser::finish() {
+        if (!failed_ && !pending_.empty()) {
+            const char *data = pending_.data();
+            failed_ = tokenize(data, data + pending_.size(), true) != data + pending_.size();
+        }
+
+        bool ret = !failed_ && openElements_.empty();
+        reset();
+        return ret;
+    }
+
+    void SAXParser::reset() {
+        failed_ = false;
+        pending_.clear();
+        openElements_.clear();
+    }
+
+    const char *SAXParser::tokenize(const char *begin, const char *end, bool last) {
+        const char *cursor = begin;
+        while (cursor < end && !failed_) {
+            if (*cursor != '<') {
+                const char *open = (const char *)memchr(cursor, '<', end - cursor);
+                if (!open) {
+                    // The text may go on in the next chunk.
+                    if (!last) {
+                        return cursor;
+                    }
+                    open = end;
+                }
+                emitText(cursor, open);
+                cursor = open;
+                continue;
+            }
+
+            const char *next = parseMarkup(cursor, end);
+            if (!next) {
+                if (last) {
+                    failed_ = true;
+                }
+                return cursor;
+            }
+            cursor = next;
+        }
+        return failed_ ? begin : cursor;
+    }
+
+    // Returns the position after the markup starting at begin, nullptr if it is incomplete.
+    const char *SAXParser::parseMarkup(const char *begin, const char *end) {
+        if (StartsWith(begin, end, "<!--", 4)) {
+            const char *close = Find(begin + 4, end, "-->", 3);
+            return close ? close + 3 : nullptr;
+        }
+
+        if (StartsWith(begin, end, "<![CDATA[", 9)) {
+            const char *close = Find(begin + 9, end, "]]>", 3);
+            if (!close) {
+                return nullptr;
+            }
+            if (delegator_ && close > begin + 9) {
+                SAXParser::textHandler(this, begin + 9, (int)(close - begin - 9));
+            }
+            return close + 3;
+        }
+
+        if (StartsWith(begin, end, "<?", 2)) {
+            const char *close = Find(begin + 2, end, "?>", 2);
+            return close ? close + 2 : nullptr;
+        }
+
+        if (StartsWith(begin, end, "<!", 2)) {
+            // DOCTYPE and friends, an internal subset sits between brackets.
+            int32 brackets = 0;
+            for (const char *cursor = begin + 2; cursor < end; ++cursor) {
+                if (*cursor == '[') {
+                    ++brackets;
+                }
+                else if (*cursor == ']') {
+                    --brackets;
+                }
+                else if (*cursor == '>' && brackets <= 0) {
+                    return cursor + 1;
+                }
+            }
+            return nullptr;
+        }
+
+        // Tags, '>' may appear inside quoted attribute values.
+        char quote = 0;
+        for (const char *cursor = begin + 1; cursor < end; ++cursor) {
+            char c = *cursor;
+            if (quote) {
+                if (c == quote) {
+                    quote = 0;
+                }
+            }
+            else if (c == '"' || c == '\'') {
+                quote = c;
+            }
+            else if (c == '>') {
+                bool parsed = begin[1] == '/' ? parseEndTag(begin + 2, cursor) : parseStartTag(begin + 1, cursor);
+                if (!parsed) {
+                    failed_ = true;
+                }
+                return cursor + 1;
+            }
+        }
+        return nullptr;
+    }
+
+    // [begin, end) is the tag without '<' and '>'.
+    bool SAXParser::parseStartTag(const char *begin, const char *end) {
+        bool selfClosing = end > begin && end[-1] == '/';
+        if (selfClosing) {
+            --end;
+        }
+
+        const char *cursor = begin;
+        while (cursor < end && !IsNameEnd(*cursor)) {
+            ++cursor;
+        }
+        if (cursor == begin) {
+            return false;
+        }
+        openElements_.emplace_back(begin, cursor);
+
+        uint64 attributeCount = 0;
+        while (true) {
+            while (cursor < end && IsSpace(*cursor)) {
+                ++cursor;
+            }
+            if (cursor == end) {
+                break;
+            }
+
+            const char *name = cursor;
+            while (cursor < end && !IsNameEnd(*cursor)) {
+                ++cursor;
+            }
+            const char *nameEnd = cursor;
+            while (cursor < end && IsSpace(*cursor)) {
+                ++cursor;
+            }
+            if (name == nameEnd || cursor == end || *cursor != '=') {
+                return false;
+            }
+            ++cursor;
+            while (cursor < end && IsSpace(*cursor)) {
+                ++cursor;
+            }
+            if (cursor == end || (*cursor != '"' && *cursor != '\'')) {
+                return false;
+            }
+            const char *value = cursor + 1;
+            const char *valueEnd = (const char *)memchr(value, *cursor, end - value);
+            if (!valueEnd) {
+                return false;
+            }
+            cursor = valueEnd + 1;
+
+            if (attributes_.size() < attributeCount + 2) {
+                attributes_.resize(attributeCount + 2);
+            }
+            attributes_[attributeCount].assign(name, nameEnd);
+            attributes_[attributeCount + 1].clear();
+            AppendDecoded(attributes_[attributeCount + 1], value, valueEnd);
+            attributeCount += 2;
+        }
+
+        attributePointers_.clear();
+        for (uint64 i = 0; i < attributeCount; ++i) {
+            attributePointers_.push_back(attributes_[i].c_str());
+        }
+        attributePointers_.push_back(nullptr);
+
+        const std::string &elementName = openElements_.back();
+        if (delegator_) {
+            SAXParser::startElement(this, elementName.c_str(), &attributePointers_[0]);
+        }
+        if (selfClosing) {
+            if (delegator_) {
+                SAXParser::endElement(this, elementName.c_str());
+            }
+            openElements_.pop_back();
+        }
+        return true;
+    }
+
+    bool SAXParser::parseEndTag(const char *begin, const char *end) {
+        while (end > begin && IsSpace(end[-1])) {
+            --end;
+        }
+        if (openElements_.empty() || openElements_.back().compare(0, std::string::npos, begin, end - begin) != 0) {
+            return false;
+        }
+
+        if (delegator_) {
+            SAXParser::endElement(this, openElements_.back().c_str());
+        }
+        openElements_.pop_back();
+        return true;
+    }
+
+    void SAXParser::emitText(const char *begin, const char *end) {
+        if (!delegator_ || begin == end) {
+            return;
+        }
+
+        if (!memchr(begin, '&', end - begin)) {
+            SAXParser::textHandler(this, begin, (int)(end - begin));
+            return;
+        }
+
+        text_.clear();
+        AppendDecoded(text_, begin, end);
+        SAXParser::textHandler(this, text_.data(), (int)text_.size());
+    }
+
     void SAXParser::startElement(void *ctx, const char *name, const char **atts) {
         ((SAXParser*)(ctx))->delegator_->startElement(ctx, name, atts);
     }
@@ -89,7 +417,10 @@ namespace IO
     }
 
     DictMaker::DictMaker()
-        : resultType_(SAX_RESULT_NONE) {
+        : resultType_(SAX_RESULT_NONE)
+        , state_(SAX_NONE)
+        , curDict_(nullptr)
+        , curArray_(nullptr) {
     }
 
     DictMaker::~DictMaker() {
@@ -99,30 +430,35 @@ namespace IO
         resultType_ = SAX_RESULT_DICT;
         SAXParser parser;
         parser.setDelegator(this);
-        parser.parse(fileName);
-        return rootDict_;
+        if (!parser.parse(fileName)) {
+            rootDict_.clear();
+        }
+        return std::move(rootDict_);
     }
 
     ValueMap DictMaker::dictionaryWithDataOfFile(const HBYTE* filedata, int filesize) {
         resultType_ = SAX_RESULT_DICT;
         SAXParser parser;
         parser.setDelegator(this);
-        parser.parse(filedata, filesize);
-        return rootDict_;
+        if (!parser.parse(filedata, filesize)) {
+            rootDict_.clear();
+        }
+        return std::move(rootDict_);
     }
 
     ValueVector DictMaker::arrayWithContentsOfFile(const std::string& fileName) {
         resultType_ = SAX_RESULT_ARRAY;
         SAXParser parser;
         parser.setDelegator(this);
-        parser.parse(fileName);
-        return rootArray_;
+        if (!parser.parse(fileName)) {
+            rootArray_.clear();
+        }
+        return std::move(rootArray_);
     }
 
     void DictMaker::startElement(void *, const char *name, const char **) {
-        const std::string sName(name);
-        if( sName == "dict" ) {
-            if(resultType_ == SAX_RESULT_DICT && rootDict_.empty()) {
+        if (strcmp(name, "dict") == 0) {
+            if (resultType_ == SAX_RESULT_DICT && stateStack_.empty()) {
                 curDict_ = &rootDict_;
             }
 
@@ -141,30 +477,32 @@ namespace IO
             else if (SAX_DICT == preState) {
                 // add a new dictionary into the pre dictionary
                 ValueMap* preDict = dictStack_.top();
-                (*preDict)[curKey_] = HValue(ValueMap());
-                curDict_ = &(*preDict)[curKey_].asValueMap();
+                HValue &value = (*preDict)[curKey_];
+                value = ValueMap();
+                curDict_ = &value.asValueMap();
             }
 
             // record the dict state
             stateStack_.push(state_);
             dictStack_.push(curDict_);
         }
-        else if(sName == "key") {
+        else if (strcmp(name, "key") == 0) {
             state_ = SAX_KEY;
+            curKey_.clear();
         }
-        else if(sName == "integer") {
+        else if (strcmp(name, "integer") == 0) {
             state_ = SAX_INT;
         }
-        else if(sName == "real") {
+        else if (strcmp(name, "real") == 0) {
             state_ = SAX_REAL;
         }
-        else if(sName == "string") {
+        else if (strcmp(name, "string") == 0) {
             state_ = SAX_STRING;
         }
-        else if (sName == "array") {
+        else if (strcmp(name, "array") == 0) {
             state_ = SAX_ARRAY;
 
-            if (resultType_ == SAX_RESULT_ARRAY && rootArray_.empty()) {
+            if (resultType_ == SAX_RESULT_ARRAY && stateStack_.empty()) {
                 curArray_ = &rootArray_;
             }
             SAXState preState = SAX_NONE;
@@ -173,13 +511,14 @@ namespace IO
             }
 
             if (preState == SAX_DICT) {
-                (*curDict_)[curKey_] = HValue(ValueVector());
-                curArray_ = &(*curDict_)[curKey_].asValueVector();
+                HValue &value = (*curDict_)[curKey_];
+                value = ValueVector();
+                curArray_ = &value.asValueVector();
             }
             else if (preState == SAX_ARRAY) {
                 ValueVector* preArray = arrayStack_.top();
                 preArray->push_back(HValue(ValueVector()));
-                curArray_ = &(curArray_->rbegin())->asValueVector();
+                curArray_ = &(preArray->rbegin())->asValueVector();
             }
             // record the array state
             stateStack_.push(state_);
@@ -192,15 +531,14 @@ namespace IO
 
     void DictMaker::endElement(void *, const char *name) {
         SAXState curState = stateStack_.empty() ? SAX_DICT : stateStack_.top();
-        const std::string sName((char*)name);
-        if( sName == "dict" ) {
+        if (strcmp(name, "dict") == 0) {
             stateStack_.pop();
             dictStack_.pop();
             if ( !dictStack_.empty()) {
                 curDict_ = dictStack_.top();
             }
         }
-        else if (sName == "array") {
+        else if (strcmp(name, "array") == 0) {
             stateStack_.pop();
             arrayStack_.pop();
             if (! arrayStack_.empty())
@@ -208,40 +546,30 @@ namespace IO
                 curArray_ = arrayStack_.top();
             }
         }
-        else if (sName == "true") {
+        else if (strcmp(name, "true") == 0 || strcmp(name, "false") == 0) {
+            HValue value(name[0] == 't');
             if (SAX_ARRAY == curState) {
-                curArray_->push_back(HValue(true));
+                curArray_->push_back(std::move(value));
             }
             else if (SAX_DICT == curState)
             {
-                (*curDict_)[curKey_] = HValue(true);
+                (*curDict_)[curKey_] = std::move(value);
             }
         }
-        else if (sName == "false") {
-            if (SAX_ARRAY == curState) {
-                curArray_->push_back(HValue(false));
-            }
-            else if (SAX_DICT == curState)
-            {
-                (*curDict_)[curKey_] = HValue(false);
-            }
-        }
-        else if (sName == "string" || sName == "integer" || sName == "real") {
+        else if (state_ == SAX_STRING || state_ == SAX_INT || state_ == SAX_REAL) {
+            HValue value;
+            if (state_ == SAX_STRING)
+                value = HValue(curValue_.data(), curValue_.size());
+            else if (state_ == SAX_INT)
+                value = HValue(atoi(curValue_.c_str()));
+            else
+                value = HValue(atof(curValue_.c_str()));
+
             if (SAX_ARRAY == curState) {
-                if (sName == "string")
-                    curArray_->push_back(HValue(curValue_));
-                else if (sName == "integer")
-                    curArray_->push_back(HValue(atoi(curValue_.c_str())));
-                else
-                    curArray_->push_back(HValue(atof(curValue_.c_str())));
+                curArray_->push_back(std::move(value));
             }
             else if (SAX_DICT == curState) {
-                if (sName == "string")
-                    (*curDict_)[curKey_] = HValue(curValue_);
-                else if (sName == "integer")
-                    (*curDict_)[curKey_] = HValue(atoi(curValue_.c_str()));
-                else
-                    (*curDict_)[curKey_] = HValue(atof(curValue_.c_str()));
+                (*curDict_)[curKey_] = std::move(value);
             }
 
             curValue_.clear();
@@ -256,19 +584,19 @@ namespace IO
         }
 
         SAXState curState = stateStack_.empty() ? SAX_DICT : stateStack_.top();
-        const std::string text = std::string((char*)ch,len);
 
+        // Text may arrive in pieces, around entities and CDATA sections.
         switch(state_) {
         case SAX_KEY:
-            curKey_ = text;
+            curKey_.append(ch, len);
             break;
         case SAX_INT:
         case SAX_REAL:
         case SAX_STRING: {
-                if (curState == SAX_DICT)
+                if (curState == SAX_DICT && curKey_.empty())
                     throw _HException_Normal("key not found : <integer/real>");
 
-                curValue_.append(text);
+                curValue_.append(ch, len);
             }
             break;
         default:
@@ -2,6 +2,8 @@
 #define DICTMAKER_H
 
 #include <stack>
+#include <string>
+#include <vector>
 #include "BASE/Honey.h"
 #include "BASE/HValue.h"
 #include "BASE/HData.h"
@@ -19,20 +21,46 @@ namespace IO
         virtual void textHandler(void *ctx, const char *s, int len) = 0;
     };
 
+    // Single pass XML tokenizer, events go straight to the delegator without building a
+    // document. Text is handed out as a view into the input unless it holds entities or
+    // CDATA. Input can come whole, parse(), or in chunks through feed() and finish(), an
+    // incomplete token at the end of a chunk is kept until the next one arrives.
+    // Comments, processing instructions and DOCTYPE are skipped.
     class SAXParser
     {
     public:
         SAXParser();
         ~SAXParser(void);
         bool parse(const HBYTE* xmlData, uint64 dataLength);
+        // Large files are mapped rather than read.
         bool parse(const std::string& filename);
+        bool feed(const HBYTE* xmlData, uint64 dataLength);
+        bool finish();
         void setDelegator(SAXDelegator* delegator);
         static void startElement(void *ctx, const char *name, const char **atts);
         static void endElement(void *ctx, const char *name);
         static void textHandler(void *ctx, const char *name, int len);
 
+    private:
+        // Returns where the first incomplete token starts, end when everything was used.
+        const char *tokenize(const char *begin, const char *end, bool last);
+        const char *parseMarkup(const char *begin, const char *end);
+        bool parseStartTag(const char *begin, const char *end);
+        bool parseEndTag(const char *begin, const char *end);
+        void emitText(const char *begin, const char *end);
+        void reset();
+
     private:
         SAXDelegator*  delegator_;
+        bool failed_;
+
+        std::string pending_;
+        std::vector<std::string> openElements_;
+
+        // Scratch space reused between events.
+        std::string text_;
+        std::vector<std::string> attributes_;
+        std::vector<const char*> attributePointers_;
     };
 
     typedef enum
@@ -26,6 +26,7 @@
 using UTILS::STRING::UTF8ToWString;
 #include "UTILS/STRING/StringUtils.h"
 using UTILS::STRING::StringFromFormat;
+#include "IO/BinaryValue.h"
 #include "IO/DictMaker.h"
 
 namespace IO
@@ -123,6 +124,16 @@ namespace IO
     };
     #endif
 
+    // Same name with BinaryValueReader::FILE_EXTENSION in place of the extension.
+    static std::string GetBinaryTwinName(const std::string &filename) {
+        uint64 dot = filename.find_last_of('.');
+        uint64 slash = filename.find_last_of('/');
+        if (dot != std::string::npos && slash != std::string::npos && dot < slash) {
+            dot = std::string::npos;
+        }
+        return filename.substr(0, dot) + BinaryValueReader::FILE_EXTENSION;
+    }
+
     FileUtils &FileUtils::getInstance() {
         #ifdef _WIN32
         static FileUtilsWin instance;
@@ -155,20 +166,15 @@ namespace IO
         if (data.isNull())
             return "";
 
-        std::string ret((const char*)data.getBytes());
-        ret.append('\0');
-        return ret;
+        return std::string((const char*)data.getBytes(), data.getSize());
     }
 
     void FileUtils::writeStringToFile(std::string dataStr, const std::string& fullPath) {
-        HData retData;
-        retData.copy((HBYTE *)dataStr.c_str(), dataStr.size());
-
-        return writeDataToFile(retData, fullPath);
+        return writeDataToFile(HData::wrap((const HBYTE *)dataStr.data(), dataStr.size()), fullPath);
     }
 
 
-    void FileUtils::writeDataToFile(HData retData, const std::string& fullPath) {
+    void FileUtils::writeDataToFile(const HData &retData, const std::string& fullPath) {
         if (retData.isNull() || fullPath.empty()) {
             throw _HException_Normal("FileUitls::writeDataToFile Params Error!");
         }
@@ -194,13 +200,33 @@ namespace IO
     }
 
     ValueMap FileUtils::getValueMapFromFile(const std::string& filename) {
-        const std::string fullPath = fullPathForFilename(filename.c_str());
-        DictMaker tMaker;
-        return tMaker.dictionaryWithContentsOfFile(fullPath.c_str());
+        std::string fullPath = fullPathForFilename(filename);
+        if (fullPath.empty()) {
+            // Shipped without the plist.
+            fullPath = fullPathForFilename(GetBinaryTwinName(filename));
+        }
+        else {
+            std::string binaryPath = getBinaryTwinPath(fullPath);
+            if (!binaryPath.empty()) {
+                fullPath = binaryPath;
+            }
+        }
+
+        HData data = getData(fullPath);
+        return getValueMapFromData(data.getBytes(), (int)data.getSize());
     }
 
     ValueMap FileUtils::getValueMapFromData(const HBYTE* filedata, int filesize)
     {
+        if (BinaryValueReader::isBinaryValue(filedata, filesize)) {
+            BinaryValueReader reader;
+            if (!reader.open(filedata, filesize) || reader.root().getType() != HValue::Type::MAP) {
+                throw _HException_Normal("FileUtils::getValueMapFromData malformed binary value!");
+            }
+            HValue root = reader.root().toValue();
+            return std::move(root.asValueMap());
+        }
+
         DictMaker tMaker;
         return tMaker.dictionaryWithDataOfFile(filedata, filesize);
     }
@@ -249,9 +275,12 @@ namespace IO
         }
 
         // Already Cached ?
-        auto cacheIter = fullPathCache_.find(filename);
-        if(cacheIter != fullPathCache_.end()) {
-            return cacheIter->second;
+        {
+            shared_lock_guard<shared_mutex> lock(fullPathCacheMutex_);
+            auto cacheIter = fullPathCache_.find(filename);
+            if(cacheIter != fullPathCache_.end()) {
+                return cacheIter->second;
+            }
         }
 
         // Get the new file name.
@@ -263,6 +292,7 @@ namespace IO
                 fullpath = getPathForFilename(newFilename, resolutionIt, searchIt);
                 if (fullpath.length() > 0) {
                     // Using the filename passed in as key.
+                    std::lock_guard<shared_mutex> lock(fullPathCacheMutex_);
                     fullPathCache_.insert(std::make_pair(filename, fullpath));
                     return fullpath;
                 }
@@ -272,6 +302,31 @@ namespace IO
         return "";
     }
 
+    std::string FileUtils::getBinaryTwinPath(const std::string &fullPath) const {
+        // Keyed by the twin's own path, an absolute path is never a filename key.
+        std::string binaryPath = GetBinaryTwinName(fullPath);
+        {
+            shared_lock_guard<shared_mutex> lock(fullPathCacheMutex_);
+            auto cacheIter = fullPathCache_.find(binaryPath);
+            if (cacheIter != fullPathCache_.end()) {
+                return cacheIter->second;
+            }
+        }
+
+        // Only a twin next to the plist and at least as new counts, misses are cached too.
+        struct stat binaryInfo;
+        struct stat plistInfo;
+        std::string found;
+        if (stat(binaryPath.c_str(), &binaryInfo) == 0 && stat(fullPath.c_str(), &plistInfo) == 0 &&
+            binaryInfo.st_mtime >= plistInfo.st_mtime) {
+            found = binaryPath;
+        }
+
+        std::lock_guard<shared_mutex> lock(fullPathCacheMutex_);
+        fullPathCache_.insert(std::make_pair(binaryPath, found));
+        return found;
+    }
+
     std::string FileUtils::getPathForFilename(const std::string& filename, const std::string& resolutionDirectory, const std::string& searchPath) const {
         std::string file = filename;
         std::string file_path = "";
@@ -334,9 +389,16 @@ namespace IO
         }
 
         // Already Cached ?
-        auto cacheIter = fullPathCache_.find(dirPath);
-        if( cacheIter != fullPathCache_.end() ) {
-            return isDirectoryExistInternal(cacheIter->second);
+        std::string cachedPath;
+        {
+            shared_lock_guard<shared_mutex> lock(fullPathCacheMutex_);
+            auto cacheIter = fullPathCache_.find(dirPath);
+            if( cacheIter != fullPathCache_.end() ) {
+                cachedPath = cacheIter->second;
+            }
+        }
+        if (!cachedPath.empty()) {
+            return isDirectoryExistInternal(cachedPath);
         }
 
         std::string fullpath;
@@ -346,6 +408,7 @@ namespace IO
                 fullpath = searchIt + dirPath + resolutionIt;
                 if (isDirectoryExistInternal(fullpath))
                 {
+                    std::lock_guard<shared_mutex> lock(fullPathCacheMutex_);
                     fullPathCache_.insert(std::make_pair(dirPath, fullpath));
                     return true;
                 }
@@ -378,13 +441,19 @@ namespace IO
     }
 
     void FileUtils::setFilenameLookupDictionary(const ValueMap& filenameLookupDict) {
-        fullPathCache_.clear();
+        {
+            std::lock_guard<shared_mutex> lock(fullPathCacheMutex_);
+            fullPathCache_.clear();
+        }
         filenameLookupDict_ = filenameLookupDict;
     }
 
     void FileUtils::setSearchResolutionsOrder(const std::vector<std::string>& searchResolutionsOrder) {
         bool existDefault = false;
-        fullPathCache_.clear();
+        {
+            std::lock_guard<shared_mutex> lock(fullPathCacheMutex_);
+            fullPathCache_.clear();
+        }
         searchResolutionsOrderArray_.clear();
         for(const auto& iter : searchResolutionsOrder)
         {
@@ -419,7 +488,10 @@ namespace IO
     }
 
     void FileUtils::setSearchPaths(const std::vector<std::string>& searchPaths) {
-        fullPathCache_.clear();
+        {
+            std::lock_guard<shared_mutex> lock(fullPathCacheMutex_);
+            fullPathCache_.clear();
+        }
         searchPathArray_.clear();
         for (const auto& iter : searchPaths) {
             std::string prefix;
@@ -474,6 +546,15 @@ namespace IO
             size = ftell(fp);
             fseek(fp,0,SEEK_SET);
 
+            // Large binary files are mapped instead of copied into the heap.
+            if (size >= MAP_FILE_THRESHOLD && mode == "rb") {
+                ret = HData::mapFile(getSuitableFOpen(fullPath));
+                if (!ret.isNull()) {
+                    fclose(fp);
+                    return ret;
+                }
+            }
+
             buffer = (HBYTE*)malloc(sizeof(HBYTE) * size);
 
             readSize = fread(buffer, sizeof(unsigned char), size, fp);
@@ -8,6 +8,7 @@
 #include "BASE/Honey.h"
 #include "BASE/HData.h"
 #include "BASE/HValue.h"
+#include "BASE/Mutex.h"
 
 namespace IO
 {
@@ -22,11 +23,13 @@ namespace IO
         std::string getStringFromFile(const std::string& filename);
         HData getDataFromFile(const std::string& filename);
 
+        // Reads the binary twin (BinaryValueReader::FILE_EXTENSION) next to the plist instead
+        // when it is at least as new.
         ValueMap getValueMapFromFile(const std::string& filename);
         ValueMap getValueMapFromData(const HBYTE* filedata, int filesize);
 
         void writeStringToFile(std::string dataStr, const std::string& fullPath);
-        void writeDataToFile(HData retData, const std::string& fullPath);
+        void writeDataToFile(const HData &retData, const std::string& fullPath);
 
         std::string getFilenameForNick(const std::string &filename) const;
         std::string getNewFilename(const std::string &filename) const;
@@ -59,13 +62,20 @@ namespace IO
         virtual bool isDirectoryExistInternal(const std::string& dirPath) const = 0;
 
     private:
+        // Files at least this large are read through a memory mapping.
+        static const uint64 MAP_FILE_THRESHOLD = 256 * 1024;
+
         HData getData(const std::string& filename, const std::string &mode = "rb");
+        // The binary twin of a resolved plist, empty without an up to date one next to it.
+        std::string getBinaryTwinPath(const std::string &fullPath) const;
 
     private:
         ValueMap filenameLookupDict_;
         std::vector<std::string> searchResolutionsOrderArray_;
         std::vector<std::string> searchPathArray_;
         mutable std::unordered_map<std::string, std::string> fullPathCache_;
+        // Paths are resolved from loader threads too.
+        mutable shared_mutex fullPathCacheMutex_;
     };
 }
 
@@ -1,14 +1,29 @@
 #include "HashUtils.h"
 
+#include <string.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <nmmintrin.h>
+#define HASH_X86_CRC32C 1
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <nmmintrin.h>
+#define HASH_X86_CRC32C 1
+#elif defined(__GNUC__) && defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define HASH_ARM_CRC32C 1
+#endif
+
 namespace UTILS
 {
     namespace HASH
     {
-        // WARNING - may read one more byte! Fine if the input is a null-terminated string.
         // Implementation from Wikipedia.
+        // The trailing byte of an odd length is padded with zero instead of read past the buffer,
+        // which matches the old result for null-terminated strings.
         uint32 Fletcher(const uint8 *data_uint8, uint64 length) {
           const uint16 *data = (const uint16 *)data_uint8;
-          uint64 len = (length + 1) / 2;
+          uint64 len = length / 2;
           uint32 sum1 = 0xffff, sum2 = 0xffff;
 
           while (len) {
@@ -24,6 +39,15 @@ namespace UTILS
             sum2 = (sum2 & 0xffff) + (sum2 >> 16);
           }
 
+          if (length & 1) {
+            uint16 last = 0;
+            memcpy(&last, data_uint8 + length - 1, 1);
+            sum1 += last;
+            sum2 += sum1;
+            sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+            sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+          }
+
           /* Second reduction step to reduce sums to 16 bits */
           sum1 = (sum1 & 0xffff) + (sum1 >> 16);
           sum2 = (sum2 & 0xffff) + (sum2 >> 16);
@@ -61,6 +85,406 @@ namespace UTILS
           }
           return (b << 16) | a;
         }
+
+        // Hashes are defined on little-endian reads so the values are stable across platforms.
+        static inline uint64 Read64(const uint8 *ptr) {
+            uint64 value;
+            memcpy(&value, ptr, sizeof(value));
+        #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            value = swap64(value);
+        #endif
+            return value;
+        }
+
+        static inline uint32 Read32(const uint8 *ptr) {
+            uint32 value;
+            memcpy(&value, ptr, sizeof(value));
+        #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            value = swap32(value);
+        #endif
+            return value;
+        }
+
+        static inline uint64 Rotl64(uint64 value, int bits) {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        // XXH64 by Yann Collet, BSD licensed reference: https://github.com/Cyan4973/xxHash
+        static const uint64 XXH_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+        static const uint64 XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+        static const uint64 XXH_PRIME64_3 = 0x165667B19E3779F9ULL;
+        static const uint64 XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+        static const uint64 XXH_PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+        static inline uint64 XXH64Round(uint64 acc, uint64 input) {
+            acc += input * XXH_PRIME64_2;
+            acc = Rotl64(acc, 31);
+            return acc * XXH_PRIME64_1;
+        }
+
+        static inline uint64 XXH64MergeRound(uint64 acc, uint64 value) {
+            acc ^= XXH64Round(0, value);
+            return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+        }
+
+        static inline const uint8 *XXH64Stripes(uint64 acc[4], const uint8 *data, const uint8 *limit) {
+            uint64 v1 = acc[0], v2 = acc[1], v3 = acc[2], v4 = acc[3];
+            do {
+                v1 = XXH64Round(v1, Read64(data));
+                v2 = XXH64Round(v2, Read64(data + 8));
+                v3 = XXH64Round(v3, Read64(data + 16));
+                v4 = XXH64Round(v4, Read64(data + 24));
+                data += 32;
+            } while (data <= limit);
+            acc[0] = v1; acc[1] = v2; acc[2] = v3; acc[3] = v4;
+            return data;
+        }
+
+        static inline uint64 XXH64Converge(const uint64 acc[4]) {
+            uint64 hash = Rotl64(acc[0], 1) + Rotl64(acc[1], 7) + Rotl64(acc[2], 12) + Rotl64(acc[3], 18);
+            hash = XXH64MergeRound(hash, acc[0]);
+            hash = XXH64MergeRound(hash, acc[1]);
+            hash = XXH64MergeRound(hash, acc[2]);
+            return XXH64MergeRound(hash, acc[3]);
+        }
+
+        static inline uint64 XXH64Finalize(uint64 hash, const uint8 *data, uint64 len) {
+            while (len >= 8) {
+                hash ^= XXH64Round(0, Read64(data));
+                hash = Rotl64(hash, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+                data += 8;
+                len -= 8;
+            }
+            if (len >= 4) {
+                hash ^= (uint64)Read32(data) * XXH_PRIME64_1;
+                hash = Rotl64(hash, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+                data += 4;
+                len -= 4;
+            }
+            while (len--) {
+                hash ^= (*data++) * XXH_PRIME64_5;
+                hash = Rotl64(hash, 11) * XXH_PRIME64_1;
+            }
+
+            hash ^= hash >> 33;
+            hash *= XXH_PRIME64_2;
+            hash ^= hash >> 29;
+            hash *= XXH_PRIME64_3;
+            hash ^= hash >> 32;
+            return hash;
+        }
+
+        static inline void XXH64Init(uint64 acc[4], uint64 seed) {
+            acc[0] = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+            acc[1] = seed + XXH_PRIME64_2;
+            acc[2] = seed;
+            acc[3] = seed - XXH_PRIME64_1;
+        }
+
+        uint64 Hash64(const uint8 *data, uint64 len, uint64 seed) {
+            const uint8 *end = data + len;
+            uint64 hash;
+
+            if (len >= 32) {
+                uint64 acc[4];
+                XXH64Init(acc, seed);
+                data = XXH64Stripes(acc, data, end - 32);
+                hash = XXH64Converge(acc);
+            }
+            else {
+                hash = seed + XXH_PRIME64_5;
+            }
+
+            hash += len;
+            return XXH64Finalize(hash, data, end - data);
+        }
+
+        Hash64State::Hash64State(uint64 seed) {
+            reset(seed);
+        }
+
+        void Hash64State::reset(uint64 seed) {
+            XXH64Init(acc_, seed);
+            seed_ = seed;
+            totalLength_ = 0;
+            bufferSize_ = 0;
+        }
+
+        void Hash64State::update(const uint8 *data, uint64 len) {
+            if (len == 0)
+                return;
+
+            const uint8 *end = data + len;
+            totalLength_ += len;
+
+            if (bufferSize_ + len < 32) {
+                memcpy(buffer_ + bufferSize_, data, len);
+                bufferSize_ += (uint32)len;
+                return;
+            }
+
+            if (bufferSize_) {
+                uint32 fill = 32 - bufferSize_;
+                memcpy(buffer_ + bufferSize_, data, fill);
+                XXH64Stripes(acc_, buffer_, buffer_);
+                data += fill;
+                bufferSize_ = 0;
+            }
+
+            if (end - data >= 32) {
+                data = XXH64Stripes(acc_, data, end - 32);
+            }
+
+            if (data < end) {
+                bufferSize_ = (uint32)(end - data);
+                memcpy(buffer_, data, bufferSize_);
+            }
+        }
+
+        uint64 Hash64State::digest() const {
+            uint64 hash;
+            if (totalLength_ >= 32) {
+                hash = XXH64Converge(acc_);
+            }
+            else {
+                hash = seed_ + XXH_PRIME64_5;
+            }
+
+            hash += totalLength_;
+            return XXH64Finalize(hash, buffer_, bufferSize_);
+        }
+
+        // MurmurHash3 x64_128 by Austin Appleby, placed in the public domain.
+        static const uint64 MURMUR_C1 = 0x87C37B91114253D5ULL;
+        static const uint64 MURMUR_C2 = 0x4CF5AD432745937FULL;
+
+        static inline uint64 MurmurMix64(uint64 k) {
+            k ^= k >> 33;
+            k *= 0xFF51AFD7ED558CCDULL;
+            k ^= k >> 33;
+            k *= 0xC4CEB9FE1A85EC53ULL;
+            k ^= k >> 33;
+            return k;
+        }
+
+        static inline void MurmurBlocks(uint64 &h1, uint64 &h2, const uint8 *data, uint64 blocks) {
+            for (uint64 i = 0; i < blocks; ++i, data += 16) {
+                uint64 k1 = Read64(data);
+                uint64 k2 = Read64(data + 8);
+
+                k1 *= MURMUR_C1; k1 = Rotl64(k1, 31); k1 *= MURMUR_C2; h1 ^= k1;
+                h1 = Rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52DCE729;
+
+                k2 *= MURMUR_C2; k2 = Rotl64(k2, 33); k2 *= MURMUR_C1; h2 ^= k2;
+                h2 = Rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495AB5;
+            }
+        }
+
+        static inline Hash128Value MurmurFinalize(uint64 h1, uint64 h2, const uint8 *tail, uint64 tailLength, uint64 totalLength) {
+            uint64 k1 = 0;
+            uint64 k2 = 0;
+
+            for (uint64 i = tailLength; i > 8; --i) {
+                k2 ^= (uint64)tail[i - 1] << ((i - 9) * 8);
+            }
+            for (uint64 i = tailLength > 8 ? 8 : tailLength; i > 0; --i) {
+                k1 ^= (uint64)tail[i - 1] << ((i - 1) * 8);
+            }
+
+            if (tailLength > 8) {
+                k2 *= MURMUR_C2; k2 = Rotl64(k2, 33); k2 *= MURMUR_C1; h2 ^= k2;
+            }
+            if (tailLength > 0) {
+                k1 *= MURMUR_C1; k1 = Rotl64(k1, 31); k1 *= MURMUR_C2; h1 ^= k1;
+            }
+
+            h1 ^= totalLength;
+            h2 ^= totalLength;
+            h1 += h2;
+            h2 += h1;
+            h1 = MurmurMix64(h1);
+            h2 = MurmurMix64(h2);
+            h1 += h2;
+            h2 += h1;
+
+            Hash128Value result;
+            result.low = h1;
+            result.high = h2;
+            return result;
+        }
+
+        Hash128Value Hash128(const uint8 *data, uint64 len, uint32 seed) {
+            uint64 h1 = seed;
+            uint64 h2 = seed;
+            uint64 blocks = len / 16;
+
+            MurmurBlocks(h1, h2, data, blocks);
+            return MurmurFinalize(h1, h2, data + blocks * 16, len & 15, len);
+        }
+
+        Hash128State::Hash128State(uint32 seed) {
+            reset(seed);
+        }
+
+        void Hash128State::reset(uint32 seed) {
+            h1_ = seed;
+            h2_ = seed;
+            totalLength_ = 0;
+            bufferSize_ = 0;
+        }
+
+        void Hash128State::update(const uint8 *data, uint64 len) {
+            if (len == 0)
+                return;
+
+            totalLength_ += len;
+
+            if (bufferSize_) {
+                uint64 fill = 16 - bufferSize_;
+                if (len < fill) {
+                    memcpy(buffer_ + bufferSize_, data, len);
+                    bufferSize_ += (uint32)len;
+                    return;
+                }
+                memcpy(buffer_ + bufferSize_, data, fill);
+                MurmurBlocks(h1_, h2_, buffer_, 1);
+                data += fill;
+                len -= fill;
+                bufferSize_ = 0;
+            }
+
+            uint64 blocks = len / 16;
+            MurmurBlocks(h1_, h2_, data, blocks);
+            bufferSize_ = (uint32)(len & 15);
+            memcpy(buffer_, data + blocks * 16, bufferSize_);
+        }
+
+        Hash128Value Hash128State::digest() const {
+            return MurmurFinalize(h1_, h2_, buffer_, bufferSize_, totalLength_);
+        }
+
+        // Software CRC32C, slicing-by-8 over the reflected Castagnoli polynomial.
+        struct CRC32CTable
+        {
+            uint32 table[8][256];
+
+            CRC32CTable() {
+                for (uint32 i = 0; i < 256; ++i) {
+                    uint32 crc = i;
+                    for (int bit = 0; bit < 8; ++bit) {
+                        crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+                    }
+                    table[0][i] = crc;
+                }
+                for (uint32 i = 0; i < 256; ++i) {
+                    for (int slice = 1; slice < 8; ++slice) {
+                        table[slice][i] = (table[slice - 1][i] >> 8) ^ table[0][table[slice - 1][i] & 0xFF];
+                    }
+                }
+            }
+        };
+
+        static const CRC32CTable crc32cTable;
+
+        static uint32 CRC32CSoftware(const uint8 *data, uint64 len, uint32 crc) {
+            const uint32 (*table)[256] = crc32cTable.table;
+
+            while (len >= 8) {
+                uint32 low = Read32(data) ^ crc;
+                uint32 high = Read32(data + 4);
+                crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^
+                      table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+                      table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^
+                      table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+                data += 8;
+                len -= 8;
+            }
+            while (len--) {
+                crc = (crc >> 8) ^ table[0][(crc ^ *data++) & 0xFF];
+            }
+            return crc;
+        }
+
+        #if defined(HASH_X86_CRC32C)
+
+        #if defined(__GNUC__)
+        __attribute__((target("sse4.2")))
+        #endif
+        static uint32 CRC32CHardware(const uint8 *data, uint64 len, uint32 crc) {
+        #if defined(__x86_64__) || defined(_M_X64)
+            uint64 crc64 = crc;
+            while (len >= 8) {
+                uint64 value;
+                memcpy(&value, data, sizeof(value));
+                crc64 = _mm_crc32_u64(crc64, value);
+                data += 8;
+                len -= 8;
+            }
+            crc = (uint32)crc64;
+        #endif
+            while (len >= 4) {
+                uint32 value;
+                memcpy(&value, data, sizeof(value));
+                crc = _mm_crc32_u32(crc, value);
+                data += 4;
+                len -= 4;
+            }
+            while (len--) {
+                crc = _mm_crc32_u8(crc, *data++);
+            }
+            return crc;
+        }
+
+        static bool DetectHardwareCRC32C() {
+        #if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            return (info[2] & (1 << 20)) != 0;
+        #else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse4.2") != 0;
+        #endif
+        }
+
+        #elif defined(HASH_ARM_CRC32C)
+
+        static uint32 CRC32CHardware(const uint8 *data, uint64 len, uint32 crc) {
+            while (len >= 8) {
+                uint64 value;
+                memcpy(&value, data, sizeof(value));
+                crc = __crc32cd(crc, value);
+                data += 8;
+                len -= 8;
+            }
+            while (len--) {
+                crc = __crc32cb(crc, *data++);
+            }
+            return crc;
+        }
+
+        static bool DetectHardwareCRC32C() {
+            return true;
+        }
+
+        #endif
+
+        bool HasHardwareCRC32C() {
+        #if defined(HASH_X86_CRC32C) || defined(HASH_ARM_CRC32C)
+            static const bool supported = DetectHardwareCRC32C();
+            return supported;
+        #else
+            return false;
+        #endif
+        }
+
+        uint32 CRC32C(const uint8 *data, uint64 len, uint32 crc) {
+            crc = ~crc;
+        #if defined(HASH_X86_CRC32C) || defined(HASH_ARM_CRC32C)
+            if (HasHardwareCRC32C()) {
+                return ~CRC32CHardware(data, len, crc);
+            }
+        #endif
+            return ~CRC32CSoftware(data, len, crc);
+        }
     }
 }
-
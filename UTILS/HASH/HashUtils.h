@@ -7,8 +7,74 @@ namespace UTILS
 {
     namespace HASH
     {
-        uint32 Fletcher(const uint8 *data_u8, uint64 length);  // FAST. Length & 1 == 0.
+        uint32 Fletcher(const uint8 *data_u8, uint64 length);  // FAST. Odd lengths are zero padded.
         uint32 Adler32(const uint8 *data, uint64 len);         // Fairly accurate, slightly slower
+
+        struct Hash128Value
+        {
+            uint64 low;
+            uint64 high;
+
+            bool operator==(const Hash128Value &other) const { return low == other.low && high == other.high; }
+            bool operator!=(const Hash128Value &other) const { return !(*this == other); }
+        };
+
+        // Non-cryptographic hashes for content keys. Hash64 is XXH64, Hash128 is MurmurHash3 x64_128.
+        uint64 Hash64(const uint8 *data, uint64 len, uint64 seed = 0);
+        Hash128Value Hash128(const uint8 *data, uint64 len, uint32 seed = 0);
+
+        // Castagnoli CRC. Pass the previous result as crc to continue a checksum over several chunks.
+        uint32 CRC32C(const uint8 *data, uint64 len, uint32 crc = 0);
+        bool HasHardwareCRC32C();
+
+        // Incremental versions for hashing data that arrives in chunks (large files, streams).
+        // Feeding the same bytes through update() in any split gives the one-shot result.
+        class Hash64State
+        {
+        public:
+            explicit Hash64State(uint64 seed = 0);
+
+            void reset(uint64 seed = 0);
+            void update(const uint8 *data, uint64 len);
+            uint64 digest() const;
+
+        private:
+            uint64 acc_[4];
+            uint64 seed_;
+            uint64 totalLength_;
+            uint8 buffer_[32];
+            uint32 bufferSize_;
+        };
+
+        class Hash128State
+        {
+        public:
+            explicit Hash128State(uint32 seed = 0);
+
+            void reset(uint32 seed = 0);
+            void update(const uint8 *data, uint64 len);
+            Hash128Value digest() const;
+
+        private:
+            uint64 h1_;
+            uint64 h2_;
+            uint64 totalLength_;
+            uint8 buffer_[16];
+            uint32 bufferSize_;
+        };
+
+        class CRC32CState
+        {
+        public:
+            CRC32CState() : crc_(0) {}
+
+            void reset() { crc_ = 0; }
+            void update(const uint8 *data, uint64 len) { crc_ = CRC32C(data, len, crc_); }
+            uint32 digest() const { return crc_; }
+
+        private:
+            uint32 crc_;
+        };
     }
 }
 
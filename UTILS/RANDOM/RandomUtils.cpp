@@ -0,0 +1,264 @@
+#include "RandomUtils.h"
+
+#include <math.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RANDOM_SSE2 1
+#endif
+
+#define RANDOM_LANES 4
+
+namespace UTILS
+{
+    namespace RANDOM
+    {
+        static inline uint64 SplitMix64(uint64 &x) {
+            uint64 z = (x += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+
+        void Xoshiro256::setSeed(uint64 seed) {
+            for (int i = 0; i < 4; ++i) {
+                state_[i] = SplitMix64(seed);
+            }
+        }
+
+        void Xoshiro256::applyJump(const uint64 *polynomial) {
+            uint64 s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+            for (int i = 0; i < 4; ++i) {
+                for (int b = 0; b < 64; ++b) {
+                    if (polynomial[i] & (1ULL << b)) {
+                        s0 ^= state_[0];
+                        s1 ^= state_[1];
+                        s2 ^= state_[2];
+                        s3 ^= state_[3];
+                    }
+                    next();
+                }
+            }
+            state_[0] = s0;
+            state_[1] = s1;
+            state_[2] = s2;
+            state_[3] = s3;
+        }
+
+        void Xoshiro256::jump() {
+            static const uint64 JUMP[] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+            applyJump(JUMP);
+        }
+
+        void Xoshiro256::longJump() {
+            static const uint64 LONG_JUMP[] = { 0x76E15D3EFEFDCBBFULL, 0xC5004E441C522FB3ULL, 0x77710069854EE241ULL, 0x39109BB02ACBE635ULL };
+            applyJump(LONG_JUMP);
+        }
+
+        // Bulk fills run RANDOM_LANES xoshiro256** generators side by side, seeded from this
+        // generator. Each call advances this generator by RANDOM_LANES steps.
+        struct RandomLanes
+        {
+            uint64 state[4][RANDOM_LANES];
+
+            explicit RandomLanes(Xoshiro256 &source) {
+                for (int lane = 0; lane < RANDOM_LANES; ++lane) {
+                    uint64 seed = source.next();
+                    for (int word = 0; word < 4; ++word) {
+                        state[word][lane] = SplitMix64(seed);
+                    }
+                }
+            }
+
+            // Portable path, written lane-wise so compilers can vectorize it.
+            inline void next(uint64 out[RANDOM_LANES]) {
+                for (int lane = 0; lane < RANDOM_LANES; ++lane) {
+                    uint64 s1 = state[1][lane] * 5;
+                    uint64 r = (s1 << 7) | (s1 >> 57);
+                    out[lane] = r * 9;
+
+                    uint64 t = state[1][lane] << 17;
+                    state[2][lane] ^= state[0][lane];
+                    state[3][lane] ^= state[1][lane];
+                    state[1][lane] ^= state[2][lane];
+                    state[0][lane] ^= state[3][lane];
+                    state[2][lane] ^= t;
+                    state[3][lane] = (state[3][lane] << 45) | (state[3][lane] >> 19);
+                }
+            }
+        };
+
+        #if defined(RANDOM_SSE2)
+
+        // Two 64-bit lanes per register, multiplications by 5 and 9 done as shift and add.
+        struct SSE2Lanes
+        {
+            __m128i state[4];
+
+            inline __m128i next() {
+                __m128i s1x5 = _mm_add_epi64(_mm_slli_epi64(state[1], 2), state[1]);
+                __m128i rotated = _mm_or_si128(_mm_slli_epi64(s1x5, 7), _mm_srli_epi64(s1x5, 57));
+                __m128i result = _mm_add_epi64(_mm_slli_epi64(rotated, 3), rotated);
+
+                __m128i t = _mm_slli_epi64(state[1], 17);
+                state[2] = _mm_xor_si128(state[2], state[0]);
+                state[3] = _mm_xor_si128(state[3], state[1]);
+                state[1] = _mm_xor_si128(state[1], state[2]);
+                state[0] = _mm_xor_si128(state[0], state[3]);
+                state[2] = _mm_xor_si128(state[2], t);
+                state[3] = _mm_or_si128(_mm_slli_epi64(state[3], 45), _mm_srli_epi64(state[3], 19));
+                return result;
+            }
+        };
+
+        static inline void LoadLanes(const RandomLanes &lanes, SSE2Lanes &low, SSE2Lanes &high) {
+            for (int word = 0; word < 4; ++word) {
+                low.state[word] = _mm_loadu_si128((const __m128i *)&lanes.state[word][0]);
+                high.state[word] = _mm_loadu_si128((const __m128i *)&lanes.state[word][2]);
+            }
+        }
+
+        static inline void StoreLanes(RandomLanes &lanes, const SSE2Lanes &low, const SSE2Lanes &high) {
+            for (int word = 0; word < 4; ++word) {
+                _mm_storeu_si128((__m128i *)&lanes.state[word][0], low.state[word]);
+                _mm_storeu_si128((__m128i *)&lanes.state[word][2], high.state[word]);
+            }
+        }
+
+        // Gathers the low 32 bits of the four 64-bit lanes into one register.
+        static inline __m128i PackLow32(__m128i low, __m128i high) {
+            low = _mm_shuffle_epi32(low, _MM_SHUFFLE(3, 1, 2, 0));
+            high = _mm_shuffle_epi32(high, _MM_SHUFFLE(3, 1, 2, 0));
+            return _mm_unpacklo_epi64(low, high);
+        }
+
+        #endif
+
+        void Xoshiro256::fillUint32(uint32 *out, uint64 count) {
+            RandomLanes lanes(*this);
+            uint64 index = 0;
+
+        #if defined(RANDOM_SSE2)
+            SSE2Lanes low, high;
+            LoadLanes(lanes, low, high);
+            for (; index + RANDOM_LANES <= count; index += RANDOM_LANES) {
+                __m128i a = _mm_srli_epi64(low.next(), 32);
+                __m128i b = _mm_srli_epi64(high.next(), 32);
+                _mm_storeu_si128((__m128i *)(out + index), PackLow32(a, b));
+            }
+            StoreLanes(lanes, low, high);
+        #endif
+
+            uint64 block[RANDOM_LANES];
+            for (; index < count; index += RANDOM_LANES) {
+                lanes.next(block);
+                for (int lane = 0; lane < RANDOM_LANES && index + lane < count; ++lane) {
+                    out[index + lane] = (uint32)(block[lane] >> 32);
+                }
+            }
+        }
+
+        void Xoshiro256::fillFloat(float *out, uint64 count, float min, float max) {
+            RandomLanes lanes(*this);
+            const float scale = (max - min) * (1.0f / 16777216.0f);
+            uint64 index = 0;
+
+        #if defined(RANDOM_SSE2)
+            SSE2Lanes low, high;
+            LoadLanes(lanes, low, high);
+            const __m128 scale4 = _mm_set1_ps(scale);
+            const __m128 min4 = _mm_set1_ps(min);
+            for (; index + RANDOM_LANES <= count; index += RANDOM_LANES) {
+                __m128i a = _mm_srli_epi64(low.next(), 40);
+                __m128i b = _mm_srli_epi64(high.next(), 40);
+                __m128 values = _mm_cvtepi32_ps(PackLow32(a, b));
+                _mm_storeu_ps(out + index, _mm_add_ps(_mm_mul_ps(values, scale4), min4));
+            }
+            StoreLanes(lanes, low, high);
+        #endif
+
+            uint64 block[RANDOM_LANES];
+            for (; index < count; index += RANDOM_LANES) {
+                lanes.next(block);
+                for (int lane = 0; lane < RANDOM_LANES && index + lane < count; ++lane) {
+                    out[index + lane] = min + (float)(block[lane] >> 40) * scale;
+                }
+            }
+        }
+
+        void Xoshiro256::fillNormal(float *out, uint64 count, float mean, float stddev) {
+            // Box-Muller on top of the vectorized uniform fill.
+            const float TWO_PI = 6.28318530717958647692f;
+
+            fillFloat(out, count, 0.0f, 1.0f);
+
+            uint64 pairs = count / 2;
+            for (uint64 i = 0; i < pairs; ++i) {
+                float u1 = 1.0f - out[2 * i];
+                float u2 = out[2 * i + 1];
+                float radius = stddev * sqrtf(-2.0f * logf(u1));
+                float theta = TWO_PI * u2;
+                out[2 * i] = mean + radius * cosf(theta);
+                out[2 * i + 1] = mean + radius * sinf(theta);
+            }
+
+            if (count & 1) {
+                float u1 = 1.0f - out[count - 1];
+                float u2 = randFloat();
+                out[count - 1] = mean + stddev * sqrtf(-2.0f * logf(u1)) * cosf(TWO_PI * u2);
+            }
+        }
+
+        struct StreamSource
+        {
+            StreamSource()
+                : generation(1) {
+            }
+
+            std::mutex mutex;
+            Xoshiro256 generator;
+            std::atomic<uint32> generation;
+        };
+
+        static StreamSource &GetStreamSource() {
+            static StreamSource source;
+            return source;
+        }
+
+        struct ThreadStream
+        {
+            ThreadStream()
+                : generation(0) {
+            }
+
+            Xoshiro256 generator;
+            uint32 generation;
+        };
+
+        static thread_local ThreadStream threadStream;
+
+        Xoshiro256 &ThreadRandom() {
+            ThreadStream &stream = threadStream;
+            StreamSource &source = GetStreamSource();
+
+            if (stream.generation != source.generation.load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> lock(source.mutex);
+                stream.generator = source.generator;
+                stream.generation = source.generation.load(std::memory_order_relaxed);
+                source.generator.jump();
+            }
+
+            return stream.generator;
+        }
+
+        void SeedRandom(uint64 seed) {
+            StreamSource &source = GetStreamSource();
+            std::lock_guard<std::mutex> lock(source.mutex);
+            source.generator.setSeed(seed);
+            source.generation.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
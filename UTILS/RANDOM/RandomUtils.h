@@ -8,21 +8,80 @@ namespace UTILS
 {
     namespace RANDOM
     {
+        // xoshiro256** by Blackman and Vigna, a fast 64-bit generator with a 2^256 - 1 period.
+        // Not thread safe, give every thread its own instance or use ThreadRandom().
+        class Xoshiro256
+        {
+        public:
+            explicit Xoshiro256(uint64 seed = 0x853C49E6748FEA9BULL) {
+                setSeed(seed);
+            }
+
+            // Expands the seed with splitmix64, so nearby seeds still give unrelated streams.
+            void setSeed(uint64 seed);
+
+            inline uint64 next() {
+                const uint64 result = rotl(state_[1] * 5, 7) * 9;
+                const uint64 t = state_[1] << 17;
+
+                state_[2] ^= state_[0];
+                state_[3] ^= state_[1];
+                state_[1] ^= state_[2];
+                state_[0] ^= state_[3];
+                state_[2] ^= t;
+                state_[3] = rotl(state_[3], 45);
+
+                return result;
+            }
+
+            inline uint32 rand32() {
+                return (uint32)(next() >> 32);
+            }
+
+            // [0, 1), uses the top 24 bits so every value is exactly representable.
+            inline float randFloat() {
+                return (float)(next() >> 40) * (1.0f / 16777216.0f);
+            }
+
+            inline float randFloat(float min, float max) {
+                return min + (max - min) * randFloat();
+            }
+
+            inline double randDouble() {
+                return (double)(next() >> 11) * (1.0 / 9007199254740992.0);
+            }
+
+            // Advance by 2^128 and 2^192 calls, to split one seed into non-overlapping streams.
+            void jump();
+            void longJump();
+
+            // Bulk generation, several lanes at once with SSE2 where available.
+            void fillUint32(uint32 *out, uint64 count);
+            void fillFloat(float *out, uint64 count, float min = 0.0f, float max = 1.0f);
+            void fillNormal(float *out, uint64 count, float mean = 0.0f, float stddev = 1.0f);
+
+        private:
+            static inline uint64 rotl(uint64 x, int k) {
+                return (x << k) | (x >> (64 - k));
+            }
+
+            void applyJump(const uint64 *polynomial);
+
+            uint64 state_[4];
+        };
+
+        // Generator owned by the calling thread. Threads get consecutive jump() streams of one seed.
+        Xoshiro256 &ThreadRandom();
+        // Reseeds the streams, each thread picks up a fresh stream on its next ThreadRandom().
+        void SeedRandom(uint64 seed);
+
         inline float rand_minus1_1() {
-            // FIXME: using the new c++11 random engine generator
-            // without a proper way to set a seed is not useful.
-            // Resorting to the old random method since it can
-            // be seeded using std::srand()
-            return ((std::rand() / (float)RAND_MAX) * 2) -1;
+            return ThreadRandom().randFloat() * 2.0f - 1.0f;
         }
         #define RANDOM_MINUS1_1() rand_minus1_1()
 
         inline float rand_0_1() {
-            // FIXME: using the new c++11 random engine generator
-            // without a proper way to set a seed is not useful.
-            // Resorting to the old random method since it can
-            // be seeded using std::srand()
-            return std::rand() / (float)RAND_MAX;
+            return ThreadRandom().randFloat();
         }
         #define RANDOM_0_1() rand_0_1()
 
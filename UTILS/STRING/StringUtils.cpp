@@ -9,6 +9,7 @@
 #include <string.h>
 #include <sstream>
 #include <limits.h>
+#include <math.h>
 
 #include <algorithm>
 #include <iomanip>
@@ -102,80 +103,224 @@ namespace UTILS
             buffer.read(buffer.size(), (HBYTE *)&(*output)[0]);
         }
 
-        MATH::Rectf RectFromString(const std::string& str)
+        bool ParseInt(const StringView& str, int64 &value) {
+            StringView number = str.trim();
+            uint64 index = 0;
+            bool negative = false;
+
+            if (index < number.size() && (number[index] == '-' || number[index] == '+')) {
+                negative = number[index] == '-';
+                ++index;
+            }
+            if (index == number.size())
+                return false;
+
+            uint64 result = 0;
+            for (; index < number.size(); ++index) {
+                uint32 digit = (uint32)(number[index] - '0');
+                if (digit > 9)
+                    return false;
+                if (result > (UINT64_MAX - digit) / 10)
+                    return false;
+                result = result * 10 + digit;
+            }
+
+            if (result > (uint64)INT64_MAX + (negative ? 1 : 0))
+                return false;
+
+            value = negative ? (int64)(0 - result) : (int64)result;
+            return true;
+        }
+
+        bool ParseDouble(const StringView& str, double &value) {
+            // Exactly representable powers of ten, see Clinger's fast path.
+            static const double powersOfTen[] = {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+            };
+
+            StringView number = str.trim();
+            uint64 index = 0;
+            bool negative = false;
+
+            if (index < number.size() && (number[index] == '-' || number[index] == '+')) {
+                negative = number[index] == '-';
+                ++index;
+            }
+
+            uint64 mantissa = 0;
+            int significant = 0;
+            int exponent = 0;
+            bool anyDigits = false;
+
+            for (; index < number.size() && number[index] >= '0' && number[index] <= '9'; ++index) {
+                anyDigits = true;
+                if (significant < 19) {
+                    mantissa = mantissa * 10 + (number[index] - '0');
+                    if (mantissa != 0)
+                        ++significant;
+                }
+                else {
+                    ++exponent;
+                }
+            }
+
+            if (index < number.size() && number[index] == '.') {
+                for (++index; index < number.size() && number[index] >= '0' && number[index] <= '9'; ++index) {
+                    anyDigits = true;
+                    if (significant < 19) {
+                        mantissa = mantissa * 10 + (number[index] - '0');
+                        if (mantissa != 0)
+                            ++significant;
+                        --exponent;
+                    }
+                }
+            }
+
+            if (!anyDigits)
+                return false;
+
+            if (index < number.size() && (number[index] == 'e' || number[index] == 'E')) {
+                ++index;
+                bool negativeExponent = false;
+                if (index < number.size() && (number[index] == '-' || number[index] == '+')) {
+                    negativeExponent = number[index] == '-';
+                    ++index;
+                }
+                if (index == number.size())
+                    return false;
+
+                int explicitExponent = 0;
+                for (; index < number.size() && number[index] >= '0' && number[index] <= '9'; ++index) {
+                    if (explicitExponent < 100000)
+                        explicitExponent = explicitExponent * 10 + (number[index] - '0');
+                }
+                exponent += negativeExponent ? -explicitExponent : explicitExponent;
+            }
+
+            if (index != number.size())
+                return false;
+
+            double result = (double)mantissa;
+            if (mantissa == 0) {
+                result = 0.0;
+            }
+            else if (exponent >= 0 && exponent <= 22) {
+                result *= powersOfTen[exponent];
+            }
+            else if (exponent < 0 && exponent >= -22) {
+                result /= powersOfTen[-exponent];
+            }
+            else {
+                result *= pow(10.0, exponent);
+            }
+
+            value = negative ? -result : result;
+            return true;
+        }
+
+        bool ParseFloat(const StringView& str, float &value) {
+            double result;
+            if (!ParseDouble(str, result))
+                return false;
+            value = (float)result;
+            return true;
+        }
+
+        // Returns what is between the first '{' and the first '}', which must not hold more braces.
+        static StringView ContentWithForm(const StringView& content) {
+            uint64 nPosLeft = content.find('{');
+            uint64 nPosRight = content.find('}');
+
+            // don't have '{' and '}'
+            if (nPosLeft == StringView::npos || nPosRight == StringView::npos)
+                throw _HException_Normal("Unknow string format!");
+            // '}' is before '{'
+            if (nPosLeft > nPosRight)
+                throw _HException_Normal("Unknow string format!");
+
+            const StringView pointStr = content.substr(nPosLeft + 1, nPosRight - nPosLeft - 1);
+
+            // contain '{' or '}'
+            if (pointStr.find('{') != StringView::npos)
+                throw _HException_Normal("Unknow string format!");
+
+            return pointStr;
+        }
+
+        // Parses "{a,b}" straight into two floats.
+        static void PairFromString(const StringView& content, float &first, float &second) {
+            const StringView pointStr = ContentWithForm(content);
+            uint64 comma = pointStr.find(',');
+            if (comma == StringView::npos || pointStr.find(',', comma + 1) != StringView::npos)
+                throw _HException_Normal("Unknow string format!");
+
+            const StringView firstStr = pointStr.substr(0, comma);
+            const StringView secondStr = pointStr.substr(comma + 1);
+            if (firstStr.empty() || secondStr.empty())
+                throw _HException_Normal("Unknow string format!");
+
+            if (!ParseFloat(firstStr, first) || !ParseFloat(secondStr, second))
+                throw _HException_Normal("Unknow number format!");
+        }
+
+        MATH::Rectf RectFromString(const StringView& str)
         {
             MATH::Rectf result = MATH::RectfZERO;
 
             if (str.empty()) return result;
-            std::string content = str;
 
             // find the first '{' and the third '}'
-            uint64 nPosLeft = content.find('{');
-            uint64 nPosRight = content.find('}');
+            uint64 nPosLeft = str.find('{');
+            uint64 nPosRight = str.find('}');
             for (int i = 1; i < 3; ++i)
             {
-                if (nPosRight == std::string::npos)
+                if (nPosRight == StringView::npos)
                 {
                     break;
                 }
-                nPosRight = content.find('}', nPosRight + 1);
+                nPosRight = str.find('}', nPosRight + 1);
             }
-            if (nPosLeft == std::string::npos || nPosRight == std::string::npos)
+            if (nPosLeft == StringView::npos || nPosRight == StringView::npos)
                 throw _HException_Normal("Unknow rect string format!");
 
-            content = content.substr(nPosLeft + 1, nPosRight - nPosLeft - 1);
+            const StringView content = str.substr(nPosLeft + 1, nPosRight - nPosLeft - 1);
             uint64 nPointEnd = content.find('}');
-            if (nPointEnd == std::string::npos)
+            if (nPointEnd == StringView::npos)
                 throw _HException_Normal("Unknow rect string format!");
             nPointEnd = content.find(',', nPointEnd);
-            if (nPointEnd == std::string::npos)
+            if (nPointEnd == StringView::npos)
                 throw _HException_Normal("Unknow rect string format!");
 
             // get the point string and size string
-            const std::string pointStr = content.substr(0, nPointEnd);
-            const std::string sizeStr = content.substr(nPointEnd + 1, content.length() - nPointEnd);
-
-            // split the string with ','
-            std::vector<std::string> pointInfo;
-            SplitWithForm(pointStr, pointInfo);
-            std::vector<std::string> sizeInfo;
-            SplitWithForm(sizeStr.c_str(), sizeInfo);
-
-            float x = (float) atof(pointInfo[0].c_str());
-            float y = (float) atof(pointInfo[1].c_str());
-            float width = (float) atof(sizeInfo[0].c_str());
-            float height = (float) atof(sizeInfo[1].c_str());
+            float x, y, width, height;
+            PairFromString(content.substr(0, nPointEnd), x, y);
+            PairFromString(content.substr(nPointEnd + 1), width, height);
 
             result = MATH::Rectf(x, y, width, height);
             return result;
         }
 
-        MATH::Vector2f PointFromString(const std::string& str)
+        MATH::Vector2f PointFromString(const StringView& str)
         {
             MATH::Vector2f ret = MATH::Vec2fZERO;
 
             if (str.empty()) return ret;
 
-            std::vector<std::string> strs;
-            SplitWithForm(str, strs);
-
-            float x = (float) atof(strs[0].c_str());
-            float y = (float) atof(strs[1].c_str());
+            float x, y;
+            PairFromString(str, x, y);
 
             ret.set(x, y);
             return ret;
         }
 
-        MATH::Sizef SizeFromString(const std::string& pszContent)
+        MATH::Sizef SizeFromString(const StringView& pszContent)
         {
             MATH::Sizef ret = MATH::SizefZERO;
             if (pszContent.empty()) return ret;
 
-            std::vector<std::string> strs;
-            SplitWithForm(pszContent, strs);
-
-            float width = (float) atof(strs[0].c_str());
-            float height = (float) atof(strs[1].c_str());
+            float width, height;
+            PairFromString(pszContent, width, height);
 
             ret = MATH::Sizef(width, height);
             return ret;
@@ -223,43 +368,41 @@ namespace UTILS
         }
 
         void SplitString(const std::string& src, const std::string& token, std::vector<std::string>& output) {
-            uint64 nend = 0;
-            uint64 nbegin = 0;
-            uint64 tokenSize = token.size();
-            while (nend != std::string::npos)
-            {
-                nend = src.find(token, nbegin);
-                if (nend == std::string::npos)
-                    output.push_back(src.substr(nbegin, src.length() - nbegin));
-                else
-                    output.push_back(src.substr(nbegin, nend - nbegin));
-                nbegin = nend + tokenSize;
+            StringTokenizer tokenizer(src, token);
+            StringView piece;
+            while (tokenizer.next(piece)) {
+                output.push_back(piece.toString());
+            }
+        }
+
+        void SplitString(const StringView& str, const StringView& token, std::vector<StringView>& output) {
+            output.clear();
+
+            StringTokenizer tokenizer(str, token);
+            StringView piece;
+            while (tokenizer.next(piece)) {
+                output.push_back(piece);
             }
         }
 
         void SplitWithForm(const std::string& content, std::vector<std::string>& output) {
             if (content.empty()) return;
 
-            uint64 nPosLeft = content.find('{');
-            uint64 nPosRight = content.find('}');
+            std::vector<StringView> pieces;
+            SplitWithForm(StringView(content), pieces);
+            for (const auto &piece : pieces) {
+                output.push_back(piece.toString());
+            }
+        }
 
-            // don't have '{' and '}'
-            if (nPosLeft == std::string::npos || nPosRight == std::string::npos)
-                throw _HException_Normal("Unknow string format!");
-            // '}' is before '{'
-            if (nPosLeft > nPosRight) 
-                throw _HException_Normal("Unknow string format!");
+        void SplitWithForm(const StringView& content, std::vector<StringView>& output) {
+            output.clear();
+            if (content.empty()) return;
 
-            const std::string pointStr = content.substr(nPosLeft + 1, nPosRight - nPosLeft - 1);
+            const StringView pointStr = ContentWithForm(content);
             // nothing between '{' and '}'
             if (pointStr.length() == 0) return;
 
-            uint64 nPos1 = pointStr.find('{');
-            uint64 nPos2 = pointStr.find('}');
-            // contain '{' or '}' 
-            if (nPos1 != std::string::npos || nPos2 != std::string::npos)
-                throw _HException_Normal("Unknow string format!");
-
             SplitString(pointStr, ",", output);
             if (output.size() != 2 || output[0].length() == 0 || output[1].length() == 0) {
                 throw _HException_Normal("Unknow string format!");
@@ -9,6 +9,7 @@
 #include "BASE/Honey.h"
 #include "MATH/Rectangle.h"
 #include "MATH/Vector2.h"
+#include "UTILS/STRING/StringView.h"
 
 namespace UTILS
 {
@@ -26,9 +27,15 @@ namespace UTILS
         unsigned int ParseHexString(const char* _szValue);
         bool ParseBoolean(const std::string& value);
 
-        MATH::Rectf RectFromString(const std::string& str);
-        MATH::Vector2f PointFromString(const std::string& str);
-        MATH::Sizef SizeFromString(const std::string& pszContent);
+        // Locale independent number parsing that never allocates, surrounding whitespace is allowed.
+        // Return false if the whole string is not a number.
+        bool ParseInt(const StringView& str, int64 &value);
+        bool ParseDouble(const StringView& str, double &value);
+        bool ParseFloat(const StringView& str, float &value);
+
+        MATH::Rectf RectFromString(const StringView& str);
+        MATH::Vector2f PointFromString(const StringView& str);
+        MATH::Sizef SizeFromString(const StringView& pszContent);
 
         std::string StringFromFormat(const char* format, ...);
         std::string StringFromInt(int value);
@@ -36,6 +43,9 @@ namespace UTILS
 
         void SplitString(const std::string& str, const std::string& token, std::vector<std::string>& output);
         void SplitWithForm(const std::string& content, std::vector<std::string>& output);
+        // The pieces point into str, reuse output across calls to avoid allocating.
+        void SplitString(const StringView& str, const StringView& token, std::vector<StringView>& output);
+        void SplitWithForm(const StringView& content, std::vector<StringView>& output);
     }
 }
 
@@ -0,0 +1,158 @@
+#ifndef STRINGVIEW_H
+#define STRINGVIEW_H
+
+#include <string>
+#include <string.h>
+
+#include "BASE/Honey.h"
+
+namespace UTILS
+{
+    namespace STRING
+    {
+        // Non owning view of a character range, std::string_view for our C++11 builds.
+        // The viewed characters must outlive the view.
+        class StringView final
+        {
+        public:
+            static const uint64 npos = (uint64)-1;
+
+            StringView()
+                : data_(nullptr)
+                , size_(0) {
+            }
+
+            StringView(const char *str)
+                : data_(str)
+                , size_(str ? strlen(str) : 0) {
+            }
+
+            StringView(const char *str, uint64 size)
+                : data_(str)
+                , size_(size) {
+            }
+
+            StringView(const std::string &str)
+                : data_(str.data())
+                , size_(str.size()) {
+            }
+
+            inline const char *data() const { return data_; }
+            inline uint64 size() const { return size_; }
+            inline uint64 length() const { return size_; }
+            inline bool empty() const { return size_ == 0; }
+
+            inline const char *begin() const { return data_; }
+            inline const char *end() const { return data_ + size_; }
+
+            inline char operator[](uint64 index) const { return data_[index]; }
+            inline char front() const { return data_[0]; }
+            inline char back() const { return data_[size_ - 1]; }
+
+            StringView substr(uint64 pos, uint64 count = npos) const {
+                if (pos > size_)
+                    pos = size_;
+                if (count > size_ - pos)
+                    count = size_ - pos;
+                return StringView(data_ + pos, count);
+            }
+
+            uint64 find(char ch, uint64 pos = 0) const {
+                if (pos >= size_)
+                    return npos;
+                const void *found = memchr(data_ + pos, ch, size_ - pos);
+                return found ? (const char *)found - data_ : npos;
+            }
+
+            uint64 find(const StringView &what, uint64 pos = 0) const {
+                if (what.size_ == 0)
+                    return pos <= size_ ? pos : npos;
+                while (pos + what.size_ <= size_) {
+                    pos = find(what.data_[0], pos);
+                    if (pos == npos || pos + what.size_ > size_)
+                        return npos;
+                    if (memcmp(data_ + pos, what.data_, what.size_) == 0)
+                        return pos;
+                    ++pos;
+                }
+                return npos;
+            }
+
+            bool startsWith(const StringView &what) const {
+                return size_ >= what.size_ && memcmp(data_, what.data_, what.size_) == 0;
+            }
+
+            bool endsWith(const StringView &what) const {
+                return size_ >= what.size_ && memcmp(data_ + size_ - what.size_, what.data_, what.size_) == 0;
+            }
+
+            // Drops leading and trailing ASCII whitespace.
+            StringView trim() const {
+                uint64 first = 0;
+                uint64 last = size_;
+                while (first < last && isSpace(data_[first]))
+                    ++first;
+                while (last > first && isSpace(data_[last - 1]))
+                    --last;
+                return StringView(data_ + first, last - first);
+            }
+
+            std::string toString() const {
+                return std::string(data_, size_);
+            }
+
+            bool operator==(const StringView &other) const {
+                return size_ == other.size_ && (size_ == 0 || memcmp(data_, other.data_, size_) == 0);
+            }
+
+            bool operator!=(const StringView &other) const {
+                return !(*this == other);
+            }
+
+        private:
+            static inline bool isSpace(char ch) {
+                return ch == ' ' || (ch >= '\t' && ch <= '\r');
+            }
+
+            const char *data_;
+            uint64 size_;
+        };
+
+        // Walks the pieces of a string separated by token without copying them.
+        // Yields the same pieces as SplitString, including empty ones.
+        class StringTokenizer final
+        {
+        public:
+            StringTokenizer(const StringView &str, const StringView &token)
+                : str_(str)
+                , token_(token)
+                , position_(0)
+                , finished_(false) {
+            }
+
+            bool next(StringView &piece) {
+                if (finished_)
+                    return false;
+
+                uint64 end = token_.empty() ? StringView::npos : str_.find(token_, position_);
+                if (end == StringView::npos) {
+                    piece = str_.substr(position_);
+                    finished_ = true;
+                }
+                else {
+                    piece = str_.substr(position_, end - position_);
+                    position_ = end + token_.size();
+                }
+                return true;
+            }
+
+        private:
+            StringView str_;
+            StringView token_;
+            uint64 position_;
+            bool finished_;
+        };
+    }
+}
+
+#endif // STRINGVIEW_H
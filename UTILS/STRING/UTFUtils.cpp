@@ -5,8 +5,17 @@
 #include <locale>
 #include <cassert>
 #include <vector>
+#include <algorithm>
 using namespace std;
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UTF_SSE2 1
+#elif defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define UTF_NEON 1
+#endif
+
 #include "ConvertUTF.h"
 #include "BASE/Honey.h"
 
@@ -558,25 +567,262 @@ namespace UTILS
             }
         };
 
+        // Converts whole 16 byte blocks of ASCII, stops at the first block holding a non ASCII byte.
+        static inline uint64 WidenASCIIBlocks(const uint8 *src, uint64 length, char16_t *dst) {
+            uint64 index = 0;
+        #if defined(UTF_SSE2)
+            const __m128i zero = _mm_setzero_si128();
+            for (; index + 16 <= length; index += 16) {
+                __m128i bytes = _mm_loadu_si128((const __m128i *)(src + index));
+                if (_mm_movemask_epi8(bytes) != 0)
+                    break;
+                _mm_storeu_si128((__m128i *)(dst + index), _mm_unpacklo_epi8(bytes, zero));
+                _mm_storeu_si128((__m128i *)(dst + index + 8), _mm_unpackhi_epi8(bytes, zero));
+            }
+        #elif defined(UTF_NEON)
+            for (; index + 16 <= length; index += 16) {
+                uint8x16_t bytes = vld1q_u8(src + index);
+                if (vmaxvq_u8(bytes) >= 0x80)
+                    break;
+                vst1q_u16((uint16_t *)(dst + index), vmovl_u8(vget_low_u8(bytes)));
+                vst1q_u16((uint16_t *)(dst + index + 8), vmovl_u8(vget_high_u8(bytes)));
+            }
+        #else
+            for (; index + 8 <= length; index += 8) {
+                uint64 word;
+                memcpy(&word, src + index, sizeof(word));
+                if (word & 0x8080808080808080ULL)
+                    break;
+                for (int i = 0; i < 8; ++i) {
+                    dst[index + i] = src[index + i];
+                }
+            }
+        #endif
+            return index;
+        }
+
+        // Same as above for the other direction, 16 code units at a time.
+        static inline uint64 NarrowASCIIBlocks(const char16_t *src, uint64 length, uint8 *dst) {
+            uint64 index = 0;
+        #if defined(UTF_SSE2)
+            const __m128i highBits = _mm_set1_epi16((short)0xFF80);
+            const __m128i zero = _mm_setzero_si128();
+            for (; index + 16 <= length; index += 16) {
+                __m128i low = _mm_loadu_si128((const __m128i *)(src + index));
+                __m128i high = _mm_loadu_si128((const __m128i *)(src + index + 8));
+                __m128i test = _mm_and_si128(_mm_or_si128(low, high), highBits);
+                if (_mm_movemask_epi8(_mm_cmpeq_epi16(test, zero)) != 0xFFFF)
+                    break;
+                _mm_storeu_si128((__m128i *)(dst + index), _mm_packus_epi16(low, high));
+            }
+        #elif defined(UTF_NEON)
+            for (; index + 16 <= length; index += 16) {
+                uint16x8_t low = vld1q_u16((const uint16_t *)(src + index));
+                uint16x8_t high = vld1q_u16((const uint16_t *)(src + index + 8));
+                if (vmaxvq_u16(vorrq_u16(low, high)) >= 0x80)
+                    break;
+                vst1q_u8(dst + index, vcombine_u8(vmovn_u16(low), vmovn_u16(high)));
+            }
+        #else
+            for (; index + 4 <= length; index += 4) {
+                uint64 word;
+                memcpy(&word, src + index, sizeof(word));
+                if (word & 0xFF80FF80FF80FF80ULL)
+                    break;
+                for (int i = 0; i < 4; ++i) {
+                    dst[index + i] = (uint8)src[index + i];
+                }
+            }
+        #endif
+            return index;
+        }
+
+        // Decodes one well formed UTF-8 sequence (Unicode table 3-7) starting at src[index].
+        // Returns the sequence length, or 0 if it is malformed or truncated.
+        static inline int DecodeUTF8(const uint8 *src, uint64 index, uint64 length, uint32 &codePoint) {
+            uint8 lead = src[index];
+            uint64 remaining = length - index;
+
+            if (lead < 0x80) {
+                codePoint = lead;
+                return 1;
+            }
+            if (lead < 0xC2) {
+                return 0;
+            }
+            if (lead < 0xE0) {
+                if (remaining < 2 || (src[index + 1] & 0xC0) != 0x80)
+                    return 0;
+                codePoint = ((lead & 0x1F) << 6) | (src[index + 1] & 0x3F);
+                return 2;
+            }
+            if (lead < 0xF0) {
+                if (remaining < 3)
+                    return 0;
+                uint8 second = src[index + 1];
+                uint8 lower = lead == 0xE0 ? 0xA0 : 0x80;
+                uint8 upper = lead == 0xED ? 0x9F : 0xBF;
+                if (second < lower || second > upper || (src[index + 2] & 0xC0) != 0x80)
+                    return 0;
+                codePoint = ((lead & 0x0F) << 12) | ((second & 0x3F) << 6) | (src[index + 2] & 0x3F);
+                return 3;
+            }
+            if (lead < 0xF5) {
+                if (remaining < 4)
+                    return 0;
+                uint8 second = src[index + 1];
+                uint8 lower = lead == 0xF0 ? 0x90 : 0x80;
+                uint8 upper = lead == 0xF4 ? 0x8F : 0xBF;
+                if (second < lower || second > upper
+                    || (src[index + 2] & 0xC0) != 0x80 || (src[index + 3] & 0xC0) != 0x80)
+                    return 0;
+                codePoint = ((lead & 0x07) << 18) | ((second & 0x3F) << 12)
+                          | ((src[index + 2] & 0x3F) << 6) | (src[index + 3] & 0x3F);
+                return 4;
+            }
+            return 0;
+        }
+
+        int64 UTF8ToUTF16(const char *utf8, uint64 length, char16_t *outUtf16, uint64 capacity) {
+            const uint8 *src = reinterpret_cast<const uint8 *>(utf8);
+            uint64 index = 0;
+            uint64 written = 0;
+
+            while (index < length) {
+                if (src[index] < 0x80) {
+                    uint64 block = std::min(length - index, capacity - written);
+                    uint64 converted = WidenASCIIBlocks(src + index, block, outUtf16 + written);
+                    index += converted;
+                    written += converted;
+                    if (index == length)
+                        break;
+                    if (converted != 0)
+                        continue;
+                }
+
+                uint32 codePoint;
+                int sequence = DecodeUTF8(src, index, length, codePoint);
+                if (sequence == 0)
+                    return -1;
+                index += sequence;
+
+                if (codePoint < 0x10000) {
+                    if (written >= capacity)
+                        return -1;
+                    outUtf16[written++] = (char16_t)codePoint;
+                }
+                else {
+                    if (written + 2 > capacity)
+                        return -1;
+                    codePoint -= 0x10000;
+                    outUtf16[written++] = (char16_t)(0xD800 + (codePoint >> 10));
+                    outUtf16[written++] = (char16_t)(0xDC00 + (codePoint & 0x3FF));
+                }
+            }
+
+            return written;
+        }
+
+        int64 UTF16ToUTF8(const char16_t *utf16, uint64 length, char *outUtf8, uint64 capacity) {
+            uint8 *dst = reinterpret_cast<uint8 *>(outUtf8);
+            uint64 index = 0;
+            uint64 written = 0;
+
+            while (index < length) {
+                uint32 unit = utf16[index];
+
+                if (unit < 0x80) {
+                    uint64 block = std::min(length - index, capacity - written);
+                    uint64 converted = NarrowASCIIBlocks(utf16 + index, block, dst + written);
+                    index += converted;
+                    written += converted;
+                    if (converted != 0)
+                        continue;
+
+                    if (written >= capacity)
+                        return -1;
+                    dst[written++] = (uint8)unit;
+                    ++index;
+                }
+                else if (unit < 0x800) {
+                    if (written + 2 > capacity)
+                        return -1;
+                    dst[written++] = (uint8)(0xC0 | (unit >> 6));
+                    dst[written++] = (uint8)(0x80 | (unit & 0x3F));
+                    ++index;
+                }
+                else if (unit < 0xD800 || unit > 0xDFFF) {
+                    if (written + 3 > capacity)
+                        return -1;
+                    dst[written++] = (uint8)(0xE0 | (unit >> 12));
+                    dst[written++] = (uint8)(0x80 | ((unit >> 6) & 0x3F));
+                    dst[written++] = (uint8)(0x80 | (unit & 0x3F));
+                    ++index;
+                }
+                else {
+                    // Surrogates must come as a high/low pair.
+                    if (unit > 0xDBFF || index + 1 >= length)
+                        return -1;
+                    uint32 low = utf16[index + 1];
+                    if (low < 0xDC00 || low > 0xDFFF)
+                        return -1;
+                    if (written + 4 > capacity)
+                        return -1;
+                    uint32 codePoint = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                    dst[written++] = (uint8)(0xF0 | (codePoint >> 18));
+                    dst[written++] = (uint8)(0x80 | ((codePoint >> 12) & 0x3F));
+                    dst[written++] = (uint8)(0x80 | ((codePoint >> 6) & 0x3F));
+                    dst[written++] = (uint8)(0x80 | (codePoint & 0x3F));
+                    index += 2;
+                }
+            }
+
+            return written;
+        }
+
+        bool IsValidUTF8(const char *utf8, uint64 length) {
+            const uint8 *src = reinterpret_cast<const uint8 *>(utf8);
+            uint64 index = 0;
+
+            while (index < length) {
+                if (src[index] < 0x80) {
+        #if defined(UTF_SSE2)
+                    while (index + 16 <= length
+                           && _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(src + index))) == 0) {
+                        index += 16;
+                    }
+        #endif
+                    while (index < length && src[index] < 0x80) {
+                        ++index;
+                    }
+                    continue;
+                }
+
+                uint32 codePoint;
+                int sequence = DecodeUTF8(src, index, length, codePoint);
+                if (sequence == 0)
+                    return false;
+                index += sequence;
+            }
+
+            return true;
+        }
+
         void UTF8ToUTF16(const std::string &utf8, std::u16string &outUtf16) {
             if (utf8.empty()) {
                 outUtf16.clear();
                 return;
             }
 
-            const uint64 utf16Bytes = (utf8.length()+1) * sizeof(char16_t);
-            char16_t* utf16 = (char16_t*)malloc(utf16Bytes);
-            memset(utf16, 0, utf16Bytes);
-
-            char* utf16ptr = reinterpret_cast<char*>(utf16);
-            const UTF8* error = nullptr;
-
-            if (!ConvertUTF8toWide(2, utf8, utf16ptr, error)) {
+            // Size to the upper bound, keeps the capacity of a reused string.
+            outUtf16.resize(utf8.length());
+            int64 length = UTF8ToUTF16(utf8.data(), utf8.length(), &outUtf16[0], outUtf16.size());
+            if (length < 0) {
+                outUtf16.clear();
                 throw _HException_Normal("ConvertUTF8toWide Error!");
             }
 
-            outUtf16 = utf16;
-            free(utf16);
+            outUtf16.resize(length);
         }
 
         void UTF8ToUTF32(const std::string &utf8, std::u32string &outUtf32) {
@@ -636,9 +882,25 @@ namespace UTILS
                 return;
             }
 
-            if (!convertUTF16ToUTF8String(utf16, outUtf8)) {
+            // Byte swapped input keeps going through the generic converter.
+            if (utf16[0] == UNI_UTF16_BYTE_ORDER_MARK_SWAPPED) {
+                outUtf8.clear();
+                if (!convertUTF16ToUTF8String(utf16, outUtf8)) {
+                    throw _HException_Normal("convertUTF16ToUTF8String Error!");
+                }
+                return;
+            }
+
+            uint64 offset = utf16[0] == UNI_UTF16_BYTE_ORDER_MARK_NATIVE ? 1 : 0;
+            uint64 length = utf16.length() - offset;
+            outUtf8.resize(length * 3 + 1);
+            int64 written = UTF16ToUTF8(utf16.data() + offset, length, &outUtf8[0], outUtf8.size());
+            if (written < 0) {
+                outUtf8.clear();
                 throw _HException_Normal("convertUTF16ToUTF8String Error!");
             }
+
+            outUtf8.resize(written);
         }
 
 #ifdef _WIN32
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 
+#include "BASE/Honey.h"
+
 namespace UTILS
 {
     namespace STRING
@@ -16,6 +18,14 @@ namespace UTILS
 
         void UTF16ToUTF8(const std::u16string& utf16, std::string &outUtf8);
 
+        // Allocation free conversions into a caller owned buffer, with an ASCII fast path.
+        // Return the number of code units written, or -1 if the input is malformed or the buffer is too small.
+        // utf8 length code units of UTF-16 and 3 * utf16 length bytes of UTF-8 are always enough.
+        int64 UTF8ToUTF16(const char *utf8, uint64 length, char16_t *outUtf16, uint64 capacity);
+        int64 UTF16ToUTF8(const char16_t *utf16, uint64 length, char *outUtf8, uint64 capacity);
+
+        bool IsValidUTF8(const char *utf8, uint64 length);
+
         #ifdef _WIN32
         void WStringToString(const std::wstring &wstring, std::string &outString);
         void StringToWstring(const std::string &string, std::wstring &outWstring);
@@ -0,0 +1,178 @@
+#include "Profiler.h"
+#include "TimeUtils.h"
+
+#include <stdio.h>
+
+#define DEFAULT_THREAD_CAPACITY (1 << 16)
+
+namespace UTILS
+{
+    namespace TIME
+    {
+        __THREAD Profiler::ThreadBuffer *Profiler::threadBuffer_ = nullptr;
+
+        // Retires the thread's buffer when the thread exits.
+        struct ThreadBufferRetirer
+        {
+            ~ThreadBufferRetirer() {
+                if (Profiler::threadBuffer_) {
+                    Profiler::getInstance().retireThreadBuffer(Profiler::threadBuffer_);
+                    Profiler::threadBuffer_ = nullptr;
+                }
+            }
+        };
+
+        Profiler &Profiler::getInstance() {
+            static Profiler instance;
+            return instance;
+        }
+
+        Profiler::Profiler()
+            : enabled_(false)
+            , threadCapacity_(DEFAULT_THREAD_CAPACITY)
+            , nextThreadIndex_(0) {
+        }
+
+        Profiler::~Profiler() {
+            // Buffers of live threads stay alive until exit so late events never touch freed memory.
+            std::lock_guard<std::mutex> lock(buffersMutex_);
+            for (auto buffer : buffers_) {
+                if (buffer->retired) {
+                    delete buffer;
+                }
+            }
+        }
+
+        Profiler::ThreadBuffer::ThreadBuffer(uint32 index, uint32 capacity)
+            : events(capacity)
+            , head(0)
+            , threadIndex(index)
+            , retired(false) {
+        }
+
+        void Profiler::setEnabled(bool enabled) {
+            enabled_.store(enabled, std::memory_order_relaxed);
+        }
+
+        void Profiler::setThreadCapacity(uint32 capacity) {
+            std::lock_guard<std::mutex> lock(buffersMutex_);
+            threadCapacity_ = capacity > 0 ? capacity : 1;
+        }
+
+        Profiler::ThreadBuffer *Profiler::getThreadBuffer() {
+            if (threadBuffer_ == nullptr) {
+                static thread_local ThreadBufferRetirer retirer;
+                UNUSED(retirer);
+
+                std::lock_guard<std::mutex> lock(buffersMutex_);
+                threadBuffer_ = new ThreadBuffer(nextThreadIndex_++, threadCapacity_);
+                buffers_.push_back(threadBuffer_);
+            }
+            return threadBuffer_;
+        }
+
+        void Profiler::retireThreadBuffer(ThreadBuffer *buffer) {
+            std::lock_guard<std::mutex> lock(buffersMutex_);
+            buffer->retired = true;
+        }
+
+        void Profiler::record(const char *name, EventType type) {
+            ThreadBuffer *buffer = getThreadBuffer();
+            uint64 head = buffer->head.load(std::memory_order_relaxed);
+
+            Event &event = buffer->events[head % buffer->events.size()];
+            event.name = name;
+            event.timestamp = FetchCurrentNanos();
+            event.type = type;
+
+            buffer->head.store(head + 1, std::memory_order_release);
+        }
+
+        void Profiler::beginZone(const char *name) {
+            record(name, EventType::BEGIN);
+        }
+
+        void Profiler::endZone(const char *name) {
+            record(name, EventType::END);
+        }
+
+        static void AppendJsonString(std::string &out, const char *str) {
+            out += '"';
+            for (; *str; ++str) {
+                char ch = *str;
+                if (ch == '"' || ch == '\\') {
+                    out += '\\';
+                    out += ch;
+                }
+                else if ((unsigned char)ch < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+                    out += escaped;
+                }
+                else {
+                    out += ch;
+                }
+            }
+            out += '"';
+        }
+
+        void Profiler::exportChromeTrace(std::string &outJson) const {
+            std::lock_guard<std::mutex> lock(buffersMutex_);
+
+            outJson.clear();
+            outJson += "{\"traceEvents\":[";
+
+            bool first = true;
+            char line[128];
+            for (const auto buffer : buffers_) {
+                uint64 head = buffer->head.load(std::memory_order_acquire);
+                uint64 capacity = buffer->events.size();
+                uint64 start = head > capacity ? head - capacity : 0;
+
+                for (uint64 index = start; index < head; ++index) {
+                    const Event &event = buffer->events[index % capacity];
+                    if (!first) outJson += ',';
+                    first = false;
+
+                    outJson += "\n{\"name\":";
+                    AppendJsonString(outJson, event.name);
+                    snprintf(line, sizeof(line), ",\"ph\":\"%c\",\"ts\":%llu.%03u,\"pid\":0,\"tid\":%u}",
+                             event.type == EventType::BEGIN ? 'B' : 'E',
+                             (unsigned long long)(event.timestamp / 1000),
+                             (unsigned)(event.timestamp % 1000),
+                             buffer->threadIndex);
+                    outJson += line;
+                }
+            }
+
+            outJson += "\n],\"displayTimeUnit\":\"ms\"}\n";
+        }
+
+        bool Profiler::saveChromeTrace(const std::string &filepath) const {
+            std::string json;
+            exportChromeTrace(json);
+
+            FILE *file = fopen(filepath.c_str(), "wb");
+            if (file == nullptr)
+                return false;
+
+            bool ok = fwrite(json.data(), 1, json.size(), file) == json.size();
+            fclose(file);
+            return ok;
+        }
+
+        void Profiler::clear() {
+            std::lock_guard<std::mutex> lock(buffersMutex_);
+            uint64 kept = 0;
+            for (auto buffer : buffers_) {
+                if (buffer->retired) {
+                    delete buffer;
+                    continue;
+                }
+                buffer->head.store(0, std::memory_order_release);
+                buffers_[kept++] = buffer;
+            }
+            buffers_.resize(kept);
+        }
+    }
+}
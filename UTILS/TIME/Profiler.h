@@ -0,0 +1,113 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BASE/Honey.h"
+
+namespace UTILS
+{
+    namespace TIME
+    {
+        // Records named begin/end events into per-thread ring buffers and exports them
+        // as Chrome trace JSON (chrome://tracing, Perfetto). Disabled by default, a disabled
+        // zone costs one relaxed load. Zone names must be string literals or otherwise outlive the profiler.
+        class Profiler final
+        {
+        public:
+            static Profiler &getInstance();
+
+            void setEnabled(bool enabled);
+            inline bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+            // Events kept per thread, older ones are overwritten. Only affects threads that record afterwards.
+            void setThreadCapacity(uint32 capacity);
+
+            void beginZone(const char *name);
+            void endZone(const char *name);
+
+            // Call while no zones are being recorded to get a consistent snapshot.
+            void exportChromeTrace(std::string &outJson) const;
+            bool saveChromeTrace(const std::string &filepath) const;
+            // Only while no zones are being recorded. Also frees the buffers of exited threads.
+            void clear();
+
+        private:
+            Profiler();
+            ~Profiler();
+
+            enum class EventType : uint8
+            {
+                BEGIN,
+                END
+            };
+
+            struct Event
+            {
+                const char *name;
+                uint64 timestamp;
+                EventType type;
+            };
+
+            // Written only by its own thread, head_ is published with release so readers see whole events.
+            // Retired when the thread exits, its events stay exportable until the next clear().
+            struct ThreadBuffer
+            {
+                ThreadBuffer(uint32 threadIndex, uint32 capacity);
+
+                std::vector<Event> events;
+                std::atomic<uint64> head;
+                uint32 threadIndex;
+                bool retired;
+            };
+
+            ThreadBuffer *getThreadBuffer();
+            void retireThreadBuffer(ThreadBuffer *buffer);
+            void record(const char *name, EventType type);
+
+            friend struct ThreadBufferRetirer;
+
+            static __THREAD ThreadBuffer *threadBuffer_;
+
+            std::atomic<bool> enabled_;
+            uint32 threadCapacity_;
+            uint32 nextThreadIndex_;
+            mutable std::mutex buffersMutex_;
+            std::vector<ThreadBuffer *> buffers_;
+
+            DISALLOW_COPY_AND_ASSIGN(Profiler)
+        };
+
+        class ProfileZone final
+        {
+        public:
+            explicit ProfileZone(const char *name)
+                : name_(Profiler::getInstance().isEnabled() ? name : nullptr) {
+                if (name_) Profiler::getInstance().beginZone(name_);
+            }
+
+            ~ProfileZone() {
+                if (name_) Profiler::getInstance().endZone(name_);
+            }
+
+        private:
+            const char *name_;
+
+            DISALLOW_COPY_AND_ASSIGN(ProfileZone)
+        };
+    }
+}
+
+#define PROFILE_ZONE_CONCAT_(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT_(a, b)
+
+#ifdef HONEY_DISABLE_PROFILER
+#define PROFILE_ZONE(name) do {} while(0)
+#else
+#define PROFILE_ZONE(name) UTILS::TIME::ProfileZone PROFILE_ZONE_CONCAT(profileZone_, __LINE__)(name)
+#endif
+
+#endif // PROFILER_H
@@ -1,48 +1,55 @@
 #include "TimeUtils.h"
 #include <stdio.h>
-#include "BASE/Honey.h"
 
 namespace UTILS
 {
     namespace TIME
     {
-        static double curtime = 0;
-
         #ifdef _WIN32
 
-        LARGE_INTEGER frequency;
-        double frequencyMult;
-        LARGE_INTEGER startTime;
-
-        double FetchCurrentTime() {
-            if (frequency.QuadPart == 0) {
+        struct PerformanceClock
+        {
+            PerformanceClock() {
+                LARGE_INTEGER frequency;
                 QueryPerformanceFrequency(&frequency);
                 QueryPerformanceCounter(&startTime);
-                curtime = 0.0;
-                frequencyMult = 1.0 / static_cast<double>(frequency.QuadPart);
+                nanosMult = 1000000000.0 / static_cast<double>(frequency.QuadPart);
             }
+
+            LARGE_INTEGER startTime;
+            double nanosMult;
+        };
+
+        uint64 FetchCurrentNanos() {
+            // Initialized once, even when threads race for the first call.
+            static const PerformanceClock clock;
             LARGE_INTEGER time;
             QueryPerformanceCounter(&time);
-            double elapsed = static_cast<double>(time.QuadPart - startTime.QuadPart);
-            return elapsed * frequencyMult;
+            return static_cast<uint64>(static_cast<double>(time.QuadPart - clock.startTime.QuadPart) * clock.nanosMult);
         }
 
         #else
 
-        uint64 _frequency = 0;
-        uint64 _starttime = 0;
+        static uint64 ReadMonotonicNanos() {
+            struct timespec ts;
+        #ifdef CLOCK_MONOTONIC_RAW
+            // Not slewed by NTP, so short intervals are not stretched or squeezed.
+            if (clock_gettime(CLOCK_MONOTONIC_RAW, &ts) != 0)
+        #endif
+                clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (uint64)ts.tv_sec * 1000000000ULL + (uint64)ts.tv_nsec;
+        }
 
-        double FetchCurrentTime() {
-            static time_t start;
-            struct timeval tv;
-            gettimeofday(&tv, nullptr);
-            if (start == 0) {
-                start = tv.tv_sec;
-            }
-            tv.tv_sec -= start;
-            return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
+        static const uint64 startNanos = ReadMonotonicNanos();
+
+        uint64 FetchCurrentNanos() {
+            return ReadMonotonicNanos() - startNanos;
         }
 
         #endif
+
+        double FetchCurrentTime() {
+            return (double)FetchCurrentNanos() / 1000000000.0;
+        }
     }
 }
@@ -5,14 +5,21 @@
 #include <Windows.h>
 #else
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 #endif
 
+#include "BASE/Honey.h"
+
 namespace UTILS
 {
     namespace TIME
     {
+        // Seconds since startup, from a monotonic clock. Safe for frame deltas.
         double FetchCurrentTime();
+        // Monotonic nanoseconds since startup, for profiling and fine grained timing. The start
+        // is taken at static initialization, on Windows at the first call.
+        uint64 FetchCurrentNanos();
     }
 }
 